@@ -0,0 +1,155 @@
+/*
+    This file defines the binary checkpoint format written by checkpoint and mapped back by restore
+*/
+#pragma once
+#include <cstdint>
+#include "Program.h"
+
+const char CHECKPOINT_MAGIC[8] = { 'C', 'S', 'O', 'C', 'K', 'P', 'T', '1' };
+const uint32_t CHECKPOINT_VERSION = 4;
+
+// The sections follow the header back to back, in the order of their counts below
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numCores;
+    uint64_t tick;
+    uint64_t memorySize;
+    uint64_t frameSize;             // 0 for the flat allocator
+    int64_t quantumCycles;
+    int64_t delayPerExec;
+    int32_t algorithm;
+    int32_t nextProcessId;
+    int64_t testerProcessCounter;
+    uint64_t dispatches;
+    uint64_t preemptions;
+    uint64_t completions;
+    uint64_t memoryRequeues;
+    uint64_t sleeps;
+    uint64_t ioRequests;
+    uint64_t interrupts;
+    int64_t overlapTicks;
+    uint64_t pagedIn;
+    uint64_t pagedOut;
+    uint64_t slotCount;             // CheckpointProcess records, one per process table slot
+    uint64_t readyCount;            // CheckpointHandle records in ready queue order
+    uint64_t blockCount;            // CheckpointBlock records in address order
+    uint64_t swappedCount;          // CheckpointSwapped records
+    uint64_t sleeperCount;          // CheckpointSleeper records
+    uint64_t ioCount;               // CheckpointIoRequest records, each device's queue in order
+    uint64_t programCount;          // CheckpointProgram records, one per distinct image
+    uint64_t stringBytes;           // Names and timestamps, referenced by offset
+    uint64_t codeBytes;             // Program code, referenced by offset
+};
+
+struct CheckpointLoop {
+    uint32_t body;
+    uint32_t left;
+};
+
+struct CheckpointProcess {
+    uint32_t pid;                   // Equal to the slot, UINT32_MAX for a free slot
+    uint32_t generation;
+    int32_t id;
+    int32_t core;
+    int64_t currentInstruction;
+    int64_t totalInstructions;
+    int64_t memoryRequired;
+    int64_t age;
+    int64_t arrivalTick;
+    int64_t firstDispatchTick;
+    int64_t completionTick;
+    int64_t waitingTicks;
+    int64_t memoryBlockedTicks;
+    int64_t preemptions;
+    int64_t swaps;
+    int64_t readySinceTick;
+    int64_t memoryBlockedSinceTick;
+    int64_t ioBlockedTicks;
+    int64_t ioSinceTick;
+    uint64_t nameOffset;            // The timestamp follows the name
+    uint32_t nameLength;
+    uint32_t timestampLength;
+    int32_t priority;
+    uint8_t completed;
+    uint8_t evictable;              // In the memory interface's list of processes it may swap out
+    uint16_t sleepRequest;          // What a core that has not handed the process over yet was asked for
+    int32_t ioDevice;
+    uint32_t ioUnits;
+    uint32_t program;               // Index of the process's image, UINT32_MAX without one
+    uint32_t pc;                    // The rest is the ProgramContext, between two lines
+    uint32_t depth;
+    uint32_t reserved;
+    CheckpointLoop loops[PROGRAM_MAX_DEPTH];
+    uint16_t variables[PROGRAM_MAX_VARIABLES];
+};
+
+// One per core, in core order
+struct CheckpointCore {
+    uint32_t pid;                   // UINT32_MAX when the core is idle
+    uint32_t generation;
+    int64_t remaining;
+    int64_t delayCounter;
+    int64_t quantumCountdown;
+    int64_t activeTicks;
+    uint8_t active;
+    uint8_t completed;              // Completion, preemption and blocking the scheduler handles on the next tick
+    uint8_t preempt;
+    uint8_t block;
+    uint8_t reserved[4];
+};
+
+struct CheckpointHandle {
+    uint32_t pid;
+    uint32_t generation;
+};
+
+// A flat memory chunk or a paging frame
+struct CheckpointBlock {
+    uint64_t startAddress;
+    uint64_t size;
+    uint32_t owningPid;             // UINT32_MAX while free
+    uint32_t freeRank;              // Position of a free frame in the paging free list
+};
+
+// A process swapped out to the backing store
+struct CheckpointSwapped {
+    uint32_t pid;
+    uint32_t reserved;
+    uint64_t size;
+};
+
+// A process asleep in the scheduler's timing wheel
+struct CheckpointSleeper {
+    uint32_t pid;
+    uint32_t generation;
+    int64_t wakeTick;
+};
+
+// A program image shared by every process that runs it
+struct CheckpointProgram {
+    int64_t cycles;
+    uint64_t codeOffset;
+    uint32_t codeLength;
+    int32_t variables;
+};
+
+// A request queued or in service on a device
+struct CheckpointIoRequest {
+    uint32_t pid;
+    uint32_t generation;
+    int32_t device;
+    int32_t core;                   // Gets the completion interrupt
+    int64_t units;
+    int64_t submitTick;
+    int64_t finishTick;             // -1 while queued behind another request
+};
+
+static_assert(sizeof(CheckpointHeader) == 224, "CheckpointHeader layout changed");
+static_assert(sizeof(CheckpointProcess) == 272, "CheckpointProcess layout changed");
+static_assert(sizeof(CheckpointCore) == 48, "CheckpointCore layout changed");
+static_assert(sizeof(CheckpointBlock) == 24, "CheckpointBlock layout changed");
+static_assert(sizeof(CheckpointSwapped) == 16, "CheckpointSwapped layout changed");
+static_assert(sizeof(CheckpointSleeper) == 16, "CheckpointSleeper layout changed");
+static_assert(sizeof(CheckpointIoRequest) == 40, "CheckpointIoRequest layout changed");
+static_assert(sizeof(CheckpointProgram) == 24, "CheckpointProgram layout changed");
@@ -1,6 +1,8 @@
 #include<cstdint>
 #include<map>
 #include<set>
+#include<list>
+#include<vector>
 #include"./Memory.h"
 
 struct FirstFitComparator
@@ -13,6 +15,8 @@ struct FirstFitComparator
 
 class FreeList {
 public:
+    virtual ~FreeList() = default; // The memory interfaces delete their list through this base
+
     virtual AllocatedMemory* pop(uint64_t size) { return nullptr; };
     virtual void remove(AllocatedMemory* chunk) {};
     virtual void push(AllocatedMemory* chunk) {};
@@ -22,19 +26,36 @@ public:
 class FirstFitFreeList: public FreeList {
 private:
     std::set<MemoryChunk*, FirstFitComparator> chunks;
+    std::multiset<uint64_t> sizes; // Sizes of the free chunks, kept alongside chunks for the largest free chunk
+
+    void eraseSize(uint64_t size) {
+        auto it = sizes.find(size);
+
+        if(it != sizes.end()) {
+            sizes.erase(it);
+        }
+    }
+
 public:
     MemoryChunk* pop(uint64_t size) override {
         MemoryChunk* allocated = nullptr;
 
+        if(!hasAvailable(size)) {
+            return nullptr;
+        }
+
         for(const auto& chunk: chunks) {
             if(chunk->size == size) {
                 allocated = chunk;
                 allocated->isInUse = true;
+                eraseSize(size);
                 chunks.erase(chunk); //Remove the chunk from the freelist
                 break;
             } else if(chunk->size > size) {
                 //The original chunk has been resized by getPartition so no need to remove
+                eraseSize(chunk->size);
                 allocated = chunk->getPartition(size); 
+                sizes.insert(chunk->size);
                 break;
             }
         }
@@ -43,27 +64,30 @@ public:
     }
 
     void remove(AllocatedMemory* chunk) override {
-        chunks.erase((MemoryChunk*) chunk);
+        if(chunks.erase((MemoryChunk*) chunk) > 0) {
+            eraseSize(chunk->size);
+        }
     }
 
     void push(AllocatedMemory* chunk) override {
-        chunks.insert((MemoryChunk*) chunk);
+        if(chunks.insert((MemoryChunk*) chunk).second) {
+            sizes.insert(chunk->size);
+        }
     }
 
     bool hasAvailable(uint64_t size) {
-        for(const auto& chunk: chunks) {
-            if(chunk->size >= size) {
-                return true;
-            }
-        }
+        return getLargest() >= size;
+    }
 
-        return false;
+    uint64_t getLargest() {
+        return sizes.empty() ? 0 : *sizes.rbegin();
     }
 };
 
 class FirstFitPagingFreeList: public FreeList {
 private:
-    std::queue<MemoryFrame*> frames;
+    std::list<MemoryFrame*> frames;
+    std::vector<std::list<MemoryFrame*>::iterator> positions; // By frame number, frames.end() while not listed
     uint64_t frameSize;
 
 public:
@@ -76,20 +100,36 @@ public:
     MemoryFrame* pop(uint64_t size) override {
         if(frames.size() > 0) {
             MemoryFrame* allocated = frames.front();
-            frames.pop();
+            frames.pop_front();
+            positions[allocated->frameNumber] = frames.end();
             return allocated;
         }
 
         return nullptr;
     }
 
+    // Takes a frame out wherever it is in the order, does nothing if it is not listed
     void remove(AllocatedMemory* chunk) override {
-        MemoryFrame* allocated = frames.front();
-        frames.pop();
+        MemoryFrame* frame = (MemoryFrame*) chunk;
+
+        if(frame->frameNumber < positions.size() && positions[frame->frameNumber] != frames.end()) {
+            frames.erase(positions[frame->frameNumber]);
+            positions[frame->frameNumber] = frames.end();
+        }
     }
 
     void push(AllocatedMemory* chunk) override {
-        frames.push((MemoryFrame*) chunk);
+        MemoryFrame* frame = (MemoryFrame*) chunk;
+
+        if(frame->frameNumber >= positions.size()) {
+            positions.resize(frame->frameNumber + 1, frames.end());
+        }
+        positions[frame->frameNumber] = frames.insert(frames.end(), frame);
+    }
+
+    // Free frames in the order they will be handed out
+    std::vector<MemoryFrame*> getFrames() {
+        return std::vector<MemoryFrame*>(frames.begin(), frames.end());
     }
 
     uint64_t getAvailableMemory() {
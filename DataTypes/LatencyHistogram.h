@@ -0,0 +1,145 @@
+/*
+    This file defines a log-bucketed (HDR style) histogram of host nanoseconds
+*/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//16 linear sub-buckets per power of two, about 6% relative error over the full 64 bit range
+const int HISTOGRAM_SUB_BITS = 4;
+const int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS;
+const int HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS;
+
+inline int highestBit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int) index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+inline int histogramBucket(uint64_t value) {
+    if(value < HISTOGRAM_SUB_BUCKETS) {
+        return (int) value;
+    }
+
+    int shift = highestBit(value) - HISTOGRAM_SUB_BITS;
+    return ((shift + 1) << HISTOGRAM_SUB_BITS) + (int) ((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+// Largest value that falls into the bucket
+inline uint64_t histogramBucketLimit(int bucket) {
+    if(bucket < HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    int shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+    uint64_t sub = HISTOGRAM_SUB_BUCKETS + (bucket & (HISTOGRAM_SUB_BUCKETS - 1));
+    return ((sub + 1) << shift) - 1;
+}
+
+inline uint64_t nowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Plain counts merged from one or more histograms, owned by the reader
+struct HistogramSnapshot {
+    uint64_t counts[HISTOGRAM_BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    uint64_t valueAtPercentile(double percentile) const {
+        if(count == 0) {
+            return 0;
+        }
+
+        uint64_t target = (uint64_t) (count * percentile / 100.0 + 0.5);
+        uint64_t seen = 0;
+
+        for(int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            seen += counts[i];
+
+            if(seen >= target && seen > 0) {
+                return histogramBucketLimit(i) < max ? histogramBucketLimit(i) : max;
+            }
+        }
+
+        return max;
+    }
+
+    double mean() const {
+        return count == 0 ? 0 : (double) sum / count;
+    }
+};
+
+// Written by exactly one thread, read by any number of threads without locks
+class LatencyHistogram {
+    private:
+        std::atomic<uint64_t> counts[HISTOGRAM_BUCKETS];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> max;
+        std::atomic<bool> resetRequested;
+
+        void bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+            //Single writer, so a relaxed load and store is enough and avoids a locked add
+            counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+    public:
+        LatencyHistogram() {
+            for(int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                counts[i].store(0);
+            }
+
+            count.store(0);
+            sum.store(0);
+            max.store(0);
+            resetRequested.store(false);
+        }
+
+        void record(uint64_t nanoseconds) {
+            if(resetRequested.load(std::memory_order_relaxed)) {
+                for(int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                    counts[i].store(0, std::memory_order_relaxed);
+                }
+
+                count.store(0, std::memory_order_relaxed);
+                sum.store(0, std::memory_order_relaxed);
+                max.store(0, std::memory_order_relaxed);
+                resetRequested.store(false, std::memory_order_relaxed);
+            }
+
+            bump(counts[histogramBucket(nanoseconds)], 1);
+            bump(count, 1);
+            bump(sum, nanoseconds);
+
+            if(nanoseconds > max.load(std::memory_order_relaxed)) {
+                max.store(nanoseconds, std::memory_order_relaxed);
+            }
+        }
+
+        // The writer clears the counts on its next record so the reader never races it
+        void requestReset() {
+            resetRequested.store(true);
+        }
+
+        void mergeInto(HistogramSnapshot& snapshot) {
+            for(int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                snapshot.counts[i] += counts[i].load(std::memory_order_relaxed);
+            }
+
+            snapshot.count += count.load(std::memory_order_relaxed);
+            snapshot.sum += sum.load(std::memory_order_relaxed);
+
+            uint64_t currentMax = max.load(std::memory_order_relaxed);
+            snapshot.max = currentMax > snapshot.max ? currentMax : snapshot.max;
+        }
+};
@@ -0,0 +1,53 @@
+/*
+    This file defines a lock-free multiple producer single consumer mailbox
+*/
+#pragma once
+#include <atomic>
+#include <vector>
+
+template <typename T>
+class Mailbox {
+    private:
+        struct Node {
+            T item;
+            Node* next;
+        };
+
+        std::atomic<Node*> head; // Most recently posted item first
+
+    public:
+        Mailbox() {
+            head.store(nullptr);
+        }
+
+        ~Mailbox() {
+            drain();
+        }
+
+        // Safe to call from any thread
+        void post(const T& item) {
+            Node* node = new Node{ item, head.load(std::memory_order_relaxed) };
+
+            while(!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+        }
+
+        // Takes every pending item in posting order, only the consumer thread may call this
+        std::vector<T> drain() {
+            std::vector<T> items;
+            Node* node = head.exchange(nullptr, std::memory_order_acquire);
+
+            while(node != nullptr) {
+                Node* next = node->next;
+                items.push_back(node->item);
+                delete node;
+                node = next;
+            }
+
+            return std::vector<T>(items.rbegin(), items.rend());
+        }
+
+        // A single relaxed load, cheap enough to check every tick
+        bool isEmpty() {
+            return head.load(std::memory_order_relaxed) == nullptr;
+        }
+};
@@ -0,0 +1,187 @@
+/*
+    This file defines a minimal memory mapped file wrapper for Windows and POSIX hosts
+*/
+#pragma once
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+class MappedFile {
+    private:
+        uint8_t* view;
+        uint64_t mappedSize;
+        bool writable;
+#ifdef _WIN32
+        HANDLE file;
+        HANDLE mapping;
+#else
+        int fd;
+#endif
+
+        bool map(uint64_t size) {
+            if(size == 0) {
+                return true; // Nothing to map, an empty file is still valid
+            }
+#ifdef _WIN32
+            DWORD protect = writable ? PAGE_READWRITE : PAGE_READONLY;
+            mapping = CreateFileMappingA(file, nullptr, protect, (DWORD) (size >> 32), (DWORD) size, nullptr);
+
+            if(mapping == nullptr) {
+                return false;
+            }
+
+            view = (uint8_t*) MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+#else
+            void* addr = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+            view = addr == MAP_FAILED ? nullptr : (uint8_t*) addr;
+#endif
+            mappedSize = view == nullptr ? 0 : size;
+            return view != nullptr;
+        }
+
+        void unmap() {
+#ifdef _WIN32
+            if(view != nullptr) {
+                UnmapViewOfFile(view);
+            }
+
+            if(mapping != nullptr) {
+                CloseHandle(mapping);
+                mapping = nullptr;
+            }
+#else
+            if(view != nullptr) {
+                munmap(view, mappedSize);
+            }
+#endif
+            view = nullptr;
+            mappedSize = 0;
+        }
+
+    public:
+        MappedFile() {
+            view = nullptr;
+            mappedSize = 0;
+            writable = false;
+#ifdef _WIN32
+            file = INVALID_HANDLE_VALUE;
+            mapping = nullptr;
+#else
+            fd = -1;
+#endif
+        }
+
+        ~MappedFile() {
+            close();
+        }
+
+        // Creates (or truncates) the file at path and maps the first size bytes for writing
+        bool create(const std::string& path, uint64_t size) {
+            close();
+            writable = true;
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+            if(file == INVALID_HANDLE_VALUE) {
+                return false;
+            }
+#else
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+            if(fd < 0 || ftruncate(fd, size) != 0) {
+                return false;
+            }
+#endif
+            return map(size);
+        }
+
+        // Maps an existing file read only
+        bool openRead(const std::string& path) {
+            close();
+            writable = false;
+            uint64_t size;
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+            if(file == INVALID_HANDLE_VALUE) {
+                return false;
+            }
+
+            LARGE_INTEGER fileSize;
+            GetFileSizeEx(file, &fileSize);
+            size = fileSize.QuadPart;
+#else
+            fd = ::open(path.c_str(), O_RDONLY);
+
+            if(fd < 0) {
+                return false;
+            }
+
+            struct stat st;
+            fstat(fd, &st);
+            size = st.st_size;
+#endif
+            return map(size);
+        }
+
+        // Grows or shrinks a writable mapping, existing contents are preserved
+        bool resize(uint64_t size) {
+            unmap();
+#ifdef _WIN32
+            LARGE_INTEGER newSize;
+            newSize.QuadPart = size;
+            SetFilePointerEx(file, newSize, nullptr, FILE_BEGIN);
+            SetEndOfFile(file);
+#else
+            if(ftruncate(fd, size) != 0) {
+                return false;
+            }
+#endif
+            return map(size);
+        }
+
+        void close() {
+            unmap();
+#ifdef _WIN32
+            if(file != INVALID_HANDLE_VALUE) {
+                CloseHandle(file);
+                file = INVALID_HANDLE_VALUE;
+            }
+#else
+            if(fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+#endif
+        }
+
+        uint8_t* data() {
+            return view;
+        }
+
+        uint64_t size() {
+            return mappedSize;
+        }
+
+        bool isOpen() {
+#ifdef _WIN32
+            return file != INVALID_HANDLE_VALUE;
+#else
+            return fd >= 0;
+#endif
+        }
+};
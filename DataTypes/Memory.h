@@ -6,13 +6,15 @@
 #include<string>
 #include<sstream>
 
+const uint32_t INVALID_PID = UINT32_MAX;
+
 class AllocatedMemory {
     public:
         uint64_t startAddress;
         uint64_t endAddress;
         uint64_t size;
         bool isInUse;
-        std::string owningProcess;
+        uint32_t owningPid;         // Pid in the ProcessTable, INVALID_PID while free
 
         virtual ~AllocatedMemory() {}
 };
@@ -26,14 +28,14 @@ class MemoryChunk: public AllocatedMemory {
 
         MemoryChunk() {}
 
-        MemoryChunk(uint64_t size, uint64_t startAddress, MemoryChunk* next, MemoryChunk* prev, std::string owningProcess, bool isInUse = false) {
+        MemoryChunk(uint64_t size, uint64_t startAddress, MemoryChunk* next, MemoryChunk* prev, uint32_t owningPid, bool isInUse = false) {
             this->size = size;
             this->startAddress = startAddress;
             this->endAddress = startAddress + size - 1;
             this->next = next;
             this->prev = prev;
             this->isInUse = isInUse;
-            this->owningProcess = owningProcess;
+            this->owningPid = owningPid;
         }
 
         MemoryChunk* getPartition(uint64_t partitionSize) {
@@ -41,7 +43,7 @@ class MemoryChunk: public AllocatedMemory {
                 return nullptr;
             }
 
-            MemoryChunk* partitionChunk = new MemoryChunk(partitionSize, this->startAddress, this, this->prev, "", true);
+            MemoryChunk* partitionChunk = new MemoryChunk(partitionSize, this->startAddress, this, this->prev, INVALID_PID, true);
             MemoryChunk* previousChunk = partitionChunk->prev;
 
             //Edit the data of the right split of the chunk (represented by "this")
@@ -66,12 +68,12 @@ class MemoryFrame: public AllocatedMemory {
 
         MemoryFrame() {}
 
-        MemoryFrame(uint64_t size, uint64_t startAddress, uint64_t frameNumber, std::string owningProcess, bool isInUse = false) {
+        MemoryFrame(uint64_t size, uint64_t startAddress, uint64_t frameNumber, uint32_t owningPid, bool isInUse = false) {
             this->size = size;
             this->frameNumber = frameNumber;
             this->startAddress = startAddress;
             this->endAddress = startAddress + size - 1;
-            this->owningProcess = owningProcess;
+            this->owningPid = owningPid;
             this->isInUse = isInUse;
         }
 };
@@ -4,7 +4,19 @@
 #pragma once
 #include <string>
 #include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <memory>
 #include "Memory.h"
+#include "Program.h"
+
+// Names a process table slot, the generation tells a reused slot apart from the process it used to hold
+struct ProcessHandle {
+    uint32_t pid = INVALID_PID;
+    uint32_t generation = 0;
+};
 
 class Process {
     private:
@@ -20,24 +32,45 @@ class Process {
 
     public:
         std::string name;
-        long long current_instruction;
-        long long total_instructions;
+        long long current_instruction = 0;
+        long long total_instructions = 0;
         std::string timestamp;
-        bool completed;
-        int core;
+        bool completed = false;
+        int core = -1;
         std::string logFilePath;
-        int id;
-        static int last_id; 
-        long long memoryRequired;
+        int id = 0;                     // Unique within the ProcessTable, slots are reused but ids are not
+        ProcessHandle handle;           // Set by the ProcessTable that owns the process
+        long long memoryRequired = 0;
+        int priority = 0;               // Carried from replayed workloads, the schedulers do not use it yet
         std::vector<AllocatedMemory*> allocatedMemory;
-        time_t age;
+        time_t age = 0;
+        std::shared_ptr<const Program> program; // Without one every line just prints the greeting
+        ProgramContext context = {};
+        int32_t printed = PRINT_NONE;   // What the last executed line printed, PRINT_NONE for nothing
+        long long sleepRequest = 0;     // Ticks the last executed line asked to sleep off the core, 0 for none
+        int ioDevice = -1;              // Device the last executed line asked for, -1 for none
+        long long ioUnits = 0;
+
+        //Scheduling accounting in system ticks, -1 until the event happens
+        long long arrivalTick = -1;
+        long long firstDispatchTick = -1;
+        long long completionTick = -1;
+        long long waitingTicks = 0;     // Ticks spent in the ready queue, excluding memory waits
+        long long memoryBlockedTicks = 0; // Ticks spent requeued because memory could not be allocated
+        long long ioBlockedTicks = 0;   // Ticks spent off the cores waiting for a device
+        long long preemptions = 0;
+        long long swaps = 0;            // Times the process was swapped out to the backing store
+        long long readySinceTick = -1;
+        long long memoryBlockedSinceTick = -1;
+        long long ioSinceTick = -1;
 
+        // An empty ProcessTable slot, every member keeps its default
         Process() {}
 
         Process(std::string name, long long total_instructions, 
                 std::string timestamp, long long memoryRequired) {
             this->name = name;
-            this->id = last_id++;
+            this->id = 0;
             this->current_instruction = 0;
             this->total_instructions = total_instructions;
             this->timestamp = timestamp;
@@ -45,31 +78,67 @@ class Process {
             this->core = -1;
             this->logFilePath = "./Logs/" + name + ".txt";
             this->memoryRequired = memoryRequired;
+            this->priority = 0;
             this->allocatedMemory = {};
             this->age = convertToTime(timestamp);
+            this->program = nullptr;
+            this->context = {};
+            this->printed = PRINT_NONE;
+            this->sleepRequest = 0;
+            this->ioDevice = -1;
+            this->ioUnits = 0;
+            this->arrivalTick = -1;
+            this->firstDispatchTick = -1;
+            this->completionTick = -1;
+            this->waitingTicks = 0;
+            this->memoryBlockedTicks = 0;
+            this->ioBlockedTicks = 0;
+            this->preemptions = 0;
+            this->swaps = 0;
+            this->readySinceTick = -1;
+            this->memoryBlockedSinceTick = -1;
+            this->ioSinceTick = -1;
+        }
+
+        long long getResponseTicks() const {
+            return firstDispatchTick == -1 ? -1 : firstDispatchTick - arrivalTick;
+        }
+
+        long long getTurnaroundTicks() const {
+            return completionTick == -1 ? -1 : completionTick - arrivalTick;
+        }
 
-            // FILE* f = fopen(logFilePath.c_str(), "w");
-            // fprintf(f, "Process name: %s\n", name.c_str());
-            // fprintf(f, "Logs:\n\n");
-            // fclose(f);
+        // Gives the process a program, its cycle count becomes the instruction count
+        void load(std::shared_ptr<const Program> program) {
+            this->program = program;
+            this->context = {};
+            this->total_instructions = program->cycles;
         }
 
-        bool executeLine(std::string exec_timestamp, int coreId) {
-            //Execution
+        bool executeLine() {
+            //Execution, logging is handled asynchronously by the LogWriter
+            if(program) {
+                runProgram(*program, context, 1, printed);
+                sleepRequest = context.sleepTicks;
+                ioDevice = context.ioUnits > 0 ? context.ioDevice : -1;
+                ioUnits = context.ioUnits;
+                context.sleepTicks = 0;
+                context.ioUnits = 0;
+            } else {
+                printed = PRINT_TEXT;
+            }
+
             current_instruction++;
-            //log(exec_timestamp, coreId);
             this->completed = current_instruction >= total_instructions;
             return this->completed;
         }
 
-        void log(std::string exec_timestamp, int coreId) {
-            FILE* f = fopen(logFilePath.c_str(), "a");
-            fprintf(f, "(%s) Core:%d \"Hello world from %s\"\n", exec_timestamp.c_str(), coreId, name.c_str());
-            fclose(f);
+        // The last executed line asked to leave the core, to sleep or for I/O
+        bool isBlocking() const {
+            return sleepRequest > 0 || ioDevice != -1;
         }
 
         void setCore(int core) {
             this->core = core;
         }
-};
-int Process::last_id = 0;
\ No newline at end of file
+};
\ No newline at end of file
@@ -0,0 +1,264 @@
+/*
+    This file defines the table that owns every process, indexed by pid with a name index for the shell
+*/
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <algorithm>
+#include "Process.h"
+
+// Processes live in fixed size chunks that never move, so a resolved Process* stays valid while
+// other threads create more. Lookups by pid or handle do not lock, creation and release do. A released
+// slot is emptied and later refilled with the next generation, visits hold off both so they never see
+// a slot change under them.
+class ProcessTable {
+    public:
+        // The slot count at one moment, processes created afterwards are left out. Nothing is copied,
+        // visited processes are read live, as the shell has always read them.
+        class Snapshot {
+            private:
+                ProcessTable* table;
+                uint32_t count;
+
+            public:
+                Snapshot(ProcessTable* table, uint32_t count) {
+                    this->table = table;
+                    this->count = count;
+                }
+
+                template <typename Visit>
+                void forEach(Visit visit) const {
+                    std::shared_lock<std::shared_mutex> lock(table->reuseMtx);
+
+                    for(uint32_t pid = 0; pid < count; pid++) {
+                        Process* p = table->at(pid);
+
+                        if(p != nullptr) {
+                            visit(*p);
+                        }
+                    }
+                }
+        };
+
+    private:
+        static const uint32_t CHUNK_BITS = 12;
+        static const uint32_t CHUNK_SIZE = 1 << CHUNK_BITS;
+        static const uint32_t MAX_CHUNKS = 1 << 14;     // 64M slots
+
+        std::atomic<Process*> chunks[MAX_CHUNKS];
+        std::atomic<uint32_t> slotCount;                // Slots handed out so far, published after the slot is filled
+        std::atomic<uint32_t> liveCount;
+        std::unordered_map<std::string, uint32_t> nameIndex;
+        std::vector<uint32_t> freeSlots;
+        int nextId;
+        std::string logDirectory;
+        std::mutex mtx;
+        std::shared_mutex reuseMtx;                     // Shared by visits, exclusive while a released slot changes
+
+        Process* slot(uint32_t pid) {
+            return chunks[pid >> CHUNK_BITS].load(std::memory_order_acquire) + (pid & (CHUNK_SIZE - 1));
+        }
+
+    public:
+        ProcessTable() {
+            for(uint32_t i = 0; i < MAX_CHUNKS; i++) {
+                chunks[i].store(nullptr);
+            }
+
+            slotCount.store(0);
+            liveCount.store(0);
+            nextId = 0;
+            logDirectory = "./Logs/";
+        }
+
+        ~ProcessTable() {
+            for(uint32_t i = 0; i < MAX_CHUNKS; i++) {
+                delete[] chunks[i].load();
+            }
+        }
+
+        // Returns nullptr when the name is taken or the table is full
+        Process* create(const std::string& name, long long instructions, std::string timestamp, long long memoryRequired) {
+            Process created(name, instructions, timestamp, memoryRequired); //Parses the timestamp, kept outside the lock
+            std::lock_guard<std::mutex> lock(mtx);
+
+            if(nameIndex.find(name) != nameIndex.end()) {
+                return nullptr;
+            }
+
+            uint32_t pid;
+            uint32_t generation = 0;
+            bool reused = !freeSlots.empty();
+
+            if(reused) {
+                pid = freeSlots.back();
+                freeSlots.pop_back();
+                generation = slot(pid)->handle.generation + 1;
+            } else {
+                pid = slotCount.load(std::memory_order_relaxed);
+
+                if(pid >= MAX_CHUNKS * CHUNK_SIZE) {
+                    return nullptr;
+                }
+
+                if((pid & (CHUNK_SIZE - 1)) == 0 && chunks[pid >> CHUNK_BITS].load() == nullptr) {
+                    chunks[pid >> CHUNK_BITS].store(new Process[CHUNK_SIZE], std::memory_order_release);
+                }
+            }
+
+            Process* p = slot(pid);
+            std::unique_lock<std::shared_mutex> reuse(reuseMtx, std::defer_lock);
+
+            if(reused) {
+                reuse.lock();
+            }
+
+            *p = std::move(created);
+            p->handle = { pid, generation };
+            p->id = nextId++;
+            p->logFilePath = logDirectory + name + ".txt";
+            nameIndex.emplace(name, pid);
+            liveCount.fetch_add(1);
+
+            if(!reused) {
+                slotCount.store(pid + 1, std::memory_order_release);
+            }
+
+            return p;
+        }
+
+        // Where the logs of processes created afterwards go, ends with a separator
+        void setLogDirectory(const std::string& logDirectory) {
+            std::lock_guard<std::mutex> lock(mtx);
+            this->logDirectory = logDirectory;
+        }
+
+        // Frees the slot for reuse, the process must no longer be queued, running, holding memory or
+        // referenced by a log record
+        bool release(ProcessHandle handle) {
+            std::lock_guard<std::mutex> lock(mtx);
+            Process* p = get(handle);
+
+            if(p == nullptr) {
+                return false;
+            }
+
+            std::unique_lock<std::shared_mutex> reuse(reuseMtx);
+            nameIndex.erase(p->name);
+            *p = Process();
+            p->handle = { INVALID_PID, handle.generation };
+            freeSlots.push_back(handle.pid);
+            liveCount.fetch_sub(1);
+            return true;
+        }
+
+        // nullptr once the handle's process was released, even if the slot holds a newer one
+        Process* get(ProcessHandle handle) {
+            if(handle.pid >= slotCount.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+
+            Process* p = slot(handle.pid);
+            return p->handle.pid == handle.pid && p->handle.generation == handle.generation ? p : nullptr;
+        }
+
+        // The live process in a slot, nullptr for a free or never used pid
+        Process* at(uint32_t pid) {
+            if(pid >= slotCount.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+
+            Process* p = slot(pid);
+            return p->handle.pid == pid ? p : nullptr;
+        }
+
+        Process* find(const std::string& name) {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto entry = nameIndex.find(name);
+            return entry == nameIndex.end() ? nullptr : slot(entry->second);
+        }
+
+        bool contains(const std::string& name) {
+            return find(name) != nullptr;
+        }
+
+        // Generation of a slot whether or not it is live, pid must be below getSlotCount()
+        uint32_t generationAt(uint32_t pid) {
+            return slot(pid)->handle.generation;
+        }
+
+        uint32_t getSlotCount() {
+            return slotCount.load(std::memory_order_acquire);
+        }
+
+        int getNextId() {
+            std::lock_guard<std::mutex> lock(mtx);
+            return nextId;
+        }
+
+        // Replaces every slot, fill(pid, process) sets up the process and its handle, a slot whose handle
+        // does not end up with its own pid stays free. Live names must be unique and count at most
+        // getCapacity(). Only while nothing else reads the table.
+        template <typename Fill>
+        void restore(uint32_t count, int nextId, Fill fill) {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::lock_guard<std::shared_mutex> reuse(reuseMtx);
+            uint32_t previous = slotCount.load();
+
+            nameIndex.clear();
+            freeSlots.clear();
+            liveCount.store(0);
+
+            for(uint32_t pid = 0; pid < std::max(count, previous); pid++) {
+                if((pid & (CHUNK_SIZE - 1)) == 0 && chunks[pid >> CHUNK_BITS].load() == nullptr) {
+                    chunks[pid >> CHUNK_BITS].store(new Process[CHUNK_SIZE], std::memory_order_release);
+                }
+
+                Process* p = slot(pid);
+                uint32_t generation = p->handle.generation + 1; // Slots past count go stale
+                *p = Process();
+                p->handle = { INVALID_PID, generation };
+
+                if(pid >= count) {
+                    continue;
+                }
+
+                fill(pid, *p);
+                p->logFilePath = logDirectory + p->name + ".txt";
+
+                if(p->handle.pid != pid) {
+                    p->handle.pid = INVALID_PID;
+                    freeSlots.push_back(pid);
+                } else {
+                    nameIndex.emplace(p->name, pid);
+                    liveCount.fetch_add(1);
+                }
+            }
+
+            this->nextId = nextId;
+            slotCount.store(count, std::memory_order_release);
+        }
+
+        static uint32_t getCapacity() {
+            return MAX_CHUNKS * CHUNK_SIZE;
+        }
+
+        Snapshot snapshot() {
+            return Snapshot(this, slotCount.load(std::memory_order_acquire));
+        }
+
+        // Visits live processes in pid order
+        template <typename Visit>
+        void forEach(Visit visit) {
+            snapshot().forEach(visit);
+        }
+
+        size_t size() {
+            return liveCount.load();
+        }
+};
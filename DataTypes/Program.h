@@ -0,0 +1,230 @@
+/*
+    This file defines the bytecode programs processes run and the interpreter that runs them
+*/
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// One byte opcodes, each followed by its operands. A variable operand is one byte naming a slot, a
+// value operand is two bytes, little endian. _VI means the first source is a variable and the second
+// a value, and so on.
+enum Opcode : uint8_t {
+    OP_PRINT,           // Prints the greeting
+    OP_PRINT_VAR,       // var: prints the greeting with a variable
+    OP_DECLARE,         // var value
+    OP_ADD_VV,          // dest source source, saturates at 65535
+    OP_ADD_VI,
+    OP_ADD_IV,
+    OP_ADD_II,
+    OP_SUBTRACT_VV,     // dest source source, stops at 0
+    OP_SUBTRACT_VI,
+    OP_SUBTRACT_IV,
+    OP_SUBTRACT_II,
+    OP_SLEEP,           // ticks (one byte, at least 1): leaves the core and sleeps for that many ticks
+    OP_IO,              // device units (one byte each, units at least 1): leaves the core until the device is done
+    OP_FOR,             // repeats (two bytes, at least 1): runs the body up to the matching OP_END
+    OP_END,
+    OP_HALT,            // After the last instruction, never executed
+    OP_COUNT
+};
+
+const uint8_t OPCODE_LENGTHS[OP_COUNT] = { 1, 2, 4, 4, 5, 5, 6, 4, 5, 5, 6, 2, 3, 3, 1, 1 };
+
+const int PROGRAM_MAX_VARIABLES = 32;   // uint16 each, the symbol table takes 64 bytes of the process's memory
+const int PROGRAM_MAX_DEPTH = 3;        // FOR nesting
+const int PROGRAM_IO_DEVICES = 2;       // Device operands are taken modulo this
+
+const int32_t PRINT_NONE = -1;
+const int32_t PRINT_TEXT = -2;          // Otherwise (variable << 16) | value
+
+// Every instruction takes one cycle, so the cycle count is known before it runs
+struct Program {
+    std::vector<uint8_t> code;          // Ends with OP_HALT
+    long long cycles;
+    int variables;                      // Slots the program uses
+};
+
+struct ProgramLoop {
+    uint32_t body;                      // Offset of the first instruction of the body
+    uint32_t left;                      // Iterations after the current one
+};
+
+// Everything a process keeps between cycles
+struct ProgramContext {
+    uint32_t pc;
+    uint16_t sleepTicks;                // Requested by the last SLEEP, for the caller to act on and clear
+    uint16_t depth;
+    uint8_t ioDevice;
+    uint8_t ioUnits;                    // Requested by the last IO, 0 for none
+    ProgramLoop loops[PROGRAM_MAX_DEPTH];
+    uint16_t variables[PROGRAM_MAX_VARIABLES];
+};
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PROGRAM_COMPUTED_GOTO
+const char* PROGRAM_DISPATCH_NAME = "computed goto";
+#else
+const char* PROGRAM_DISPATCH_NAME = "switch";
+#endif
+
+//Every handler ends by charging its cycle and jumping straight to the next handler, or to the
+//switch where labels as values are not available
+#ifdef PROGRAM_COMPUTED_GOTO
+#define PROGRAM_OP(op) label_##op:
+#define PROGRAM_NEXT() if(--left == 0) { goto done; } goto *handlers[code[pc]]
+#else
+#define PROGRAM_OP(op) case op:
+#define PROGRAM_NEXT() if(--left == 0) { goto done; } continue
+#endif
+
+// Runs up to budget cycles and returns how many ran, fewer once the program ends or right after a SLEEP
+// or IO, which leave their request in the context. printed is the last PRINT of those cycles, PRINT_NONE if there was
+// none. Variable operands are masked into the symbol table, so malformed code cannot reach past it.
+inline long long runProgram(const Program& program, ProgramContext& ctx, long long budget, int32_t& printed) {
+    const uint8_t* code = program.code.data();
+    uint16_t* vars = ctx.variables;
+    uint32_t pc = ctx.pc;
+    long long left = budget;
+    const int mask = PROGRAM_MAX_VARIABLES - 1;
+
+    printed = PRINT_NONE;
+
+    if(left <= 0) {
+        return 0;
+    }
+
+#ifdef PROGRAM_COMPUTED_GOTO
+    static void* const handlers[OP_COUNT] = {
+        &&label_OP_PRINT, &&label_OP_PRINT_VAR, &&label_OP_DECLARE,
+        &&label_OP_ADD_VV, &&label_OP_ADD_VI, &&label_OP_ADD_IV, &&label_OP_ADD_II,
+        &&label_OP_SUBTRACT_VV, &&label_OP_SUBTRACT_VI, &&label_OP_SUBTRACT_IV, &&label_OP_SUBTRACT_II,
+        &&label_OP_SLEEP, &&label_OP_IO, &&label_OP_FOR, &&label_OP_END, &&label_OP_HALT
+    };
+
+    goto *handlers[code[pc]];
+#else
+    for(;;) switch(code[pc]) {
+#endif
+
+    PROGRAM_OP(OP_PRINT)
+        printed = PRINT_TEXT;
+        pc += 1;
+        PROGRAM_NEXT();
+
+    PROGRAM_OP(OP_PRINT_VAR)
+        printed = ((code[pc + 1] & mask) << 16) | vars[code[pc + 1] & mask];
+        pc += 2;
+        PROGRAM_NEXT();
+
+    PROGRAM_OP(OP_DECLARE)
+        vars[code[pc + 1] & mask] = code[pc + 2] | (code[pc + 3] << 8);
+        pc += 4;
+        PROGRAM_NEXT();
+
+    PROGRAM_OP(OP_ADD_VV) {
+        uint32_t sum = (uint32_t) vars[code[pc + 2] & mask] + vars[code[pc + 3] & mask];
+        vars[code[pc + 1] & mask] = sum > 65535 ? 65535 : sum;
+        pc += 4;
+        PROGRAM_NEXT();
+    }
+
+    PROGRAM_OP(OP_ADD_VI) {
+        uint32_t sum = (uint32_t) vars[code[pc + 2] & mask] + (code[pc + 3] | (code[pc + 4] << 8));
+        vars[code[pc + 1] & mask] = sum > 65535 ? 65535 : sum;
+        pc += 5;
+        PROGRAM_NEXT();
+    }
+
+    PROGRAM_OP(OP_ADD_IV) {
+        uint32_t sum = (uint32_t) (code[pc + 2] | (code[pc + 3] << 8)) + vars[code[pc + 4] & mask];
+        vars[code[pc + 1] & mask] = sum > 65535 ? 65535 : sum;
+        pc += 5;
+        PROGRAM_NEXT();
+    }
+
+    PROGRAM_OP(OP_ADD_II) {
+        uint32_t sum = (uint32_t) (code[pc + 2] | (code[pc + 3] << 8)) + (code[pc + 4] | (code[pc + 5] << 8));
+        vars[code[pc + 1] & mask] = sum > 65535 ? 65535 : sum;
+        pc += 6;
+        PROGRAM_NEXT();
+    }
+
+    PROGRAM_OP(OP_SUBTRACT_VV) {
+        uint16_t a = vars[code[pc + 2] & mask];
+        uint16_t b = vars[code[pc + 3] & mask];
+        vars[code[pc + 1] & mask] = a > b ? a - b : 0;
+        pc += 4;
+        PROGRAM_NEXT();
+    }
+
+    PROGRAM_OP(OP_SUBTRACT_VI) {
+        uint16_t a = vars[code[pc + 2] & mask];
+        uint16_t b = code[pc + 3] | (code[pc + 4] << 8);
+        vars[code[pc + 1] & mask] = a > b ? a - b : 0;
+        pc += 5;
+        PROGRAM_NEXT();
+    }
+
+    PROGRAM_OP(OP_SUBTRACT_IV) {
+        uint16_t a = code[pc + 2] | (code[pc + 3] << 8);
+        uint16_t b = vars[code[pc + 4] & mask];
+        vars[code[pc + 1] & mask] = a > b ? a - b : 0;
+        pc += 5;
+        PROGRAM_NEXT();
+    }
+
+    PROGRAM_OP(OP_SUBTRACT_II) {
+        uint16_t a = code[pc + 2] | (code[pc + 3] << 8);
+        uint16_t b = code[pc + 4] | (code[pc + 5] << 8);
+        vars[code[pc + 1] & mask] = a > b ? a - b : 0;
+        pc += 6;
+        PROGRAM_NEXT();
+    }
+
+    PROGRAM_OP(OP_SLEEP)
+        ctx.sleepTicks = code[pc + 1];
+        pc += 2;
+        left--;
+        goto done;
+
+    PROGRAM_OP(OP_IO)
+        ctx.ioDevice = code[pc + 1] % PROGRAM_IO_DEVICES;
+        ctx.ioUnits = code[pc + 2] > 0 ? code[pc + 2] : 1;
+        pc += 3;
+        left--;
+        goto done;
+
+    PROGRAM_OP(OP_FOR)
+        if(ctx.depth < PROGRAM_MAX_DEPTH) {
+            uint32_t repeats = code[pc + 1] | (code[pc + 2] << 8);
+            ctx.loops[ctx.depth++] = { pc + 3, repeats > 0 ? repeats - 1 : 0 };
+        }
+        pc += 3;
+        PROGRAM_NEXT();
+
+    PROGRAM_OP(OP_END)
+        if(ctx.depth > 0 && ctx.loops[ctx.depth - 1].left > 0) {
+            ctx.loops[ctx.depth - 1].left--;
+            pc = ctx.loops[ctx.depth - 1].body;
+        } else {
+            ctx.depth -= ctx.depth > 0;
+            pc += 1;
+        }
+        PROGRAM_NEXT();
+
+    PROGRAM_OP(OP_HALT)
+        goto done;
+
+#ifndef PROGRAM_COMPUTED_GOTO
+    default:
+        goto done;
+    }
+#endif
+
+done:
+    ctx.pc = pc;
+    return budget - left;
+}
+
+#undef PROGRAM_OP
+#undef PROGRAM_NEXT
@@ -0,0 +1,116 @@
+/*
+    This file defines the cache that lets processes share identical program images
+*/
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include "Program.h"
+
+struct ProgramCacheStats {
+    size_t images;              // Images some process still holds
+    size_t bytes;               // Their code and headers
+    unsigned long long hits;    // Programs that turned out to be a copy of a live image
+    unsigned long long misses;
+};
+
+// Images are immutable and owned by the processes running them, the cache only keeps weak references
+// keyed by a hash of the content, so an image goes away with the last process that holds it.
+class ProgramCache {
+    private:
+        std::unordered_map<uint64_t, std::vector<std::weak_ptr<const Program>>> images;
+        std::mutex mtx;
+        size_t entries;
+        size_t insertsSinceSweep;
+        unsigned long long hits;
+        unsigned long long misses;
+
+        static uint64_t hash(const Program& program) {
+            uint64_t h = 0xcbf29ce484222325ULL ^ (uint64_t) program.cycles ^ ((uint64_t) program.variables << 56);
+
+            for(uint8_t byte: program.code) {
+                h = (h ^ byte) * 0x100000001b3ULL;
+            }
+
+            return h;
+        }
+
+        static bool same(const Program& a, const Program& b) {
+            return a.cycles == b.cycles && a.variables == b.variables && a.code == b.code;
+        }
+
+        // Drops the references whose image is gone, amortised over as many inserts as there are entries
+        void sweep() {
+            for(auto it = images.begin(); it != images.end();) {
+                std::vector<std::weak_ptr<const Program>>& bucket = it->second;
+
+                for(size_t i = 0; i < bucket.size();) {
+                    if(bucket[i].expired()) {
+                        bucket[i] = bucket.back();
+                        bucket.pop_back();
+                        entries--;
+                    } else {
+                        i++;
+                    }
+                }
+
+                it = bucket.empty() ? images.erase(it) : std::next(it);
+            }
+
+            insertsSinceSweep = 0;
+        }
+
+    public:
+        ProgramCache() {
+            entries = 0;
+            insertsSinceSweep = 0;
+            hits = 0;
+            misses = 0;
+        }
+
+        // The live image with the same content if there is one, otherwise program itself
+        std::shared_ptr<const Program> intern(std::shared_ptr<const Program> program) {
+            uint64_t key = hash(*program);
+            std::lock_guard<std::mutex> lock(mtx);
+            std::vector<std::weak_ptr<const Program>>& bucket = images[key];
+
+            for(const std::weak_ptr<const Program>& entry: bucket) {
+                std::shared_ptr<const Program> image = entry.lock();
+
+                if(image && same(*image, *program)) {
+                    hits++;
+                    return image;
+                }
+            }
+
+            bucket.push_back(program);
+            entries++;
+            misses++;
+
+            if(++insertsSinceSweep >= entries) {
+                sweep();
+            }
+
+            return program;
+        }
+
+        ProgramCacheStats getStats() {
+            std::lock_guard<std::mutex> lock(mtx);
+            ProgramCacheStats stats = { 0, 0, hits, misses };
+
+            for(const auto& bucket: images) {
+                for(const std::weak_ptr<const Program>& entry: bucket.second) {
+                    std::shared_ptr<const Program> image = entry.lock();
+
+                    if(image) {
+                        stats.images++;
+                        stats.bytes += sizeof(Program) + image->code.capacity();
+                    }
+                }
+            }
+
+            return stats;
+        }
+};
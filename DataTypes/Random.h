@@ -0,0 +1,82 @@
+/*
+    This file defines the pseudo random generator used wherever the emulator draws random processes
+*/
+#pragma once
+#include <cstdint>
+
+// xoshiro256**, small and fast with a 2^256 period. Not thread safe, every thread that draws owns a
+// generator, and generators split from one seed with jump() never overlap.
+class Xoshiro256 {
+    private:
+        uint64_t s[4];
+
+        static uint64_t rotl(uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+    public:
+        Xoshiro256(uint64_t seed = 1) {
+            this->seed(seed);
+        }
+
+        // Expands the seed with splitmix64, so nearby seeds still start far apart
+        void seed(uint64_t seed) {
+            for(int i = 0; i < 4; i++) {
+                uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                s[i] = z ^ (z >> 31);
+            }
+        }
+
+        uint64_t next() {
+            uint64_t result = rotl(s[1] * 5, 7) * 9;
+            uint64_t t = s[1] << 17;
+
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = rotl(s[3], 45);
+            return result;
+        }
+
+        // Uniform in [0, bound), without modulo bias. bound must not be 0.
+        uint64_t below(uint64_t bound) {
+            uint64_t threshold = (0 - bound) % bound;
+            uint64_t r = next();
+
+            while(r < threshold) {
+                r = next();
+            }
+
+            return r % bound;
+        }
+
+        // Uniform in [0, 1)
+        double uniform() {
+            return (next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        // Advances by 2^128 draws, the usual way to give each thread its own stream
+        void jump() {
+            static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4528b1dc28ULL };
+            uint64_t t[4] = { 0, 0, 0, 0 };
+
+            for(int i = 0; i < 4; i++) {
+                for(int b = 0; b < 64; b++) {
+                    if(JUMP[i] & (1ULL << b)) {
+                        for(int j = 0; j < 4; j++) {
+                            t[j] ^= s[j];
+                        }
+                    }
+                    next();
+                }
+            }
+
+            for(int j = 0; j < 4; j++) {
+                s[j] = t[j];
+            }
+        }
+};
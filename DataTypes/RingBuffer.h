@@ -0,0 +1,54 @@
+/*
+    This file defines a fixed capacity single producer single consumer ring buffer
+*/
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+template <typename T, size_t Capacity>
+class RingBuffer {
+    static_assert((Capacity & (Capacity - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+    private:
+        T slots[Capacity];
+        alignas(64) std::atomic<size_t> head; // Next slot to read, written by the consumer only
+        alignas(64) std::atomic<size_t> tail; // Next slot to write, written by the producer only
+
+    public:
+        RingBuffer() {
+            head.store(0);
+            tail.store(0);
+        }
+
+        bool push(const T& item) {
+            size_t t = tail.load(std::memory_order_relaxed);
+
+            if(t - head.load(std::memory_order_acquire) == Capacity) {
+                return false; // Full
+            }
+
+            slots[t & (Capacity - 1)] = item;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T& item) {
+            size_t h = head.load(std::memory_order_relaxed);
+
+            if(h == tail.load(std::memory_order_acquire)) {
+                return false; // Empty
+            }
+
+            item = slots[h & (Capacity - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t size() {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+
+        size_t capacity() {
+            return Capacity;
+        }
+};
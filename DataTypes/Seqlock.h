@@ -0,0 +1,62 @@
+/*
+    This file defines a single writer sequence lock for publishing small metric blocks
+*/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock requires a trivially copyable type");
+
+    private:
+        static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        std::atomic<uint64_t> sequence;   // Odd while a write is in progress
+        std::atomic<uint64_t> words[WORDS];
+
+    public:
+        Seqlock() {
+            sequence.store(0);
+            write(T{});
+        }
+
+        // Only one thread may write at a time, readers never block the writer
+        void write(const T& value) {
+            uint64_t buffer[WORDS] = {};
+            memcpy(buffer, &value, sizeof(T));
+
+            uint64_t s = sequence.load(std::memory_order_relaxed);
+            sequence.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for(size_t i = 0; i < WORDS; i++) {
+                words[i].store(buffer[i], std::memory_order_relaxed);
+            }
+
+            sequence.store(s + 2, std::memory_order_release);
+        }
+
+        // Retries until it copies a version that was not overwritten mid-read
+        T read() {
+            uint64_t buffer[WORDS];
+            uint64_t before, after;
+
+            do {
+                before = sequence.load(std::memory_order_acquire);
+
+                for(size_t i = 0; i < WORDS; i++) {
+                    buffer[i] = words[i].load(std::memory_order_relaxed);
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = sequence.load(std::memory_order_relaxed);
+            } while((before & 1) || before != after);
+
+            T value;
+            memcpy(&value, buffer, sizeof(T));
+            return value;
+        }
+};
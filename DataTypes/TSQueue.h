@@ -1,6 +1,7 @@
 #pragma once
 
 #include <queue>
+#include <vector>
 #include <mutex>
 #include <chrono>
 #include <condition_variable>
@@ -8,7 +9,7 @@
 
 class TSQueue {
     private:
-        std::queue<Process*> queue;
+        std::queue<ProcessHandle> queue;
         std::mutex mtx;
         std::condition_variable cv;
 
@@ -19,8 +20,8 @@ class TSQueue {
             l.unlock();
         }
 
-        Process* peek() {
-            Process* p;
+        ProcessHandle peek() {
+            ProcessHandle p;
             std::unique_lock<std::mutex> l(mtx);
             cv.wait(l, [this] { return !queue.empty();});
 
@@ -31,14 +32,50 @@ class TSQueue {
             return p;   
         }
 
-        void push(Process* p) {
+        void push(ProcessHandle p) {
             std::unique_lock<std::mutex> l(mtx);
             queue.push(p);
             l.unlock();
             cv.notify_one();
         }
 
+        // One lock for the whole batch
+        void push(const std::vector<Process*>& processes) {
+            std::unique_lock<std::mutex> l(mtx);
+            for(Process* p : processes) {
+                queue.push(p->handle);
+            }
+            l.unlock();
+            cv.notify_all();
+        }
+
+        // Front first
+        std::vector<ProcessHandle> snapshot() {
+            std::lock_guard<std::mutex> l(mtx);
+            std::queue<ProcessHandle> copy = queue;
+            std::vector<ProcessHandle> handles;
+
+            while(!copy.empty()) {
+                handles.push_back(copy.front());
+                copy.pop();
+            }
+
+            return handles;
+        }
+
+        void replace(const std::vector<ProcessHandle>& handles) {
+            std::unique_lock<std::mutex> l(mtx);
+            queue = std::queue<ProcessHandle>(std::deque<ProcessHandle>(handles.begin(), handles.end()));
+            l.unlock();
+            cv.notify_all();
+        }
+
         bool isEmpty() {
             return queue.empty();
         }
+
+        size_t size() {
+            std::lock_guard<std::mutex> l(mtx);
+            return queue.size();
+        }
 };
\ No newline at end of file
@@ -0,0 +1,185 @@
+/*
+    This file defines the hierarchical timing wheel that holds sleeping processes until their wakeup tick
+*/
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Process.h"
+
+// Four levels of 64 slots, level l slot s holds the wakeups whose tick has s in bits 6l to 6l+5 and
+// matches the current tick above them. Ticks past the last level wait in an overflow list. Entries are
+// intrusive list nodes indexed by pid, so scheduling and cancelling are O(1). Every tick expires one
+// level 0 slot, and when a level's index wraps the next level's slot is spread over the levels below,
+// so advancing costs the wakeups due plus, amortised, a few moves per entry, however many sleep.
+class TimingWheel {
+    private:
+        static const int LEVEL_BITS = 6;
+        static const int SLOTS = 1 << LEVEL_BITS;
+        static const int LEVELS = 4;
+        static const int OVERFLOW_BUCKET = LEVELS * SLOTS;
+        static const uint32_t NONE = UINT32_MAX;
+
+        struct Node {
+            uint32_t prev;
+            uint32_t next;
+            uint32_t generation;
+            int32_t bucket;     // -1 while not scheduled
+            long long tick;
+        };
+
+        std::vector<Node> nodes;
+        uint32_t heads[OVERFLOW_BUCKET + 1];
+        long long now;          // Every wakeup at or before now has been returned
+        size_t count;
+
+        void link(uint32_t pid, int bucket) {
+            Node& node = nodes[pid];
+            node.bucket = bucket;
+            node.prev = NONE;
+            node.next = heads[bucket];
+
+            if(heads[bucket] != NONE) {
+                nodes[heads[bucket]].prev = pid;
+            }
+            heads[bucket] = pid;
+        }
+
+        void unlink(uint32_t pid) {
+            Node& node = nodes[pid];
+
+            if(node.prev != NONE) {
+                nodes[node.prev].next = node.next;
+            } else {
+                heads[node.bucket] = node.next;
+            }
+
+            if(node.next != NONE) {
+                nodes[node.next].prev = node.prev;
+            }
+
+            node.bucket = -1;
+        }
+
+        // The lowest level whose parent window holds both now and the tick, which is always ahead of now
+        void place(uint32_t pid) {
+            long long tick = nodes[pid].tick;
+
+            for(int level = 0; level < LEVELS; level++) {
+                int shift = LEVEL_BITS * (level + 1);
+
+                if((tick >> shift) == (now >> shift)) {
+                    link(pid, level * SLOTS + (int) ((tick >> (LEVEL_BITS * level)) & (SLOTS - 1)));
+                    return;
+                }
+            }
+
+            link(pid, OVERFLOW_BUCKET);
+        }
+
+        void cascade(int bucket) {
+            uint32_t pid = heads[bucket];
+            heads[bucket] = NONE;
+
+            while(pid != NONE) {
+                uint32_t next = nodes[pid].next;
+                place(pid);
+                pid = next;
+            }
+        }
+
+    public:
+        TimingWheel() {
+            reset(0);
+        }
+
+        // Drops every wakeup and starts counting at tick
+        void reset(long long tick) {
+            for(uint32_t& head: heads) {
+                head = NONE;
+            }
+
+            for(Node& node: nodes) {
+                node.bucket = -1;
+            }
+
+            now = tick;
+            count = 0;
+        }
+
+        // Wakes the process on the first advance to tick, or on the next one if tick has passed.
+        // Replaces an earlier wakeup of the same slot.
+        void schedule(ProcessHandle handle, long long tick) {
+            if(handle.pid >= nodes.size()) {
+                nodes.resize(handle.pid + 1, { NONE, NONE, 0, -1, 0 });
+            }
+
+            cancel(handle.pid);
+            nodes[handle.pid].generation = handle.generation;
+            nodes[handle.pid].tick = tick > now ? tick : now + 1;
+            place(handle.pid);
+            count++;
+        }
+
+        void cancel(uint32_t pid) {
+            if(pid < nodes.size() && nodes[pid].bucket != -1) {
+                unlink(pid);
+                count--;
+            }
+        }
+
+        // Moves now up to tick, one tick at a time, appending every process due on the way
+        void advance(long long tick, std::vector<ProcessHandle>& woken) {
+            while(now < tick) {
+                now++;
+
+                //Every level whose window starts now is spread, the upper ones first as their entries may
+                //land in the lower slots spread next
+                if((now & (SLOTS - 1)) == 0) {
+                    int level = 1;
+                    while(level < LEVELS && ((now >> (LEVEL_BITS * level)) & (SLOTS - 1)) == 0) {
+                        level++;
+                    }
+
+                    if(level == LEVELS) {
+                        cascade(OVERFLOW_BUCKET);
+                        level--;
+                    }
+
+                    for(; level >= 1; level--) {
+                        cascade(level * SLOTS + (int) ((now >> (LEVEL_BITS * level)) & (SLOTS - 1)));
+                    }
+                }
+
+                int bucket = (int) (now & (SLOTS - 1));
+                uint32_t pid = heads[bucket];
+                heads[bucket] = NONE;
+
+                while(pid != NONE) {
+                    Node& node = nodes[pid];
+                    uint32_t next = node.next;
+
+                    node.bucket = -1;
+                    count--;
+                    woken.push_back({ pid, node.generation });
+                    pid = next;
+                }
+            }
+        }
+
+        // Every scheduled wakeup, for checkpoints
+        std::vector<std::pair<ProcessHandle, long long>> entries() {
+            std::vector<std::pair<ProcessHandle, long long>> scheduled;
+
+            for(uint32_t pid = 0; pid < nodes.size(); pid++) {
+                if(nodes[pid].bucket != -1) {
+                    scheduled.push_back({ { pid, nodes[pid].generation }, nodes[pid].tick });
+                }
+            }
+
+            return scheduled;
+        }
+
+        size_t size() {
+            return count;
+        }
+};
@@ -0,0 +1,44 @@
+/*
+    This file defines the on-disk binary trace format shared by the Tracer and the TraceAnalyzer tool
+*/
+#pragma once
+#include <cstdint>
+
+enum TraceEvent : uint8_t {
+    TRACE_ARRIVE,   // arg = total instructions
+    TRACE_DISPATCH, // arg = current instruction
+    TRACE_PREEMPT,  // arg = current instruction
+    TRACE_COMPLETE, // arg = current instruction
+    TRACE_ALLOCATE, // arg = bytes allocated
+    TRACE_FREE,     // arg = bytes freed
+    TRACE_EVICT,    // arg = bytes swapped out to the backing store
+    TRACE_SWAP_IN,  // arg = bytes swapped in from the backing store
+    TRACE_SLEEP,    // arg = ticks asked for, the process leaves its core
+    TRACE_WAKE,     // arg = current instruction, the process is back in the ready queue
+    TRACE_IO_SUBMIT,// arg = device << 32 | units, the process leaves its core
+    TRACE_IO_DONE   // arg = device, raised on the issuing core, the process is back in the ready queue
+};
+
+const char TRACE_MAGIC[8] = { 'C', 'S', 'O', 'T', 'R', 'A', 'C', 'E' };
+const uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numCores;
+    uint64_t memorySize;
+    uint64_t frameSize;     // Equal to memorySize for the flat allocator
+    uint64_t recordCount;   // Filled in when the trace is stopped
+};
+
+struct TraceRecord {
+    uint64_t tick;
+    uint64_t arg;
+    int32_t pid;
+    int16_t core;           // -1 when the event is not tied to a core
+    uint8_t event;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 40, "TraceHeader layout changed");
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord layout changed");
@@ -0,0 +1,29 @@
+/*
+    This file defines the binary workload format read by workload replay and written by workload record
+*/
+#pragma once
+#include <cstdint>
+
+const char WORKLOAD_MAGIC[8] = { 'C', 'S', 'O', 'W', 'O', 'R', 'K', 'L' };
+const uint32_t WORKLOAD_VERSION = 1;
+const int WORKLOAD_NAME_SIZE = 32;
+
+struct WorkloadHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t recordCount;   // Filled in when recording stops, readers go by the file size
+};
+
+// One arrival, ticks count from the start of the replay
+struct WorkloadRecord {
+    uint64_t tick;
+    uint64_t instructions;
+    uint64_t memory;
+    int32_t priority;
+    uint32_t reserved;
+    char name[WORKLOAD_NAME_SIZE];  // NUL terminated, longer names are cut
+};
+
+static_assert(sizeof(WorkloadHeader) == 24, "WorkloadHeader layout changed");
+static_assert(sizeof(WorkloadRecord) == 64, "WorkloadRecord layout changed");
@@ -0,0 +1,246 @@
+/*
+    This file defines host CPU topology discovery and pinning of the simulation threads to host CPUs
+*/
+#pragma once
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+enum AffinityMode {
+    AFFINITY_NONE,      // Leave placement to the host scheduler
+    AFFINITY_MANUAL,    // Only the CPUs given in config.txt
+    AFFINITY_NUMA,      // Pack every thread onto one NUMA node
+    AFFINITY_L3         // Pack every thread onto CPUs sharing one L3 cache
+};
+
+const char* AFFINITY_MODE_NAMES[] = { "none", "manual", "numa", "l3" };
+
+// Host CPUs chosen for the simulation threads, -1 leaves a thread unpinned
+struct AffinityPlan {
+    AffinityMode mode = AFFINITY_NONE;
+    int domain = -1;            // NUMA node or L3 domain picked by the automatic modes
+    int clockCpu = -1;
+    int schedulerCpu = -1;
+    std::vector<int> coreCpus;
+};
+
+// Parses a Linux style CPU list such as "0-3,8,10-11"
+inline bool parseCpuList(const std::string& list, std::vector<int>& cpus) {
+    std::vector<int> parsed;
+    size_t pos = 0;
+
+    while(pos < list.size()) {
+        size_t comma = list.find(',', pos);
+        std::string range = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? list.size() : comma + 1;
+
+        char* end;
+        long first = std::strtol(range.c_str(), &end, 10);
+        long last = first;
+
+        if(end == range.c_str()) {
+            return false;
+        }
+
+        if(*end == '-') {
+            const char* start = end + 1;
+            last = std::strtol(start, &end, 10);
+
+            if(end == start) {
+                return false;
+            }
+        }
+
+        if(*end != '\0' || first < 0 || last < first || last >= 4096) {
+            return false;
+        }
+
+        for(long cpu = first; cpu <= last; cpu++) {
+            parsed.push_back((int) cpu);
+        }
+    }
+
+    if(parsed.empty()) {
+        return false;
+    }
+
+    cpus = parsed;
+    return true;
+}
+
+#ifdef _WIN32
+inline std::vector<int> cpusInMask(ULONG_PTR mask) {
+    std::vector<int> cpus;
+
+    for(int cpu = 0; cpu < (int) sizeof(ULONG_PTR) * 8; cpu++) {
+        if(mask & ((ULONG_PTR) 1 << cpu)) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+// Only processor group 0 is reported, which covers the first 64 host CPUs
+inline std::vector<std::vector<int>> getCpuDomains(AffinityMode mode) {
+    std::vector<std::vector<int>> domains;
+    DWORD length = 0;
+    GetLogicalProcessorInformation(nullptr, &length);
+
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if(info.empty() || !GetLogicalProcessorInformation(info.data(), &length)) {
+        return domains;
+    }
+
+    for(const auto& entry: info) {
+        bool numaNode = mode == AFFINITY_NUMA && entry.Relationship == RelationNumaNode;
+        bool l3Cache = mode == AFFINITY_L3 && entry.Relationship == RelationCache && entry.Cache.Level == 3;
+
+        if(numaNode || l3Cache) {
+            domains.push_back(cpusInMask(entry.ProcessorMask));
+        }
+    }
+
+    return domains;
+}
+#else
+inline bool readCpuListFile(const std::string& path, std::vector<int>& cpus) {
+    std::ifstream file(path);
+    std::string list;
+
+    if(!file || !std::getline(file, list)) {
+        return false;
+    }
+
+    return parseCpuList(list, cpus);
+}
+
+// Reads the NUMA nodes or L3 sharing groups from sysfs, empty when the host does not expose them
+inline std::vector<std::vector<int>> getCpuDomains(AffinityMode mode) {
+    std::vector<std::vector<int>> domains;
+    std::vector<int> cpus;
+
+    if(mode == AFFINITY_NUMA) {
+        for(int node = 0; node < 1024; node++) {
+            if(readCpuListFile("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", cpus)) {
+                domains.push_back(cpus);
+            }
+        }
+
+        return domains;
+    }
+
+    std::vector<int> online;
+    if(!readCpuListFile("/sys/devices/system/cpu/online", online)) {
+        return domains;
+    }
+
+    for(int cpu: online) {
+        std::string cache = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache/index";
+
+        for(int index = 0; index < 8; index++) {
+            std::ifstream level(cache + std::to_string(index) + "/level");
+            int value = 0;
+
+            if(!level) {
+                break;
+            }
+
+            if(level >> value && value == 3 && readCpuListFile(cache + std::to_string(index) + "/shared_cpu_list", cpus)) {
+                if(std::find(domains.begin(), domains.end(), cpus) == domains.end()) {
+                    domains.push_back(cpus);
+                }
+                break;
+            }
+        }
+    }
+
+    return domains;
+}
+#endif
+
+// Returns false when the host refused the placement or pinning is not supported
+inline bool pinThread(std::thread& t, int cpu) {
+    if(cpu < 0) {
+        return false;
+    }
+
+#ifdef _WIN32
+    if(cpu >= (int) sizeof(DWORD_PTR) * 8) {
+        return false;
+    }
+
+    return SetThreadAffinityMask(t.native_handle(), (DWORD_PTR) 1 << cpu) != 0;
+#elif defined(__linux__)
+    if(cpu >= CPU_SETSIZE) {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+// CPUs set explicitly always win, the automatic modes fill in the rest from a single domain
+inline AffinityPlan planAffinity(AffinityMode mode, int numCores, int clockCpu, int schedulerCpu, const std::vector<int>& coreCpus) {
+    AffinityPlan plan;
+    plan.mode = mode;
+    plan.coreCpus.assign(numCores, -1);
+
+    if(mode == AFFINITY_NUMA || mode == AFFINITY_L3) {
+        std::vector<std::vector<int>> domains = getCpuDomains(mode);
+        size_t needed = numCores + 2;
+
+        //First domain that fits every thread, otherwise the largest one with threads sharing CPUs
+        for(size_t i = 0; i < domains.size(); i++) {
+            if(plan.domain == -1 || (domains[plan.domain].size() < needed && domains[i].size() > domains[plan.domain].size())) {
+                plan.domain = (int) i;
+            }
+        }
+
+        if(plan.domain != -1) {
+            const std::vector<int>& cpus = domains[plan.domain];
+            plan.clockCpu = cpus[0];
+            plan.schedulerCpu = cpus[1 % cpus.size()];
+
+            for(int i = 0; i < numCores; i++) {
+                plan.coreCpus[i] = cpus[(i + 2) % cpus.size()];
+            }
+        }
+    }
+
+    if(clockCpu != -1) {
+        plan.clockCpu = clockCpu;
+    }
+
+    if(schedulerCpu != -1) {
+        plan.schedulerCpu = schedulerCpu;
+    }
+
+    //A list shorter than num-cpu is reused from the start
+    for(int i = 0; i < numCores && !coreCpus.empty(); i++) {
+        plan.coreCpus[i] = coreCpus[i % coreCpus.size()];
+    }
+
+    return plan;
+}
@@ -0,0 +1,129 @@
+/*
+    This file defines the arrival models scheduler-test draws random processes from
+*/
+#pragma once
+#include <cmath>
+#include <string>
+#include "../DataTypes/Random.h"
+
+enum ArrivalKind {
+    ARRIVAL_FIXED,      // A batch every batch-process-freq ticks
+    ARRIVAL_POISSON,    // Batches at a constant mean rate
+    ARRIVAL_BURSTY,     // Poisson while on, nothing while off
+    ARRIVAL_DIURNAL     // Poisson with a rate that ramps from 0 to the peak and back every period
+};
+
+const char* ARRIVAL_KIND_NAMES[] = { "fixed", "poisson", "bursty", "diurnal" };
+
+struct ArrivalSettings {
+    ArrivalKind kind = ARRIVAL_FIXED;
+    double rate = 0;            // Mean batches per tick (the peak for diurnal), 0 follows batch-process-freq
+    long long batch = 1;        // Processes per batch, all enqueued at once
+    long long burstOn = 100;    // Ticks
+    long long burstOff = 100;
+    long long period = 10000;
+};
+
+class ArrivalModel {
+    private:
+        ArrivalSettings settings;
+        double rate;
+        long long frequency;
+        double nextBatch;   // Elapsed ticks, fractional, at which the next candidate batch arrives
+
+        double gap(Xoshiro256& rng) {
+            return -std::log(1.0 - rng.uniform()) / rate;
+        }
+
+        // Thinning, candidates come at the full rate and are kept at the model's rate for that moment
+        bool keep(double at, Xoshiro256& rng) {
+            if(settings.kind == ARRIVAL_BURSTY) {
+                return (long long) at % (settings.burstOn + settings.burstOff) < settings.burstOn;
+            }
+
+            if(settings.kind == ARRIVAL_DIURNAL) {
+                double level = (1.0 - std::cos(6.283185307179586 * at / settings.period)) / 2.0;
+                return rng.uniform() < level;
+            }
+
+            return true;
+        }
+
+    public:
+        ArrivalModel() {
+            rate = 1;
+            frequency = 1;
+            nextBatch = -1;
+        }
+
+        void configure(const ArrivalSettings& settings, long long frequency) {
+            this->settings = settings;
+            this->frequency = frequency;
+            this->rate = settings.rate > 0 ? settings.rate : 1.0 / frequency;
+            reset();
+        }
+
+        // Starts over at elapsed tick 0
+        void reset() {
+            nextBatch = -1;
+        }
+
+        // Processes arriving during the given tick, counted from the start of scheduler-test
+        long long arrivalsAt(long long elapsed, Xoshiro256& rng) {
+            if(settings.kind == ARRIVAL_FIXED) {
+                return elapsed % frequency == 0 ? settings.batch : 0;
+            }
+
+            if(nextBatch < 0) {
+                nextBatch = elapsed + gap(rng);
+            }
+
+            long long batches = 0;
+            while(nextBatch < elapsed + 1) {
+                if(keep(nextBatch, rng)) {
+                    batches++;
+                }
+                nextBatch += gap(rng);
+            }
+
+            return batches * settings.batch;
+        }
+
+        std::string describe() {
+            std::string text = ARRIVAL_KIND_NAMES[settings.kind];
+
+            if(settings.kind == ARRIVAL_FIXED) {
+                text += ", every " + std::to_string(frequency) + " ticks";
+            } else {
+                text += ", " + std::to_string(rate) + (settings.kind == ARRIVAL_DIURNAL ? " peak" : "") + " batches/tick";
+            }
+
+            if(settings.kind == ARRIVAL_BURSTY) {
+                text += ", " + std::to_string(settings.burstOn) + " ticks on, " + std::to_string(settings.burstOff) + " off";
+            } else if(settings.kind == ARRIVAL_DIURNAL) {
+                text += ", period " + std::to_string(settings.period) + " ticks";
+            }
+
+            return text + ", batch " + std::to_string(settings.batch);
+        }
+};
+
+// Uniform in [min, max]
+inline long long drawInstructions(Xoshiro256& rng, long long min, long long max) {
+    return max > min ? min + (long long) rng.below(max - min + 1) : min;
+}
+
+inline int floorLog2(unsigned long long value) {
+    int bits = 0;
+    while(value >>= 1) {
+        bits++;
+    }
+    return bits;
+}
+
+// A power of two between the powers of two at or below min and max
+inline long long drawMemorySize(Xoshiro256& rng, long long min, long long max) {
+    int low = floorLog2(min);
+    int high = floorLog2(max);
+    return 1LL << (high > low ? low + (int) rng.below(high - low + 1) : low);
+}
@@ -8,31 +8,35 @@
 
 class BackingStore {
     private:
-        std::map<std::string, std::string> bsDirectory;
-        const std::string dirPrefix = ".\\BackingStore\\"; 
-        std::filesystem::path directory = ".\\BackingStore\\";
+        std::map<uint32_t, std::string> bsDirectory; // Keyed by pid
+        std::filesystem::path directory;
         uint64_t pagedInCount;
         uint64_t pagedOutCount;  
         bool isPagingAllocator;
         uint64_t pageSize; 
         std::mutex mtx;
         
-        bool isIn(std::string name) {
-            return bsDirectory.find(name) != bsDirectory.end();
+        bool isIn(uint32_t pid) {
+            return bsDirectory.find(pid) != bsDirectory.end();
         }
 
     public:
         BackingStore() {
+            this->pagedInCount = 0;
+            this->pagedOutCount = 0;
+        }
+
+        // Starts from an empty directory, each system keeps its own
+        void open(const std::filesystem::path& directory) {
+            this->directory = directory;
+
             if (std::filesystem::exists(directory)) {
                 std::filesystem::remove_all(directory); 
             } 
 
-            std::filesystem::create_directory(directory); 
-            FILE* f = fopen(".\\BackingStore\\.gitkeep", "w");
+            std::filesystem::create_directories(directory); 
+            FILE* f = fopen((directory / ".gitkeep").string().c_str(), "w");
             fclose(f);
-
-            this->pagedInCount = 0;
-            this->pagedOutCount = 0;
         }
 
         void init(bool isPaging, uint64_t size = 0) {
@@ -45,14 +49,14 @@ class BackingStore {
             }
         }
 
-        uint64_t retrieve(std::string process_name) {
+        uint64_t retrieve(uint32_t pid) {
             std::lock_guard<std::mutex> l(mtx);
 
-            if(!isIn(process_name)) {
+            if(!isIn(pid)) {
                 return 0;
             }
 
-            std::string backingStorePath = bsDirectory[process_name];
+            std::string backingStorePath = bsDirectory[pid];
             std::ifstream inputFile(backingStorePath); 
 
             if (!inputFile) {
@@ -70,14 +74,14 @@ class BackingStore {
 
             inputFile.close();
 
-            bsDirectory.erase(process_name);
+            bsDirectory.erase(pid);
 
             return size;
         }
 
         void store(Process* p) {
             std::lock_guard<std::mutex> l(mtx);
-            std::string backingStorePath = dirPrefix + p->name + ".txt";
+            std::string backingStorePath = (directory / (p->name + ".txt")).string();
             FILE* f = fopen(backingStorePath.c_str(), "w");
             fprintf(f, "%lld", p->memoryRequired);
             fclose(f);
@@ -88,7 +92,42 @@ class BackingStore {
                 this->pagedOutCount += 1;
             }
 
-            bsDirectory.insert({p->name, backingStorePath});
+            bsDirectory.insert({p->handle.pid, backingStorePath});
+        }
+
+        // Size of every swapped out process, keyed by pid
+        std::map<uint32_t, uint64_t> exportSizes() {
+            std::lock_guard<std::mutex> l(mtx);
+            std::map<uint32_t, uint64_t> sizes;
+
+            for (const auto& entry: bsDirectory) {
+                std::ifstream inputFile(entry.second);
+                uint64_t size = 0;
+
+                if (inputFile >> size) {
+                    sizes.insert({entry.first, size});
+                }
+            }
+
+            return sizes;
+        }
+
+        // Replaces the contents with one file per swapped out process
+        void importSizes(const std::map<uint32_t, uint64_t>& sizes, const std::map<uint32_t, std::string>& names, uint64_t pagedIn, uint64_t pagedOut) {
+            std::lock_guard<std::mutex> l(mtx);
+            open(directory);
+            bsDirectory.clear();
+
+            for (const auto& entry: sizes) {
+                std::string backingStorePath = (directory / (names.at(entry.first) + ".txt")).string();
+                FILE* f = fopen(backingStorePath.c_str(), "w");
+                fprintf(f, "%llu", (unsigned long long) entry.second);
+                fclose(f);
+                bsDirectory.insert({entry.first, backingStorePath});
+            }
+
+            this->pagedInCount = pagedIn;
+            this->pagedOutCount = pagedOut;
         }
 
         uint64_t getPagedIn() {
@@ -0,0 +1,538 @@
+/*
+    This file defines checkpoint and restore of the emulator state: the process table, ready queue, sleeping
+    processes, device queues, cores, memory layout, backing store and the programs processes run
+*/
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_set>
+#include "../DataTypes/CheckpointRecord.h"
+#include "../DataTypes/MappedFile.h"
+#include "../DataTypes/ProcessTable.h"
+#include "../DataTypes/ProgramCache.h"
+#include "Core.h"
+#include "Scheduler.h"
+#include "Tester.h"
+#include "LogWriter.h"
+#include "MemoryInterface.h"
+#include "IoDevice.h"
+
+// What a checkpoint covers, and the config it is only valid for
+struct CheckpointTargets {
+    ProcessTable* processes;
+    Scheduler* scheduler;
+    std::vector<Core*>* cores;
+    AbstractMemoryInterface* memory;
+    Tester* tester;
+    LogWriter* logWriter;
+    IoController* io;
+    ProgramCache* programs;         // Restored images are shared with the ones generated afterwards
+    std::atomic<long long>* clock;
+    long long quantumCycles;
+    long long delayPerExec;
+    int algorithm;
+};
+
+// Marks where each instruction starts, false unless the code decodes instruction by instruction up to
+// an OP_HALT at its end, so a restored program cannot run off its code or reach an unknown opcode
+inline bool decodeProgram(const uint8_t* code, uint32_t length, std::vector<bool>& starts) {
+    uint32_t pc = 0;
+    starts.assign(length, false);
+
+    while(pc < length) {
+        if(code[pc] >= OP_COUNT || OPCODE_LENGTHS[code[pc]] > length - pc) {
+            return false;
+        }
+
+        starts[pc] = true;
+        if(code[pc] == OP_HALT) {
+            return pc + 1 == length;
+        }
+        pc += OPCODE_LENGTHS[code[pc]];
+    }
+
+    return false;
+}
+
+// Both run on the clock thread between two ticks, through SynchronizedClock::runBetweenTicks, so
+// nothing else touches the state while it is read or replaced
+
+inline bool saveCheckpoint(const std::string& path, const CheckpointTargets& t, std::string& error) {
+    CheckpointHeader header = {};
+    SchedulerMetrics schedulerMetrics = t.scheduler->getMetrics();
+    MemoryStats memoryStats = t.memory->getMemoryStats();
+    std::vector<ProcessHandle> ready = t.scheduler->getReadyQueue();
+    std::vector<MemoryBlock> blocks = t.memory->exportLayout();
+    std::vector<uint32_t> evictablePids = t.memory->exportEvictable();
+    std::map<uint32_t, uint64_t> swapped = t.memory->exportSwapped();
+    std::vector<std::pair<ProcessHandle, long long>> sleepers = t.scheduler->getSleepers();
+    std::vector<IoRequest> ioRequests = t.io->exportRequests();
+    uint32_t slotCount = t.processes->getSlotCount();
+    std::vector<bool> evictable(slotCount, false);
+    std::vector<CheckpointProcess> records(slotCount);
+    std::string strings;
+    std::map<const Program*, uint32_t> programIndex;
+    std::vector<CheckpointProgram> programs;
+    std::vector<uint8_t> code;
+
+    for(uint32_t pid: evictablePids) {
+        if(pid < slotCount) {
+            evictable[pid] = true;
+        }
+    }
+
+    for(uint32_t pid = 0; pid < slotCount; pid++) {
+        CheckpointProcess& r = records[pid];
+        Process* p = t.processes->at(pid);
+
+        r.pid = INVALID_PID;
+        r.generation = t.processes->generationAt(pid);
+
+        if(p == nullptr) {
+            continue;
+        }
+
+        r.pid = pid;
+        r.id = p->id;
+        r.core = p->core;
+        r.currentInstruction = p->current_instruction;
+        r.totalInstructions = p->total_instructions;
+        r.memoryRequired = p->memoryRequired;
+        r.age = (int64_t) p->age;
+        r.arrivalTick = p->arrivalTick;
+        r.firstDispatchTick = p->firstDispatchTick;
+        r.completionTick = p->completionTick;
+        r.waitingTicks = p->waitingTicks;
+        r.memoryBlockedTicks = p->memoryBlockedTicks;
+        r.preemptions = p->preemptions;
+        r.swaps = p->swaps;
+        r.readySinceTick = p->readySinceTick;
+        r.memoryBlockedSinceTick = p->memoryBlockedSinceTick;
+        r.ioBlockedTicks = p->ioBlockedTicks;
+        r.ioSinceTick = p->ioSinceTick;
+        r.nameOffset = strings.size();
+        r.nameLength = p->name.size();
+        r.timestampLength = p->timestamp.size();
+        r.priority = p->priority;
+        r.completed = p->completed;
+        r.evictable = evictable[pid];
+        r.sleepRequest = (uint16_t) p->sleepRequest;
+        r.ioDevice = p->ioDevice;
+        r.ioUnits = (uint32_t) p->ioUnits;
+        r.program = UINT32_MAX;
+        strings += p->name;
+        strings += p->timestamp;
+
+        if(!p->program) {
+            continue;
+        }
+
+        //Processes sharing an image share its record
+        auto image = programIndex.find(p->program.get());
+        if(image == programIndex.end()) {
+            image = programIndex.insert({ p->program.get(), (uint32_t) programs.size() }).first;
+            programs.push_back({ p->program->cycles, code.size(), (uint32_t) p->program->code.size(), p->program->variables });
+            code.insert(code.end(), p->program->code.begin(), p->program->code.end());
+        }
+
+        r.program = image->second;
+        r.pc = p->context.pc;
+        r.depth = p->context.depth;
+        for(int i = 0; i < PROGRAM_MAX_DEPTH; i++) {
+            r.loops[i] = { p->context.loops[i].body, p->context.loops[i].left };
+        }
+        memcpy(r.variables, p->context.variables, sizeof(r.variables));
+    }
+
+    std::vector<CheckpointCore> cores;
+    for(Core* core: *t.cores) {
+        CoreSnapshot snapshot = core->saveState();
+        CheckpointCore c = {};
+
+        c.pid = snapshot.active ? snapshot.process->handle.pid : INVALID_PID;
+        c.generation = snapshot.active ? snapshot.process->handle.generation : 0;
+        c.remaining = snapshot.remaining;
+        c.delayCounter = snapshot.delayCounter;
+        c.quantumCountdown = snapshot.quantumCountdown;
+        c.activeTicks = snapshot.activeTicks;
+        c.active = snapshot.active;
+        c.completed = snapshot.completed;
+        c.preempt = snapshot.preempt;
+        c.block = snapshot.block;
+        cores.push_back(c);
+    }
+
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.numCores = t.cores->size();
+    header.tick = t.clock->load();
+    header.memorySize = t.memory->getMemorySize();
+    header.frameSize = t.memory->getFrameSize();
+    header.quantumCycles = t.quantumCycles;
+    header.delayPerExec = t.delayPerExec;
+    header.algorithm = t.algorithm;
+    header.nextProcessId = t.processes->getNextId();
+    header.testerProcessCounter = t.tester->getProcessCounter();
+    header.dispatches = schedulerMetrics.dispatches;
+    header.preemptions = schedulerMetrics.preemptions;
+    header.completions = schedulerMetrics.completions;
+    header.memoryRequeues = schedulerMetrics.memoryRequeues;
+    header.sleeps = schedulerMetrics.sleeps;
+    header.ioRequests = schedulerMetrics.ioRequests;
+    header.interrupts = schedulerMetrics.interrupts;
+    header.overlapTicks = schedulerMetrics.overlapTicks;
+    header.pagedIn = memoryStats.pagedInCount;
+    header.pagedOut = memoryStats.pagedOutCount;
+    header.slotCount = slotCount;
+    header.readyCount = ready.size();
+    header.blockCount = blocks.size();
+    header.swappedCount = swapped.size();
+    header.sleeperCount = sleepers.size();
+    header.ioCount = ioRequests.size();
+    header.programCount = programs.size();
+    header.stringBytes = strings.size();
+    header.codeBytes = code.size();
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if(f == nullptr) {
+        error = "could not create " + path;
+        return false;
+    }
+
+    setvbuf(f, nullptr, _IOFBF, 1 << 20);
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(records.data(), sizeof(CheckpointProcess), records.size(), f);
+    fwrite(cores.data(), sizeof(CheckpointCore), cores.size(), f);
+
+    for(const ProcessHandle& handle: ready) {
+        CheckpointHandle h = { handle.pid, handle.generation };
+        fwrite(&h, sizeof(h), 1, f);
+    }
+
+    for(const MemoryBlock& block: blocks) {
+        CheckpointBlock b = { block.startAddress, block.size, block.owningPid, block.freeRank };
+        fwrite(&b, sizeof(b), 1, f);
+    }
+
+    for(const auto& entry: swapped) {
+        CheckpointSwapped s = { entry.first, 0, entry.second };
+        fwrite(&s, sizeof(s), 1, f);
+    }
+
+    for(const auto& entry: sleepers) {
+        CheckpointSleeper s = { entry.first.pid, entry.first.generation, entry.second };
+        fwrite(&s, sizeof(s), 1, f);
+    }
+
+    for(const IoRequest& request: ioRequests) {
+        CheckpointIoRequest r = { request.handle.pid, request.handle.generation, request.device, request.core,
+                                  request.units, request.submitTick, request.finishTick };
+        fwrite(&r, sizeof(r), 1, f);
+    }
+
+    fwrite(programs.data(), sizeof(CheckpointProgram), programs.size(), f);
+    fwrite(strings.data(), 1, strings.size(), f);
+    fwrite(code.data(), 1, code.size(), f);
+
+    if(fclose(f) != 0) {
+        error = "could not write " + path;
+        return false;
+    }
+
+    return true;
+}
+
+// Checks the whole file before anything is replaced, a rejected checkpoint leaves the system as it was
+inline bool restoreCheckpoint(const std::string& path, const CheckpointTargets& t, long long& savedTick, std::string& error) {
+    MappedFile file;
+
+    if(!file.openRead(path)) {
+        error = "could not open " + path;
+        return false;
+    }
+
+    if(file.size() < sizeof(CheckpointHeader) || memcmp(file.data(), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+        error = path + " is not a checkpoint";
+        return false;
+    }
+
+    const CheckpointHeader& h = *(const CheckpointHeader*) file.data();
+
+    if(h.version != CHECKPOINT_VERSION) {
+        error = path + " has an unsupported version";
+        return false;
+    }
+
+    if(h.numCores != t.cores->size() || h.memorySize != t.memory->getMemorySize() || h.frameSize != t.memory->getFrameSize() ||
+       h.quantumCycles != t.quantumCycles || h.delayPerExec != t.delayPerExec || h.algorithm != t.algorithm) {
+        error = "the checkpoint was taken with a different num-cpu, scheduler, quantum-cycles, delays-per-exec or memory config";
+        return false;
+    }
+
+    if(t.tester->isActive()) {
+        error = "scheduler-test is running";
+        return false;
+    }
+
+    //Counts are bounded by the file size before they are multiplied, so the sum cannot overflow
+    uint64_t remaining = file.size() - sizeof(CheckpointHeader);
+    uint64_t expected = 0;
+    const uint64_t counts[] = { h.slotCount, h.numCores, h.readyCount, h.blockCount, h.swappedCount, h.sleeperCount, h.ioCount,
+                                h.programCount, h.stringBytes, h.codeBytes };
+    const uint64_t sizes[] = { sizeof(CheckpointProcess), sizeof(CheckpointCore), sizeof(CheckpointHandle), sizeof(CheckpointBlock),
+                               sizeof(CheckpointSwapped), sizeof(CheckpointSleeper), sizeof(CheckpointIoRequest),
+                               sizeof(CheckpointProgram), 1, 1 };
+
+    for(int i = 0; i < 10; i++) {
+        if(counts[i] > remaining / sizes[i]) {
+            expected = UINT64_MAX;
+            break;
+        }
+        expected += counts[i] * sizes[i];
+    }
+
+    if(expected != remaining || h.slotCount > ProcessTable::getCapacity()) {
+        error = path + " is truncated or corrupt";
+        return false;
+    }
+
+    const CheckpointProcess* records = (const CheckpointProcess*) (file.data() + sizeof(CheckpointHeader));
+    const CheckpointCore* cores = (const CheckpointCore*) (records + h.slotCount);
+    const CheckpointHandle* ready = (const CheckpointHandle*) (cores + h.numCores);
+    const CheckpointBlock* blocks = (const CheckpointBlock*) (ready + h.readyCount);
+    const CheckpointSwapped* swapped = (const CheckpointSwapped*) (blocks + h.blockCount);
+    const CheckpointSleeper* sleepers = (const CheckpointSleeper*) (swapped + h.swappedCount);
+    const CheckpointIoRequest* ioRequests = (const CheckpointIoRequest*) (sleepers + h.sleeperCount);
+    const CheckpointProgram* programs = (const CheckpointProgram*) (ioRequests + h.ioCount);
+    const char* strings = (const char*) (programs + h.programCount);
+    const uint8_t* code = (const uint8_t*) (strings + h.stringBytes);
+
+    auto isLive = [&](uint32_t pid) {
+        return pid < h.slotCount && records[pid].pid == pid;
+    };
+
+    std::unordered_set<std::string> names;
+    for(uint64_t pid = 0; pid < h.slotCount; pid++) {
+        const CheckpointProcess& r = records[pid];
+
+        if(r.pid == INVALID_PID) {
+            continue;
+        }
+
+        if(r.pid != pid || r.nameLength == 0 || r.nameOffset > h.stringBytes ||
+           (uint64_t) r.nameLength + r.timestampLength > h.stringBytes - r.nameOffset ||
+           r.core < -1 || r.core >= (int32_t) h.numCores ||
+           !names.insert(std::string(strings + r.nameOffset, r.nameLength)).second) {
+            error = path + " has an invalid process in slot " + std::to_string(pid);
+            return false;
+        }
+    }
+
+    std::vector<std::vector<bool>> starts(h.programCount);
+    for(uint64_t i = 0; i < h.programCount; i++) {
+        const CheckpointProgram& program = programs[i];
+
+        if(program.codeOffset > h.codeBytes || program.codeLength > h.codeBytes - program.codeOffset || program.cycles < 0 ||
+           program.variables < 0 || program.variables > PROGRAM_MAX_VARIABLES || !decodeProgram(code + program.codeOffset, program.codeLength, starts[i])) {
+            error = path + " has an invalid program";
+            return false;
+        }
+    }
+
+    //A context must stop between two instructions, like every line leaves it
+    for(uint64_t pid = 0; pid < h.slotCount; pid++) {
+        const CheckpointProcess& r = records[pid];
+
+        if(r.pid == INVALID_PID || r.program == UINT32_MAX) {
+            continue;
+        }
+
+        auto isStart = [&](uint32_t offset) {
+            return offset < starts[r.program].size() && starts[r.program][offset];
+        };
+
+        bool valid = r.program < h.programCount && isStart(r.pc) && r.depth <= PROGRAM_MAX_DEPTH;
+        for(uint32_t i = 0; valid && i < r.depth; i++) {
+            valid = isStart(r.loops[i].body);
+        }
+
+        if(!valid) {
+            error = path + " has an invalid program state in slot " + std::to_string(pid);
+            return false;
+        }
+    }
+
+    for(uint32_t i = 0; i < h.numCores; i++) {
+        if(cores[i].active && (!isLive(cores[i].pid) || records[cores[i].pid].generation != cores[i].generation)) {
+            error = path + " has an invalid process on core " + std::to_string(i);
+            return false;
+        }
+    }
+
+    //The layout must cover memory exactly as the allocator in use lays it out
+    uint64_t address = 0;
+    for(uint64_t i = 0; i < h.blockCount; i++) {
+        bool valid = blocks[i].startAddress == address && blocks[i].size > 0 &&
+                     (blocks[i].owningPid == INVALID_PID || isLive(blocks[i].owningPid)) &&
+                     (h.frameSize == 0 || blocks[i].size == h.frameSize);
+
+        if(!valid) {
+            error = path + " has an invalid memory layout";
+            return false;
+        }
+        address += blocks[i].size;
+    }
+
+    if(address != (h.frameSize == 0 ? h.memorySize : h.memorySize / h.frameSize * h.frameSize)) {
+        error = path + " has an invalid memory layout";
+        return false;
+    }
+
+    for(uint64_t i = 0; i < h.swappedCount; i++) {
+        if(!isLive(swapped[i].pid)) {
+            error = path + " has an invalid backing store entry";
+            return false;
+        }
+    }
+
+    for(uint64_t i = 0; i < h.sleeperCount; i++) {
+        if(!isLive(sleepers[i].pid) || records[sleepers[i].pid].generation != sleepers[i].generation) {
+            error = path + " has an invalid sleeping process";
+            return false;
+        }
+    }
+
+    for(uint64_t i = 0; i < h.ioCount; i++) {
+        const CheckpointIoRequest& r = ioRequests[i];
+
+        if(!isLive(r.pid) || records[r.pid].generation != r.generation || r.device < 0 || r.device >= IO_DEVICE_COUNT ||
+           r.core < 0 || r.core >= (int32_t) h.numCores || r.units < 1) {
+            error = path + " has an invalid I/O request";
+            return false;
+        }
+    }
+
+    //Everything checks out, replace the state. The system clock carries on from where it is, so the
+    //ticks recorded in processes move by the difference.
+    long long shift = t.clock->load() - (long long) h.tick;
+    auto shifted = [shift](int64_t tick) {
+        return tick == -1 ? tick : tick + shift;
+    };
+
+    t.logWriter->quiesce();
+
+    std::vector<std::shared_ptr<const Program>> images;
+    for(uint64_t i = 0; i < h.programCount; i++) {
+        std::shared_ptr<Program> image = std::make_shared<Program>();
+        image->code.assign(code + programs[i].codeOffset, code + programs[i].codeOffset + programs[i].codeLength);
+        image->cycles = programs[i].cycles;
+        image->variables = programs[i].variables;
+        images.push_back(t.programs != nullptr ? t.programs->intern(image) : image);
+    }
+
+    t.processes->restore((uint32_t) h.slotCount, h.nextProcessId, [&](uint32_t pid, Process& p) {
+        const CheckpointProcess& r = records[pid];
+        p.handle = { r.pid, r.generation };
+
+        if(r.pid == INVALID_PID) {
+            return;
+        }
+
+        p.name.assign(strings + r.nameOffset, r.nameLength);
+        p.timestamp.assign(strings + r.nameOffset + r.nameLength, r.timestampLength);
+        p.id = r.id;
+        p.core = r.core;
+        p.current_instruction = r.currentInstruction;
+        p.total_instructions = r.totalInstructions;
+        p.memoryRequired = r.memoryRequired;
+        p.age = (time_t) r.age;
+        p.arrivalTick = shifted(r.arrivalTick);
+        p.firstDispatchTick = shifted(r.firstDispatchTick);
+        p.completionTick = shifted(r.completionTick);
+        p.waitingTicks = r.waitingTicks;
+        p.memoryBlockedTicks = r.memoryBlockedTicks;
+        p.preemptions = r.preemptions;
+        p.swaps = r.swaps;
+        p.readySinceTick = shifted(r.readySinceTick);
+        p.memoryBlockedSinceTick = shifted(r.memoryBlockedSinceTick);
+        p.ioBlockedTicks = r.ioBlockedTicks;
+        p.ioSinceTick = shifted(r.ioSinceTick);
+        p.priority = r.priority;
+        p.completed = r.completed;
+        p.sleepRequest = r.sleepRequest;
+        p.ioDevice = r.ioDevice >= 0 && r.ioDevice < IO_DEVICE_COUNT ? r.ioDevice : -1;
+        p.ioUnits = r.ioUnits;
+        p.allocatedMemory = {};
+        p.program = r.program == UINT32_MAX ? nullptr : images[r.program];
+        p.context = {};
+
+        if(p.program) {
+            p.context.pc = r.pc;
+            p.context.depth = (uint16_t) r.depth;
+            for(int i = 0; i < PROGRAM_MAX_DEPTH; i++) {
+                p.context.loops[i] = { r.loops[i].body, r.loops[i].left };
+            }
+            memcpy(p.context.variables, r.variables, sizeof(p.context.variables));
+        }
+    });
+
+    std::vector<MemoryBlock> layout;
+    for(uint64_t i = 0; i < h.blockCount; i++) {
+        layout.push_back({ blocks[i].startAddress, blocks[i].size, blocks[i].owningPid, blocks[i].freeRank });
+    }
+
+    std::vector<Process*> evictable;
+    for(uint32_t pid = 0; pid < h.slotCount; pid++) {
+        if(isLive(pid) && records[pid].evictable) {
+            evictable.push_back(t.processes->at(pid));
+        }
+    }
+
+    std::map<uint32_t, uint64_t> swappedSizes;
+    for(uint64_t i = 0; i < h.swappedCount; i++) {
+        swappedSizes.insert({ swapped[i].pid, swapped[i].size });
+    }
+
+    t.memory->importState(layout, evictable, swappedSizes, h.pagedIn, h.pagedOut);
+
+    for(uint32_t i = 0; i < h.numCores; i++) {
+        const CheckpointCore& c = cores[i];
+        t.cores->at(i)->restoreState({ c.active ? t.processes->at(c.pid) : nullptr, c.active != 0, c.completed != 0, c.preempt != 0,
+                                       c.block != 0, c.remaining, c.delayCounter, c.quantumCountdown, c.activeTicks });
+    }
+
+    std::vector<ProcessHandle> queue;
+    for(uint64_t i = 0; i < h.readyCount; i++) {
+        queue.push_back({ ready[i].pid, ready[i].generation });
+    }
+
+    std::vector<std::pair<ProcessHandle, long long>> asleep;
+    for(uint64_t i = 0; i < h.sleeperCount; i++) {
+        asleep.push_back({ { sleepers[i].pid, sleepers[i].generation }, shifted(sleepers[i].wakeTick) });
+    }
+
+    std::vector<IoRequest> requests;
+    for(uint64_t i = 0; i < h.ioCount; i++) {
+        const CheckpointIoRequest& r = ioRequests[i];
+        requests.push_back({ { r.pid, r.generation }, r.device, r.core, r.units, shifted(r.submitTick), shifted(r.finishTick) });
+    }
+    t.io->importRequests(requests, t.clock->load());
+
+    SchedulerMetrics counters = {};
+    counters.dispatches = h.dispatches;
+    counters.preemptions = h.preemptions;
+    counters.completions = h.completions;
+    counters.memoryRequeues = h.memoryRequeues;
+    counters.sleeps = h.sleeps;
+    counters.ioRequests = h.ioRequests;
+    counters.interrupts = h.interrupts;
+    counters.overlapTicks = h.overlapTicks;
+    t.scheduler->restore(queue, asleep, counters);
+
+    t.tester->setProcessCounter(h.testerProcessCounter);
+    savedTick = h.tick;
+    return true;
+}
@@ -2,8 +2,15 @@
 
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <algorithm>
 #include "../DataTypes/Process.h"
 #include "../DataTypes/SchedAlgo.h"
+#include "./LogWriter.h"
+#include "./Affinity.h"
+#include "./CoreKernel.h"
+#include "../DataTypes/Seqlock.h"
+#include "../DataTypes/LatencyHistogram.h"
 
 struct TickData {
     long long total;
@@ -11,114 +18,321 @@ struct TickData {
     long long idle;
 };
 
+struct CoreMetrics {
+    long long clock;
+    long long activeTicks;
+    long long quantumRemaining;
+    int processId;              // -1 when the core is idle
+};
+
+// Everything a core carries from one tick to the next
+struct CoreSnapshot {
+    Process* process;           // nullptr when idle
+    bool active;
+    bool completed;             // Left for the scheduler to handle on the next tick
+    bool preempt;
+    bool block;
+    long long remaining;
+    long long delayCounter;
+    long long quantumCountdown;
+    long long activeTicks;
+};
+
+const size_t CACHE_LINE_SIZE = 64;
+
+//Hot per-core flags polled every tick. The scheduler/clock side and the core side each
+//get their own cache line, so spinning on one side does not invalidate the other's writes.
+struct alignas(CACHE_LINE_SIZE) CoreControlBlock {
+    //Written by the clock and scheduler, polled by the core
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> canProceed{false};
+    std::atomic<bool> isCoreActive{false};
+    std::atomic<bool> isCoreOn{false};
+
+    //Written by the core, polled by the clock and scheduler
+    alignas(CACHE_LINE_SIZE) std::atomic<long long> coreClock{0};
+    std::atomic<bool> processCompleted{false};
+    std::atomic<bool> shouldPreempt{false};
+    std::atomic<bool> shouldBlock{false};
+};
+
+//Contiguous, cache line aligned array of control blocks, one per core
+class CoreControlTable {
+    private:
+        std::unique_ptr<CoreControlBlock[]> blocks;
+        int size = 0;
+
+    public:
+        void init(int numCores) {
+            blocks.reset(new CoreControlBlock[numCores]);
+            size = numCores;
+        }
+
+        CoreControlBlock* at(int coreId) {
+            return std::addressof(blocks[coreId]);
+        }
+
+        int getSize() {
+            return size;
+        }
+};
+
 class Core
 {
 private:
     int coreId;                 // core id number
-    long long coreClock;        // core's internal clock
+    CoreControlBlock* control;  // core's flags and internal clock, owned by a CoreControlTable
+    CoreStateTable* state;      // core's counters live in lane coreId: quantum countdown, delay counter, active ticks
     long long quantumCycles;    // number of cycles before rr preempts process
-    long long coreQuantumCountdown; // processFreqCounter for when to preempt process
     long long delayPerExec;     // delay per execution
-    long long delayCounter;     // delay counter
-    long long activeTicks;
     std::thread t;
     Process* currentProcess;
     TSQueue* readyQueue;
     std::atomic<long long>* currentSystemClock;
-    std::atomic<bool> isCoreActive;
-    std::atomic<bool> isCoreOn;
-    std::atomic<bool> shouldPreempt;
-    std::atomic<bool> canProceed;
-    std::atomic<bool> processCompleted;
     std::string (*getCurrentTimestamp)();
+    LogWriter* logWriter;
+    int logChannel;             // log buffer this core pushes to, one per producing thread
+    Seqlock<CoreMetrics> metrics; // Published by the core thread once per tick
+    LatencyHistogram executeTime; // Host nanoseconds spent executing each tick, excluding the sync spins
     std::mutex mtx;
     SchedAlgo algorithm;
+    int hostCpu;                // host CPU the thread is pinned to, -1 for none
+    bool pinned;
 
     Process* removeFromCore() {
         Process* finished = currentProcess;
         currentProcess->setCore(-1);
         currentProcess = nullptr;
-        isCoreActive.store(false);
-        this->coreQuantumCountdown = quantumCycles;
+        control->isCoreActive.store(false);
+        state->activeMask[coreId] = 0;
+        state->remaining[coreId] = 0;
+        state->quantumCountdown[coreId] = quantumCycles;
         return finished;
     }
 
+    void publishTick(bool executed, bool completed, bool preempted, bool blocked) {
+        if(executed) {
+            //Only prints are logged, and the last line so the writer can close the file
+            if(logWriter != nullptr && (currentProcess->printed != PRINT_NONE || completed)) {
+                logWriter->push(this->logChannel, this->coreId, currentProcess, currentProcess->printed, completed);
+            }
+
+            control->processCompleted.store(completed);
+        }
+
+        if(preempted) {
+            control->shouldPreempt.store(true);
+        }
+
+        if(blocked) {
+            control->shouldBlock.store(true);
+        }
+
+        //Publish before advancing the clock, the scheduler may reassign this core once the clock moves
+        long long nextClock = (control->coreClock.load(std::memory_order_relaxed) + 1) % LLONG_MAX;
+        metrics.write({ nextClock, state->activeTicks[coreId], state->quantumCountdown[coreId], control->isCoreActive.load() ? currentProcess->id : -1 });
+    }
+
+    void advanceClock() {
+        CoreControlBlock& c = *control;
+        long long nextClock = (c.coreClock.load(std::memory_order_relaxed) + 1) % LLONG_MAX;
+
+        //Lock self before publishing the clock, once it is visible the clock may already unlock the next tick
+        lock();
+        c.coreClock.store(nextClock, std::memory_order_release);
+    }
+
 public:
-    Core(int coreId, long long quantumCycles, std::atomic<long long>* currentSystemClock, std::string (*getCurrentTimestamp)(), SchedAlgo algorithm, long long delayPerExec) {
+    Core(int coreId, long long quantumCycles, std::atomic<long long>* currentSystemClock, std::string (*getCurrentTimestamp)(), SchedAlgo algorithm, long long delayPerExec, CoreControlBlock* control, CoreStateTable* state) {
         this->coreId = coreId;
-        this->coreClock = 0;
+        this->control = control;
+        this->state = state;
         this->quantumCycles = quantumCycles;
-        this->coreQuantumCountdown = quantumCycles;
         this->algorithm = algorithm;
-        this->activeTicks = 0;
         currentProcess = nullptr;
-        isCoreActive.store(false);
-        isCoreOn.store(false);
-        shouldPreempt.store(false);
-        canProceed.store(false);
-        processCompleted.store(false);
+        state->remaining[coreId] = 0;
+        state->delayCounter[coreId] = 0;
+        state->quantumCountdown[coreId] = quantumCycles;
+        state->activeTicks[coreId] = 0;
+        state->activeMask[coreId] = 0;
+        control->coreClock.store(0);
+        control->isCoreActive.store(false);
+        control->isCoreOn.store(false);
+        control->shouldPreempt.store(false);
+        control->shouldBlock.store(false);
+        control->canProceed.store(false);
+        control->processCompleted.store(false);
 
         this->currentSystemClock = currentSystemClock;
         this->getCurrentTimestamp = getCurrentTimestamp;
         this->delayPerExec = delayPerExec;
-        this->delayCounter = 0;
+        this->logWriter = nullptr;
+        this->logChannel = coreId;
+        this->hostCpu = -1;
+        this->pinned = false;
     }
 
     void assignReadyQueue(TSQueue* queue_ptr) {
         this->readyQueue = queue_ptr;
     }
 
+    void setLogWriter(LogWriter* logWriter) {
+        this->logWriter = logWriter;
+    }
+
+    // Cores stepped by the same worker thread share that worker's log buffer
+    void setLogChannel(int logChannel) {
+        this->logChannel = logChannel;
+    }
+
+    void setHostCpu(int hostCpu) {
+        this->hostCpu = hostCpu;
+    }
+
+    int getHostCpu() {
+        return this->hostCpu;
+    }
+
+    bool isPinned() {
+        return this->pinned;
+    }
+
     void start() {
-        isCoreOn.store(true);
+        control->isCoreOn.store(true);
         t = std::thread(run, this);
+        pinned = pinThread(t, hostCpu);
+    }
+
+    // Turns the core on without a thread of its own, a CoreWorkerPool steps it instead
+    void startStepped() {
+        control->isCoreOn.store(true);
     }
 
     void run() {
-        while(isCoreOn.load()) {
-            while(currentSystemClock->load() == this->coreClock && isCoreOn.load()) {} //Halt if at latest time step
-            while(!canProceed.load() && isCoreOn.load()) {} // Wait for scheduler
-            while((processCompleted.load() || shouldPreempt.load()) && isCoreOn.load()) {}
+        while(waitForTick()) {
+            step();
+        }
+    }
 
-            if(isCoreActive.load()){
-                if(delayCounter == delayPerExec) {
-                    processCompleted.store(currentProcess->executeLine(getCurrentTimestamp(), this->coreId));
+    // Spins until the clock and scheduler release this core for the next tick, false once turned off
+    bool waitForTick() {
+        CoreControlBlock& c = *control;
+        long long coreClock = c.coreClock.load(std::memory_order_relaxed);
 
-                    if(!processCompleted.load()) {
-                        coreQuantumCountdown--;
+        while(currentSystemClock->load() == coreClock && c.isCoreOn.load()) {} //Halt if at latest time step
+        while(!c.canProceed.load() && c.isCoreOn.load()) {} // Wait for scheduler
+        while((c.processCompleted.load() || c.shouldPreempt.load() || c.shouldBlock.load()) && c.isCoreOn.load()) {}
 
-                        if(coreQuantumCountdown == 0 && algorithm == RR) {
-                            shouldPreempt.store(true);
-                        }
+        return c.isCoreOn.load();
+    }
 
-                    }
+    // Executes one tick, only the thread that called waitForTick may call this
+    void step() {
+        uint64_t executeStart = nowNanoseconds();
+        long long& delayCounter = state->delayCounter[coreId];
+        long long& coreQuantumCountdown = state->quantumCountdown[coreId];
+        bool executed = false;
+        bool completed = false;
+        bool preempted = false;
+        bool blocked = false;
 
-                    delayCounter = -1;
+        if(control->isCoreActive.load()){
+            if(delayCounter == delayPerExec) {
+                executed = true;
+                completed = currentProcess->executeLine();
 
+                if(!completed) {
+                    coreQuantumCountdown--;
+                    blocked = currentProcess->isBlocking();
+                    preempted = !blocked && coreQuantumCountdown == 0 && algorithm == RR;
                 }
-                activeTicks++;
-                delayCounter++;
+
+                delayCounter = -1;
+
             }
-            std::unique_lock<std::mutex> l(mtx);
-            coreClock = (coreClock + 1) % LLONG_MAX;
-            l.unlock();
-            lock(); // Lock self for next iteration
+            state->activeTicks[coreId]++;
+            delayCounter++;
         }
+
+        publishTick(executed, completed, preempted, blocked);
+        executeTime.record(nowNanoseconds() - executeStart);
+        advanceClock();
     }
 
-    TickData getTickData() {
+    // Finishes a tick whose counters a CoreKernel already stepped, running the line the kernel counted.
+    // The stepping worker records this core's share of the slice time into getExecuteTime() instead of
+    // timing every core.
+    void finishKernelTick(bool executed, bool completed, bool preempted) {
+        bool blocked = false;
+
+        if(executed) {
+            currentProcess->executeLine();
+            currentProcess->current_instruction = currentProcess->total_instructions - state->remaining[coreId];
+            currentProcess->completed = completed;
+            blocked = !completed && currentProcess->isBlocking();
+        }
+
+        publishTick(executed, completed, preempted && !blocked, blocked);
+        advanceClock();
+    }
+
+    // Only at a tick boundary, while the core waits for the clock
+    CoreSnapshot saveState() {
+        return { currentProcess, control->isCoreActive.load(), control->processCompleted.load(), control->shouldPreempt.load(),
+                 control->shouldBlock.load(), state->remaining[coreId], state->delayCounter[coreId], state->quantumCountdown[coreId], state->activeTicks[coreId] };
+    }
+
+    // Only at a tick boundary. The core clock carries on, so active ticks are capped to it.
+    void restoreState(const CoreSnapshot& snapshot) {
+        long long clock = control->coreClock.load(std::memory_order_acquire);
+        long long activeTicks = std::min(snapshot.activeTicks, clock);
+
         std::unique_lock<std::mutex> lock(mtx);
-        TickData data = { coreClock, activeTicks, coreClock - activeTicks };
+        currentProcess = snapshot.active ? snapshot.process : nullptr;
+        state->remaining[coreId] = snapshot.remaining;
+        state->delayCounter[coreId] = snapshot.delayCounter;
+        state->quantumCountdown[coreId] = snapshot.quantumCountdown;
+        state->activeTicks[coreId] = activeTicks;
+        state->activeMask[coreId] = snapshot.active ? -1 : 0;
+        control->processCompleted.store(snapshot.active && snapshot.completed);
+        control->shouldPreempt.store(snapshot.active && snapshot.preempt);
+        control->shouldBlock.store(snapshot.active && snapshot.block);
+        control->isCoreActive.store(snapshot.active);
+        metrics.write({ clock, activeTicks, snapshot.quantumCountdown, snapshot.active ? currentProcess->id : -1 });
         lock.unlock();
-        return data;
+    }
+
+    TickData getTickData() {
+        CoreMetrics snapshot = metrics.read();
+        return { snapshot.clock, snapshot.activeTicks, snapshot.clock - snapshot.activeTicks };
+    }
+
+    CoreMetrics getMetrics() {
+        return metrics.read();
+    }
+
+    LatencyHistogram* getExecuteTime() {
+        return std::addressof(executeTime);
+    }
+
+    int getId() {
+        return this->coreId;
+    }
+
+    long long getDelayPerExec() {
+        return this->delayPerExec;
+    }
+
+    SchedAlgo getAlgorithm() {
+        return this->algorithm;
     }
 
     Process* preempt() {
         std::unique_lock<std::mutex> lock(mtx);
-        readyQueue->push(currentProcess);
+        readyQueue->push(currentProcess->handle);
         Process* p = removeFromCore();
-        coreQuantumCountdown = quantumCycles;
-        processCompleted.store(false);
-        shouldPreempt.store(false);
+        control->processCompleted.store(false);
+        control->shouldPreempt.store(false);
+        control->shouldBlock.store(false);
         lock.unlock();
         return p;
     }
@@ -126,45 +340,57 @@ public:
     Process* finish() {
         std::unique_lock<std::mutex> lock(mtx);
         Process* p = removeFromCore();
-        coreQuantumCountdown = quantumCycles;
-        processCompleted.store(false);
-        shouldPreempt.store(false);
+        control->processCompleted.store(false);
+        control->shouldPreempt.store(false);
+        control->shouldBlock.store(false);
         lock.unlock();
         return p;
     }
 
+    // Takes a process that asked to sleep or wait for I/O, it keeps its memory and is not requeued
+    Process* block() {
+        return finish();
+    }
+
     bool getShouldPreempt() {
-        return shouldPreempt.load();
+        return control->shouldPreempt.load();
+    }
+
+    bool getShouldBlock() {
+        return control->shouldBlock.load();
     }
 
     bool getProcessCompleted() {
-        return processCompleted.load();
+        return control->processCompleted.load();
     }
 
     void setShouldPreempt() {
-        shouldPreempt.store(true);
+        control->shouldPreempt.store(true);
     }
 
     bool isActive() {
-        return this->isCoreActive.load();
+        return control->isCoreActive.load();
     }
 
     void assignProcess(Process* p) {
         std::unique_lock<std::mutex> lock(mtx);
         this->currentProcess = p;
         p->setCore(this->coreId);
-        this->isCoreActive.store(true);
-        processCompleted.store(false);
-        shouldPreempt.store(false);
+        state->remaining[coreId] = p->total_instructions - p->current_instruction;
+        state->activeMask[coreId] = -1;
+        control->processCompleted.store(false);
+        control->shouldPreempt.store(false);
+        control->shouldBlock.store(false);
+        control->isCoreActive.store(true);
         lock.unlock();
     }
 
     bool isOn() {
-        return isCoreOn.load();
+        return control->isCoreOn.load();
     }
 
     void turnOff() {
-        isCoreOn.store(false);
+        control->isCoreOn.store(false);
         join();
     }
 
@@ -175,15 +401,14 @@ public:
     }
 
     void unlock() {
-        this->canProceed.store(true);
+        control->canProceed.store(true);
     }
 
     void lock() {
-        this->canProceed.store(false);
+        control->canProceed.store(false);
     }
 
     long long getTime() {
-        std::lock_guard<std::mutex> l(mtx);
-        return this->coreClock;
+        return control->coreClock.load(std::memory_order_acquire);
     }
 };
\ No newline at end of file
@@ -0,0 +1,241 @@
+/*
+    This file defines the struct-of-arrays core counters and the kernels that step a slice of them by one tick
+*/
+#pragma once
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CORE_KERNEL_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+//MSVC accepts AVX2 intrinsics in any function, GCC and Clang need the target enabled per function
+#if defined(CORE_KERNEL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CORE_KERNEL_AVX2 __attribute__((target("avx2")))
+#else
+#define CORE_KERNEL_AVX2
+#endif
+
+enum CoreStepMode {
+    CORE_STEP_OBJECT,   // Every core steps its own Process* and counters
+    CORE_STEP_SCALAR,   // The worker steps its slice of the counter arrays in a plain loop
+    CORE_STEP_AVX2      // As scalar, four cores per instruction
+};
+
+const char* CORE_STEP_MODE_NAMES[] = { "object", "scalar", "avx2" };
+
+const int CORE_LANE_GROUP = 8; // Counters per cache line
+
+// Per-core counters stored as parallel arrays, lane i belongs to core i. Only the thread stepping
+// a core writes its lanes during a tick, the scheduler writes them between ticks under the core's lock.
+class CoreStateTable {
+    private:
+        struct alignas(64) LaneGroup {
+            long long lanes[CORE_LANE_GROUP];
+        };
+
+        std::unique_ptr<LaneGroup[]> storage;
+        int size = 0;
+
+    public:
+        long long* remaining;           // Instructions left in the assigned process, only kept by the kernels
+        long long* delayCounter;
+        long long* quantumCountdown;
+        long long* activeTicks;
+        long long* activeMask;          // All bits set while a process is assigned
+
+        void init(int numCores) {
+            int groups = (numCores + CORE_LANE_GROUP - 1) / CORE_LANE_GROUP;
+            storage.reset(new LaneGroup[groups * 5]());
+            size = numCores;
+
+            long long* base = storage[0].lanes;
+            long long stride = (long long) groups * CORE_LANE_GROUP;
+            remaining = base;
+            delayCounter = base + stride;
+            quantumCountdown = base + stride * 2;
+            activeTicks = base + stride * 3;
+            activeMask = base + stride * 4;
+        }
+
+        int getSize() {
+            return size;
+        }
+};
+
+// One bit per lane of a slice, bit i is lane begin + i
+struct CoreStepMasks {
+    std::vector<uint64_t> executed;
+    std::vector<uint64_t> completed;
+    std::vector<uint64_t> preempted;
+
+    void resize(int lanes) {
+        size_t words = (lanes + 63) / 64;
+        executed.resize(words);
+        completed.resize(words);
+        preempted.resize(words);
+    }
+
+    static bool test(const std::vector<uint64_t>& mask, int bit) {
+        return (mask[bit >> 6] >> (bit & 63)) & 1;
+    }
+};
+
+inline int lowestBit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (int) index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// Calls visit(bit) for every set bit of the mask in increasing order
+template <typename Visit>
+inline void forEachSetBit(const std::vector<uint64_t>& mask, Visit visit) {
+    for(size_t word = 0; word < mask.size(); word++) {
+        uint64_t bits = mask[word];
+
+        while(bits != 0) {
+            visit((int) (word * 64) + lowestBit(bits));
+            bits &= bits - 1;
+        }
+    }
+}
+
+inline void stepCoreLane(CoreStateTable& s, int lane, uint64_t bit, long long delayPerExec, bool roundRobin,
+                         uint64_t& executed, uint64_t& completed, uint64_t& preempted) {
+    if(s.activeMask[lane] == 0) {
+        return;
+    }
+
+    if(s.delayCounter[lane] == delayPerExec) {
+        executed |= bit;
+
+        if(--s.remaining[lane] <= 0) {
+            completed |= bit;
+        } else if(--s.quantumCountdown[lane] == 0 && roundRobin) {
+            preempted |= bit;
+        }
+
+        s.delayCounter[lane] = -1;
+    }
+
+    s.activeTicks[lane]++;
+    s.delayCounter[lane]++;
+}
+
+//Both kernels build each 64 bit mask word in registers and store it once
+inline void stepCoreLanesScalar(CoreStateTable& s, int begin, int end, long long delayPerExec, bool roundRobin, CoreStepMasks& masks) {
+    masks.resize(end - begin);
+
+    for(int base = begin; base < end; base += 64) {
+        int limit = base + 64 < end ? base + 64 : end;
+        uint64_t executed = 0, completed = 0, preempted = 0;
+
+        for(int lane = base; lane < limit; lane++) {
+            stepCoreLane(s, lane, 1ULL << (lane - base), delayPerExec, roundRobin, executed, completed, preempted);
+        }
+
+        int word = (base - begin) >> 6;
+        masks.executed[word] = executed;
+        masks.completed[word] = completed;
+        masks.preempted[word] = preempted;
+    }
+}
+
+#ifdef CORE_KERNEL_X86
+// Same result as the scalar kernel. Compares yield all ones lanes, so adding a mask decrements and subtracting it increments.
+CORE_KERNEL_AVX2 inline void stepCoreLanesAvx2(CoreStateTable& s, int begin, int end, long long delayPerExec, bool roundRobin, CoreStepMasks& masks) {
+    masks.resize(end - begin);
+
+    const __m256i target = _mm256_set1_epi64x(delayPerExec);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i allOnes = _mm256_set1_epi64x(-1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i rr = roundRobin ? allOnes : zero;
+
+    for(int base = begin; base < end; base += 64) {
+        int limit = base + 64 < end ? base + 64 : end;
+        uint64_t executedBits = 0, completedBits = 0, preemptedBits = 0;
+        int lane = base;
+
+        for(; lane + 4 <= limit; lane += 4) {
+            __m256i active = _mm256_loadu_si256((const __m256i*) (s.activeMask + lane));
+            __m256i delay = _mm256_loadu_si256((const __m256i*) (s.delayCounter + lane));
+            __m256i remaining = _mm256_loadu_si256((const __m256i*) (s.remaining + lane));
+            __m256i quantum = _mm256_loadu_si256((const __m256i*) (s.quantumCountdown + lane));
+            __m256i ticks = _mm256_loadu_si256((const __m256i*) (s.activeTicks + lane));
+
+            __m256i executed = _mm256_and_si256(active, _mm256_cmpeq_epi64(delay, target));
+            remaining = _mm256_add_epi64(remaining, executed);
+            __m256i completed = _mm256_and_si256(executed, _mm256_cmpgt_epi64(one, remaining));
+            __m256i running = _mm256_andnot_si256(completed, executed);
+            quantum = _mm256_add_epi64(quantum, running);
+            __m256i preempted = _mm256_and_si256(_mm256_and_si256(running, rr), _mm256_cmpeq_epi64(quantum, zero));
+
+            delay = _mm256_blendv_epi8(delay, allOnes, executed);
+            delay = _mm256_sub_epi64(delay, active);
+            ticks = _mm256_sub_epi64(ticks, active);
+
+            _mm256_storeu_si256((__m256i*) (s.delayCounter + lane), delay);
+            _mm256_storeu_si256((__m256i*) (s.remaining + lane), remaining);
+            _mm256_storeu_si256((__m256i*) (s.quantumCountdown + lane), quantum);
+            _mm256_storeu_si256((__m256i*) (s.activeTicks + lane), ticks);
+
+            int shift = lane - base;
+            executedBits |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(executed)) << shift;
+            completedBits |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(completed)) << shift;
+            preemptedBits |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(preempted)) << shift;
+        }
+
+        for(; lane < limit; lane++) {
+            stepCoreLane(s, lane, 1ULL << (lane - base), delayPerExec, roundRobin, executedBits, completedBits, preemptedBits);
+        }
+
+        int word = (base - begin) >> 6;
+        masks.executed[word] = executedBits;
+        masks.completed[word] = completedBits;
+        masks.preempted[word] = preemptedBits;
+    }
+}
+#endif
+
+inline bool cpuSupportsAvx2() {
+#if defined(CORE_KERNEL_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7) {
+        return false;
+    }
+
+    //The OS must also save the YMM registers on context switches
+    __cpuid(info, 1);
+    if((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(CORE_KERNEL_X86)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+inline void stepCoreLanes(CoreStepMode mode, CoreStateTable& s, int begin, int end, long long delayPerExec, bool roundRobin, CoreStepMasks& masks) {
+#ifdef CORE_KERNEL_X86
+    if(mode == CORE_STEP_AVX2) {
+        stepCoreLanesAvx2(s, begin, end, delayPerExec, roundRobin, masks);
+        return;
+    }
+#endif
+    stepCoreLanesScalar(s, begin, end, delayPerExec, roundRobin, masks);
+}
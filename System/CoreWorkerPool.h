@@ -0,0 +1,177 @@
+/*
+    This file defines the fixed pool of worker threads that steps the emulated cores in pooled execution
+*/
+#pragma once
+#include "Core.h"
+#include "Affinity.h"
+#include "CoreKernel.h"
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+enum ExecutionMode {
+    EXECUTION_THREADS,  // One host thread per emulated core
+    EXECUTION_POOLED    // Emulated cores are stepped by a fixed pool of worker threads
+};
+
+const char* EXECUTION_MODE_NAMES[] = { "threads", "pooled" };
+
+class CoreWorkerPool {
+    private:
+        struct Worker {
+            std::thread t;
+            int begin;      // First core of the slice
+            int end;        // One past the last core of the slice
+            int hostCpu;
+            bool pinned;
+        };
+
+        std::vector<Core*>* cores;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<bool> active;
+        CoreStepMode mode;
+        CoreStateTable* state;
+
+        // Steps the slice in core order every tick, each core still waits for its own release
+        void run(Worker* worker) {
+            if(mode != CORE_STEP_OBJECT) {
+                runKernel(worker);
+                return;
+            }
+
+            while(active.load()) {
+                for(int i = worker->begin; i < worker->end; i++) {
+                    Core* core = cores->at(i);
+
+                    if(core->waitForTick()) {
+                        core->step();
+                    }
+                }
+            }
+        }
+
+        // Waits until the whole slice is released, steps its counters in one kernel call, then finishes each core
+        void runKernel(Worker* worker) {
+            CoreStepMasks masks;
+            long long delayPerExec = cores->at(worker->begin)->getDelayPerExec();
+            bool roundRobin = cores->at(worker->begin)->getAlgorithm() == RR;
+            int lanes = worker->end - worker->begin;
+
+            while(active.load()) {
+                bool released = true;
+
+                for(int i = worker->begin; i < worker->end; i++) {
+                    released = cores->at(i)->waitForTick() && released;
+                }
+
+                if(!released) {
+                    continue;
+                }
+
+                uint64_t sliceStart = nowNanoseconds();
+                stepCoreLanes(mode, *state, worker->begin, worker->end, delayPerExec, roundRobin, masks);
+
+                for(int bit = 0; bit < lanes; bit++) {
+                    cores->at(worker->begin + bit)->finishKernelTick(CoreStepMasks::test(masks.executed, bit),
+                        CoreStepMasks::test(masks.completed, bit), CoreStepMasks::test(masks.preempted, bit));
+                }
+
+                //Every core is charged an equal share, the worker is the histograms' only writer
+                uint64_t share = (nowNanoseconds() - sliceStart) / lanes;
+                for(int i = worker->begin; i < worker->end; i++) {
+                    cores->at(i)->getExecuteTime()->record(share);
+                }
+            }
+        }
+
+    public:
+        CoreWorkerPool() {
+            cores = nullptr;
+            state = nullptr;
+            mode = CORE_STEP_OBJECT;
+            active.store(false);
+        }
+
+        ~CoreWorkerPool() {
+            turnOff();
+        }
+
+        // hardware_concurrency when workerCount is 0, never more workers than cores
+        static int resolveWorkerCount(int workerCount, int numCores) {
+            if(workerCount <= 0) {
+                workerCount = std::thread::hardware_concurrency();
+            }
+
+            if(workerCount < 1) {
+                workerCount = 1;
+            }
+
+            return workerCount < numCores ? workerCount : numCores;
+        }
+
+        // Splits the cores into contiguous slices, one worker per host CPU entry (-1 for unpinned),
+        // and routes the slice's logs to the worker's buffer. The kernel modes step the slices of state.
+        void init(std::vector<Core*>* cores, const std::vector<int>& workerCpus, CoreStepMode mode, CoreStateTable* state) {
+            this->cores = cores;
+            this->mode = mode;
+            this->state = state;
+            workers.clear();
+
+            int numCores = cores->size();
+            int workerCount = workerCpus.size();
+
+            //Slices start on a cache line of counters when every worker gets at least one full line
+            int unit = numCores >= workerCount * CORE_LANE_GROUP ? CORE_LANE_GROUP : 1;
+            int units = (numCores + unit - 1) / unit;
+
+            for(int w = 0; w < workerCount; w++) {
+                std::unique_ptr<Worker> worker = std::make_unique<Worker>();
+                worker->begin = (int) std::min<long long>(numCores, (long long) units * w / workerCount * unit);
+                worker->end = (int) std::min<long long>(numCores, (long long) units * (w + 1) / workerCount * unit);
+                worker->hostCpu = workerCpus[w];
+                worker->pinned = false;
+
+                for(int i = worker->begin; i < worker->end; i++) {
+                    cores->at(i)->setLogChannel(w);
+                }
+
+                workers.push_back(std::move(worker));
+            }
+        }
+
+        void start() {
+            for(Core* core: *cores) {
+                core->startStepped();
+            }
+
+            active.store(true);
+            for(auto& worker: workers) {
+                worker->t = std::thread(run, this, worker.get());
+                worker->pinned = pinThread(worker->t, worker->hostCpu);
+            }
+        }
+
+        void turnOff() {
+            active.store(false);
+
+            for(auto& worker: workers) {
+                if(worker->t.joinable()) {
+                    worker->t.join();
+                }
+            }
+        }
+
+        int getWorkerCount() {
+            return workers.size();
+        }
+
+        int getWorkerHostCpu(int worker) {
+            return workers[worker]->hostCpu;
+        }
+
+        bool isWorkerPinned(int worker) {
+            return workers[worker]->pinned;
+        }
+};
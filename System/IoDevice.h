@@ -0,0 +1,253 @@
+/*
+    This file defines the emulated I/O devices, their request queues and service times, and the per-core
+    interrupt lines their completions are signalled on
+*/
+#pragma once
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <vector>
+#include "../DataTypes/Process.h"
+#include "../DataTypes/Program.h"
+#include "../DataTypes/Random.h"
+#include "../DataTypes/Seqlock.h"
+
+enum IoDeviceKind {
+    IO_DISK,            // Units are sectors
+    IO_TERMINAL,        // Units are characters
+    IO_DEVICE_COUNT
+};
+
+const char* IO_DEVICE_NAMES[] = { "disk", "terminal" };
+
+static_assert(IO_DEVICE_COUNT == PROGRAM_IO_DEVICES, "Programs and the emulator disagree on the devices");
+
+// A request takes a setup drawn from [0, setupTicks] plus ticksPerUnit for each unit
+struct IoServiceModel {
+    long long setupTicks;
+    long long ticksPerUnit;
+};
+
+const IoServiceModel DEFAULT_IO_SERVICE[IO_DEVICE_COUNT] = {
+    { 8, 2 },           // Seek and rotation, then transfer
+    { 0, 1 }            // One character per tick
+};
+
+struct IoRequest {
+    ProcessHandle handle;
+    int device;
+    int core;           // Issuing core, its interrupt line gets the completion
+    long long units;
+    long long submitTick;
+    long long finishTick; // -1 while queued behind another request
+};
+
+struct IoDeviceStats {
+    long long busyTicks;
+    long long queueLength;      // Including the request in service
+    unsigned long long requests;
+    unsigned long long completions;
+    unsigned long long units;
+};
+
+struct IoStats {
+    long long ticks;            // Ticks the devices have been advanced through
+    IoDeviceStats devices[IO_DEVICE_COUNT];
+};
+
+// Serves one request at a time in arrival order
+class IoDevice {
+    private:
+        IoServiceModel model;
+        std::deque<IoRequest> queue;
+        Xoshiro256 rng;
+        IoDeviceStats stats;
+
+        void startFront(long long tick) {
+            IoRequest& front = queue.front();
+            long long setup = model.setupTicks > 0 ? (long long) rng.below(model.setupTicks + 1) : 0;
+            front.finishTick = tick + setup + front.units * model.ticksPerUnit;
+            front.finishTick = front.finishTick > tick ? front.finishTick : tick + 1;
+        }
+
+    public:
+        IoDevice() {
+            this->model = { 0, 1 };
+            this->stats = {};
+        }
+
+        void init(IoServiceModel model, uint64_t seed) {
+            this->model = model;
+            this->rng.seed(seed);
+            this->queue.clear();
+            this->stats = {};
+        }
+
+        void submit(const IoRequest& request, long long tick) {
+            queue.push_back(request);
+            queue.back().finishTick = -1;
+            stats.requests++;
+            stats.queueLength = queue.size();
+
+            if(queue.size() == 1) {
+                startFront(tick);
+            }
+        }
+
+        // Finishes every request due by tick, back to back, and raises its interrupt on the issuing core
+        void advance(long long tick, std::vector<std::vector<IoRequest>>& interrupts) {
+            if(!queue.empty()) {
+                stats.busyTicks++;
+            }
+
+            while(!queue.empty() && queue.front().finishTick <= tick) {
+                IoRequest done = queue.front();
+                queue.pop_front();
+                stats.completions++;
+                stats.units += done.units;
+                interrupts[done.core].push_back(done);
+
+                if(!queue.empty()) {
+                    startFront(done.finishTick);
+                }
+            }
+
+            stats.queueLength = queue.size();
+        }
+
+        // Queue order, for checkpoints
+        std::vector<IoRequest> getQueue() {
+            return std::vector<IoRequest>(queue.begin(), queue.end());
+        }
+
+        // Replaces the queue, keeping the finish tick of a request already in service
+        void restore(const std::vector<IoRequest>& requests, long long tick) {
+            queue.assign(requests.begin(), requests.end());
+
+            if(!queue.empty() && queue.front().finishTick == -1) {
+                startFront(tick);
+            }
+            stats.queueLength = queue.size();
+        }
+
+        IoDeviceStats getStats() {
+            return stats;
+        }
+};
+
+// Owned by the scheduler thread, which submits, advances and drains it between handling cores. Other
+// threads read the published stats only.
+class IoController {
+    private:
+        IoDevice devices[IO_DEVICE_COUNT];
+        std::vector<std::vector<IoRequest>> interrupts; // One line per core
+        long long ticks;
+        Seqlock<IoStats> stats;
+
+        void publish() {
+            IoStats snapshot = { ticks, {} };
+
+            for(int i = 0; i < IO_DEVICE_COUNT; i++) {
+                snapshot.devices[i] = devices[i].getStats();
+            }
+            stats.write(snapshot);
+        }
+
+    public:
+        IoController() {
+            this->ticks = 0;
+        }
+
+        void init(int numCores, const IoServiceModel* models, uint64_t seed) {
+            Xoshiro256 seeds(seed);
+            seeds.jump();   // Past the streams of the tester and screen -s
+            seeds.jump();
+
+            interrupts.assign(numCores, {});
+            for(int i = 0; i < IO_DEVICE_COUNT; i++) {
+                devices[i].init(models[i], seeds.next());
+            }
+            ticks = 0;
+            publish();
+        }
+
+        void submit(Process* process, int device, int core, long long units, long long tick) {
+            devices[device].submit({ process->handle, device, core, units, tick, -1 }, tick);
+        }
+
+        void advance(long long tick) {
+            for(IoDevice& device: devices) {
+                device.advance(tick, interrupts);
+            }
+            ticks++;
+            publish();
+        }
+
+        // Completions raised on the core since it was last drained, cleared by the caller
+        std::vector<IoRequest>& getInterrupts(int core) {
+            return interrupts[core];
+        }
+
+        bool isBusy() {
+            for(IoDevice& device: devices) {
+                if(device.getStats().queueLength > 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // In flight and queued requests of every device, for checkpoints
+        std::vector<IoRequest> exportRequests() {
+            std::vector<IoRequest> requests;
+
+            for(IoDevice& device: devices) {
+                std::vector<IoRequest> queue = device.getQueue();
+                requests.insert(requests.end(), queue.begin(), queue.end());
+            }
+            return requests;
+        }
+
+        // Replaces every queue, only at a tick boundary. Interrupts not yet handled are dropped with the
+        // state they belonged to.
+        void importRequests(const std::vector<IoRequest>& requests, long long tick) {
+            std::vector<IoRequest> queues[IO_DEVICE_COUNT];
+
+            for(const IoRequest& request: requests) {
+                queues[request.device].push_back(request);
+            }
+
+            for(int i = 0; i < IO_DEVICE_COUNT; i++) {
+                devices[i].restore(queues[i], tick);
+            }
+
+            for(std::vector<IoRequest>& line: interrupts) {
+                line.clear();
+            }
+            publish();
+        }
+
+        IoStats getStats() {
+            return stats.read();
+        }
+};
+
+// "setup,perUnit", both ticks
+inline bool parseIoServiceModel(const std::string& value, IoServiceModel& model) {
+    char* end;
+    long long setup = std::strtoll(value.c_str(), &end, 10);
+
+    if (*end != ',' || end == value.c_str() || setup < 0 || setup > 1000000) {
+        return false;
+    }
+
+    const char* start = end + 1;
+    long long perUnit = std::strtoll(start, &end, 10);
+
+    if (*end != '\0' || end == start || perUnit < 0 || perUnit > 1000000) {
+        return false;
+    }
+
+    model = { setup, perUnit };
+    return true;
+}
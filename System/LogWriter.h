@@ -0,0 +1,308 @@
+/*
+    This file defines the background writer for per process execution logs
+*/
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <map>
+#include <set>
+#include <list>
+#include <string>
+#include <ctime>
+#include <cstdio>
+#include "../DataTypes/Process.h"
+#include "../DataTypes/RingBuffer.h"
+
+enum LogPolicy {
+    LOG_DROP,   // Discard records when a core's buffer is full
+    LOG_BLOCK,  // Spin the core until the writer frees up space
+    LOG_SAMPLE  // Keep one in every sampleRate records once a buffer is mostly full
+};
+
+int parseLogPolicy(std::string policy) {
+    std::map<std::string, LogPolicy> policyMap = {
+        {"drop", LOG_DROP},
+        {"block", LOG_BLOCK},
+        {"sample", LOG_SAMPLE}
+    };
+
+    if (policyMap.find(policy) == policyMap.end()) {
+        return -1;
+    }
+
+    return policyMap[policy];
+}
+
+// localtime fills one buffer shared by every thread and system, the reentrant forms fill the caller's
+inline std::tm toLocalTime(time_t time) {
+    std::tm local;
+#ifdef _WIN32
+    localtime_s(&local, &time);
+#else
+    localtime_r(&time, &local);
+#endif
+    return local;
+}
+
+struct LogRecord {
+    Process* process;
+    time_t time;
+    int coreId;
+    int32_t printed; // Process::printed of the line
+    bool last; // Final instruction of the process, lets the writer close its file
+};
+
+class LogWriter {
+    private:
+        static const size_t BUFFER_CAPACITY = 8192;
+        static const size_t BATCH_SIZE = 1024;
+        static const long long SAMPLE_RATE = 16;
+        static const size_t MAX_OPEN_FILES = 64; // Beyond this the least recently written file is closed
+
+        struct OpenLog {
+            FILE* file;
+            std::list<int>::iterator use;
+        };
+
+        typedef RingBuffer<LogRecord, BUFFER_CAPACITY> CoreLogBuffer;
+
+        std::vector<std::unique_ptr<CoreLogBuffer>> buffers; // One per producing thread, a core or a pool worker
+        std::vector<long long> sampleCounters;
+        std::map<int, OpenLog> files; // Open log file per process id, owned by the writer thread
+        std::list<int> recent;      // Process ids of the open files, most recently written first
+        std::set<int> started;      // Processes whose file has its header, a closed one is reopened for appending
+        std::thread t;
+        std::atomic<bool> active;
+        std::atomic<bool> enabled;
+        std::atomic<int> policy;
+        std::atomic<unsigned long long> written;
+        std::atomic<unsigned long long> dropped;
+        std::atomic<bool> closeRequested; // Set by quiesce, cleared by the writer thread once its files are closed
+        time_t cachedTime;
+        std::string cachedTimestamp;
+
+        const std::string& formatTime(time_t time) {
+            if(time != cachedTime || cachedTimestamp.empty()) {
+                char buffer[64];
+                std::tm now = toLocalTime(time);
+                strftime(buffer, sizeof(buffer), "%m/%d/%Y, %I:%M:%S %p", &now);
+                cachedTimestamp = buffer;
+                cachedTime = time;
+            }
+
+            return cachedTimestamp;
+        }
+
+        void closeFile(int id) {
+            auto it = files.find(id);
+
+            if(it != files.end()) {
+                fclose(it->second.file);
+                recent.erase(it->second.use);
+                files.erase(it);
+            }
+        }
+
+        FILE* getFile(Process* p) {
+            auto it = files.find(p->id);
+
+            if(it != files.end()) {
+                recent.splice(recent.begin(), recent, it->second.use);
+                return it->second.file;
+            }
+
+            if(files.size() >= MAX_OPEN_FILES) {
+                closeFile(recent.back());
+            }
+
+            bool append = started.count(p->id) > 0;
+            FILE* f = fopen(p->logFilePath.c_str(), append ? "a" : "w");
+
+            if(f == nullptr) {
+                return nullptr;
+            }
+
+            setvbuf(f, nullptr, _IOFBF, 1 << 16);
+            if(!append) {
+                fprintf(f, "Process name: %s\n", p->name.c_str());
+                fprintf(f, "Logs:\n\n");
+                started.insert(p->id);
+            }
+
+            recent.push_front(p->id);
+            files.insert({p->id, { f, recent.begin() }});
+            return f;
+        }
+
+        void write(const LogRecord& record) {
+            //A last line that printed nothing only closes the file, if there is one
+            auto open = files.find(record.process->id);
+            FILE* f = record.printed != PRINT_NONE ? getFile(record.process) : (open != files.end() ? open->second.file : nullptr);
+
+            if(f != nullptr && record.printed == PRINT_TEXT) {
+                fprintf(f, "(%s) Core:%d \"Hello world from %s\"\n", formatTime(record.time).c_str(), record.coreId, record.process->name.c_str());
+            } else if(f != nullptr && record.printed != PRINT_NONE) {
+                fprintf(f, "(%s) Core:%d \"Value from v%d: %d\"\n", formatTime(record.time).c_str(), record.coreId,
+                        (int) (record.printed >> 16), (int) (record.printed & 0xFFFF));
+            }
+
+            if(record.last) {
+                closeFile(record.process->id);
+                started.erase(record.process->id);
+            }
+
+            //A line whose file could not be opened is lost
+            if(record.printed != PRINT_NONE) {
+                (f != nullptr ? written : dropped).fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        size_t drain() {
+            LogRecord record;
+            size_t total = 0;
+
+            for(auto& buffer: buffers) {
+                size_t count = 0;
+
+                while(count < BATCH_SIZE && buffer->pop(record)) {
+                    write(record);
+                    count++;
+                }
+
+                total += count;
+            }
+
+            return total;
+        }
+
+    public:
+        LogWriter() {
+            active.store(false);
+            enabled.store(true);
+            policy.store(LOG_BLOCK);
+            written.store(0);
+            dropped.store(0);
+            closeRequested.store(false);
+            cachedTime = 0;
+        }
+
+        ~LogWriter() {
+            turnOff();
+        }
+
+        void init(int channels) {
+            for(int i = 0; i < channels; i++) {
+                buffers.push_back(std::make_unique<CoreLogBuffer>());
+                sampleCounters.push_back(0);
+            }
+        }
+
+        void start() {
+            active.store(true);
+            t = std::thread(run, this);
+        }
+
+        void closeFiles() {
+            for(const auto& file: files) {
+                fclose(file.second.file);
+            }
+
+            files.clear();
+            recent.clear();
+        }
+
+        void run() {
+            while(active.load()) {
+                if(closeRequested.load()) {
+                    while(drain() > 0) {}
+                    closeFiles();
+                    closeRequested.store(false);
+                }
+
+                if(drain() == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+
+            while(drain() > 0) {} // Flush whatever the cores produced before shutdown
+            closeFiles();
+        }
+
+        // Called from the only thread producing into buffers[channel], the core's own thread or its pool worker
+        void push(int channel, int coreId, Process* p, int32_t printed, bool last) {
+            //With logging off a last line still goes through, printing nothing, to close the file
+            if(!enabled.load(std::memory_order_relaxed)) {
+                if(!last) {
+                    return;
+                }
+                printed = PRINT_NONE;
+            }
+
+            CoreLogBuffer* buffer = buffers[channel].get();
+            LogRecord record = { p, std::time(nullptr), coreId, printed, last };
+            int currentPolicy = policy.load(std::memory_order_relaxed);
+
+            if(currentPolicy == LOG_SAMPLE && buffer->size() > BUFFER_CAPACITY * 3 / 4 && !last) {
+                if(sampleCounters[channel]++ % SAMPLE_RATE != 0) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            while(!buffer->push(record)) {
+                //The last record of a process always waits so that its file gets closed
+                if((currentPolicy != LOG_BLOCK && !last) || !active.load()) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+
+        // Writes everything pushed so far and closes the open files, so the processes the records point
+        // to can be replaced. Only while no core is producing, at a tick boundary.
+        void quiesce() {
+            if(!active.load()) {
+                return;
+            }
+
+            closeRequested.store(true);
+            while(closeRequested.load() && active.load()) {}
+        }
+
+        void turnOff() {
+            active.store(false);
+            join();
+        }
+
+        void join() {
+            if(this->t.joinable()) {
+                this->t.join();
+            }
+        }
+
+        void setEnabled(bool enabled) {
+            this->enabled.store(enabled);
+        }
+
+        bool isEnabled() {
+            return enabled.load();
+        }
+
+        void setPolicy(LogPolicy policy) {
+            this->policy.store(policy);
+        }
+
+        LogPolicy getPolicy() {
+            return (LogPolicy) policy.load();
+        }
+
+        unsigned long long getWritten() {
+            return written.load();
+        }
+
+        unsigned long long getDropped() {
+            return dropped.load();
+        }
+};
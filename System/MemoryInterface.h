@@ -7,23 +7,47 @@
 #include<vector>
 #include<condition_variable>
 #include<sstream>
+#include<map>
+#include<algorithm>
 #include "../DataTypes/Memory.h"
 #include "../DataTypes/Freelist.h"
 #include "./BackingStore.h"
 #include "./Core.h"
+#include "./Tracer.h"
+#include "../DataTypes/Seqlock.h"
+#include "../DataTypes/ProcessTable.h"
 
 struct ProcessMemory {
     uint64_t startAddress;
     uint64_t endAddress;
-    std::string process_name;
+    uint32_t pid;
+};
+
+// A flat chunk or paging frame as a checkpoint saves it
+struct MemoryBlock {
+    uint64_t startAddress;
+    uint64_t size;
+    uint32_t owningPid;     // INVALID_PID while free
+    uint32_t freeRank;      // Position of a free frame in the paging free list
 };
 
 struct MemoryStats {
     uint64_t processes_in_memory;
-    uint64_t totalFragmentation;
-    std::vector<ProcessMemory> processMemoryRegions;
+    uint64_t totalFragmentation;     // Total free memory
     uint64_t pagedInCount;
     uint64_t pagedOutCount; 
+    uint64_t usedMemory;
+    uint64_t largestFreeChunk;
+    uint64_t externalFragmentation;  // Free memory outside of the largest free chunk
+    uint64_t compactedBytes;         // Moved by compaction
+    uint64_t swappedOutBytes;        // Written to the backing store by evictions
+    uint64_t swapAvoidedBytes;       // Allocated after waiting for compaction instead of evicting
+    uint64_t allocations;            // Paging allocations that succeeded
+    uint64_t framesAllocated;        // Frames they handed out, a huge frame counting once
+    uint64_t hugeFramesInUse;
+    uint64_t hugePromotions;         // A huge frame replaced a run's worth of a process's frames
+    uint64_t hugeDemotions;          // A free huge frame was split to hand out its frames
+    uint64_t hugeFallbacks;          // Allocations that got frames because no huge frame was free
 };
 
 
@@ -47,9 +71,32 @@ class AbstractMemoryInterface {
         std::condition_variable cv;
         std::string (*getCurrentTimestamp)();
         BackingStore backingStore;
+        std::string logDirectory = "./Logs/";
         std::vector<Core*>* cores;
-
-        virtual MemoryStats computeMemoryStats() { return {0, 0, {}}; };
+        Tracer* tracer = nullptr;
+        ProcessTable* processes = nullptr;
+
+        //Running counters updated under mtx by allocate and nonLockingFree, then published for lock-free readers
+        MemoryStats counters = {};
+        Seqlock<MemoryStats> metrics;
+        uint64_t usableMemory = 0; // Memory that can be handed out, excludes a partial last frame
+        uint64_t compactionBudget = 0; // Bytes compaction may move per tick, 0 to always evict instead
+
+        virtual std::vector<ProcessMemory> computeMemoryRegions() { return {}; };
+        virtual void rebuildLayout(const std::vector<MemoryBlock>& blocks) {};
+        virtual uint64_t computeLargestFreeChunk() { return 0; };
+
+        //Caller must hold mtx, which also makes it the only seqlock writer
+        void updateCounters(int64_t usedDelta, int64_t processDelta) {
+            counters.usedMemory += usedDelta;
+            counters.processes_in_memory += processDelta;
+            counters.largestFreeChunk = computeLargestFreeChunk();
+            counters.totalFragmentation = usableMemory - std::min(usableMemory, counters.usedMemory);
+            counters.externalFragmentation = counters.totalFragmentation - std::min(counters.totalFragmentation, counters.largestFreeChunk);
+            counters.pagedInCount = backingStore.getPagedIn();
+            counters.pagedOutCount = backingStore.getPagedOut();
+            metrics.write(counters);
+        }
 
         virtual Process* getFirstWithFreeable() {
             Process* p = nullptr;
@@ -65,6 +112,20 @@ class AbstractMemoryInterface {
         }
 
         virtual void nonLockingFree(AllocatedMemory* allocated) {}
+
+        //Frees every block owned by one process
+        void nonLockingRelease(const std::vector<AllocatedMemory*>& allocated) {
+            if(allocated.empty()) {
+                return;
+            }
+
+            for(const auto& memory: allocated) {
+                nonLockingFree(memory);
+            }
+
+            updateCounters(0, -1);
+        }
+
     public:
         AbstractMemoryInterface() {}
 
@@ -80,6 +141,26 @@ class AbstractMemoryInterface {
 
         virtual ~AbstractMemoryInterface() {};
 
+        // Memory stamps go to <root>/Logs, swapped out processes to <root>/BackingStore
+        void setOutputDirectory(const std::string& root) {
+            this->logDirectory = root + "/Logs/";
+            backingStore.open(std::filesystem::path(root) / "BackingStore");
+        }
+
+        void setTracer(Tracer* tracer) {
+            this->tracer = tracer;
+        }
+
+        void setProcessTable(ProcessTable* processes) {
+            this->processes = processes;
+        }
+
+        //Names are only looked up when rendering, allocation tracks owners by pid
+        std::string getOwnerName(uint32_t pid) {
+            Process* p = processes == nullptr ? nullptr : processes->at(pid);
+            return p == nullptr ? std::to_string(pid) : p->name;
+        }
+
         virtual void addToProcessList(Process* p) {
             std::unique_lock<std::mutex> lock(mtx);
             processesList.insert(p);
@@ -92,7 +173,7 @@ class AbstractMemoryInterface {
             lock.unlock();
         };
 
-        virtual void reserve(uint64_t size, std::string processName) {
+        virtual void reserve(uint64_t size, uint32_t pid) {
             std::unique_lock<std::mutex> lock(mtx);
             while(size > availableMemory) {
                 Process* p = getFirstWithFreeable();
@@ -101,15 +182,23 @@ class AbstractMemoryInterface {
                     break;
                 }
 
+                uint64_t freedSize = 0;
+
+                for(const auto& memory: p->allocatedMemory) {
+                    freedSize += memory->size;
+                }
+
                 if(p->core != -1 && p->completed) {
+                    tracer->record(TRACE_FREE, p->core, p->id, freedSize);
                     cores->at(p->core)->finish();
                 } else {
-                    backingStore.store(p);
+                    tracer->record(TRACE_EVICT, p->core, p->id, freedSize);
+                    backingStore.store(p); //Paged out count is published by the release below
+                    p->swaps++;
+                    counters.swappedOutBytes += freedSize;
                 }
 
-                for(const auto& memory: p->allocatedMemory) {
-                    nonLockingFree(memory);
-                }
+                nonLockingRelease(p->allocatedMemory);
 
                 p->allocatedMemory = {};
 
@@ -118,17 +207,98 @@ class AbstractMemoryInterface {
             lock.unlock();
         }
 
-        virtual uint64_t fetchFromBackingStore(std::string process_name) {
+        // Runs once per tick on the scheduler thread, before any dispatch
+        virtual void compact() {}
+
+        void setCompactionBudget(uint64_t budget) {
+            std::lock_guard<std::mutex> lock(mtx);
+            this->compactionBudget = budget;
+        }
+
+        virtual uint64_t fetchFromBackingStore(uint32_t pid) {
             std::lock_guard<std::mutex> lock(mtx);
-            return backingStore.retrieve(process_name);
+            uint64_t size = backingStore.retrieve(pid);
+
+            if(size != 0) {
+                updateCounters(0, 0);
+            }
+
+            return size;
         }
 
-        virtual std::vector<AllocatedMemory*> allocate(uint64_t size, std::string owningProcess) { return {}; };
-        virtual void free(AllocatedMemory* allocated) {};
+        virtual std::vector<AllocatedMemory*> allocate(uint64_t size, uint32_t owningPid) { return {}; };
         virtual void printMemory(long long quantum_cycle) {};
 
+        void release(const std::vector<AllocatedMemory*>& allocated) {
+            std::unique_lock<std::mutex> lock(mtx);
+            nonLockingRelease(allocated);
+            lock.unlock();
+        }
+
+        // Every chunk or frame in address order
+        virtual std::vector<MemoryBlock> exportLayout() { return {}; };
+
+        // Pids of the processes that may be swapped out
+        std::vector<uint32_t> exportEvictable() {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::vector<uint32_t> pids;
+
+            for(const auto& process: processesList) {
+                pids.push_back(process->handle.pid);
+            }
+
+            return pids;
+        }
+
+        std::map<uint32_t, uint64_t> exportSwapped() {
+            return backingStore.exportSizes();
+        }
+
+        // Replaces the whole memory state at a tick boundary, after the process table was restored. Blocks
+        // must cover memory exactly as exportLayout() would, their owners get them as allocatedMemory.
+        void importState(const std::vector<MemoryBlock>& blocks, const std::vector<Process*>& evictable,
+                         const std::map<uint32_t, uint64_t>& swapped, uint64_t pagedIn, uint64_t pagedOut) {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::map<uint32_t, std::string> names;
+            std::set<uint32_t> owners;
+
+            for(const auto& entry: swapped) {
+                names.insert({entry.first, processes->at(entry.first)->name});
+            }
+            backingStore.importSizes(swapped, names, pagedIn, pagedOut);
+
+            rebuildLayout(blocks);
+            processesList = std::set<Process*, ProcessAgeComparator>(evictable.begin(), evictable.end());
+
+            counters.usedMemory = 0;
+            for(const auto& block: blocks) {
+                if(block.owningPid != INVALID_PID) {
+                    counters.usedMemory += block.size;
+                    owners.insert(block.owningPid);
+                }
+            }
+
+            availableMemory = memorySize - counters.usedMemory;
+            counters.processes_in_memory = owners.size();
+            updateCounters(0, 0);
+        }
+
+        uint64_t getMemorySize() {
+            return memorySize;
+        }
+
+        virtual uint64_t getFrameSize() {
+            return 0;
+        }
+
+        //O(1) snapshot of the running counters, does not take the memory lock
         virtual MemoryStats getMemoryStats() {
-            return computeMemoryStats();
+            return metrics.read();
+        }
+
+        //Materializes the full list of process memory regions, takes the memory lock
+        std::vector<ProcessMemory> getMemoryRegions() {
+            return computeMemoryRegions();
         }
 
         virtual uint64_t getAvailableMemory() {
@@ -137,39 +307,167 @@ class AbstractMemoryInterface {
         }
 };
 
+const uint64_t DEFAULT_COMPACTION_BUDGET = 256; // Bytes moved per tick
+
 class FlatMemoryInterface: public AbstractMemoryInterface {
     private:
         MemoryChunk* memoryStart;
+        std::map<uint32_t, uint64_t> compactionWaiters; // Reserves that waited for compaction instead of evicting, pid to size
+
+        // Compaction is done once the largest hole fits every waiting reserve
+        bool needsCompaction() {
+            uint64_t largest = ((FirstFitFreeList*) freeList)->getLargest();
+
+            for(const auto& waiter: compactionWaiters) {
+                if(waiter.second > largest) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // Drops the waiters whose process is gone or that need more than hole, their next reserve evicts instead
+        void dropWaiters(uint64_t hole) {
+            for(auto waiter = compactionWaiters.begin(); waiter != compactionWaiters.end(); ) {
+                if(processes->at(waiter->first) == nullptr || waiter->second > hole) {
+                    waiter = compactionWaiters.erase(waiter);
+                } else {
+                    ++waiter;
+                }
+            }
+        }
 
-        MemoryStats computeMemoryStats() override {
+        // Resident and off the cores, the same processes reserve may swap out
+        bool isMovable(const MemoryChunk* chunk) {
+            Process* owner = processes->at(chunk->owningPid);
+            return owner != nullptr && processesList.count(owner) > 0;
+        }
+
+        // The largest hole compaction could make: chunks that cannot move split memory into segments,
+        // and sliding the rest of a segment down gathers all its free memory into one hole
+        uint64_t computeCompactableHole() {
+            uint64_t largest = 0;
+            uint64_t segment = 0;
+
+            for(MemoryChunk* chunk = memoryStart; chunk != nullptr; chunk = chunk->next) {
+                if(!chunk->isInUse) {
+                    segment += chunk->size;
+                    largest = std::max(largest, segment);
+                } else if(!isMovable(chunk)) {
+                    segment = 0;
+                }
+            }
+
+            return largest;
+        }
+
+        // Swaps a hole with the in use chunk right above it, so the chunk moves down and the hole up,
+        // where it merges with a free chunk above. Returns the hole.
+        MemoryChunk* slide(MemoryChunk* hole, MemoryChunk* chunk) {
+            MemoryChunk* before = hole->prev;
+            MemoryChunk* after = chunk->next;
+            uint64_t start = hole->startAddress;
+
+            freeList->remove(hole);
+
+            chunk->startAddress = start;
+            chunk->endAddress = start + chunk->size - 1;
+            hole->startAddress = start + chunk->size;
+            hole->endAddress = hole->startAddress + hole->size - 1;
+
+            chunk->prev = before;
+            chunk->next = hole;
+            hole->prev = chunk;
+            hole->next = after;
+
+            if(before != nullptr) {
+                before->next = chunk;
+            } else {
+                this->memoryStart = chunk;
+            }
+
+            if(after != nullptr) {
+                after->prev = hole;
+
+                if(!after->isInUse) {
+                    freeList->remove(after);
+                    hole->size += after->size;
+                    hole->endAddress = after->endAddress;
+                    hole->next = after->next;
+
+                    if(after->next != nullptr) {
+                        after->next->prev = hole;
+                    }
+
+                    delete after;
+                }
+            }
+
+            freeList->push(hole);
+            return hole;
+        }
+
+        std::vector<ProcessMemory> computeMemoryRegions() override {
             std::unique_lock<std::mutex> lock(mtx);
-            MemoryStats stats = {0, 0, {}, 0, 0};
+            std::vector<ProcessMemory> regions;
 
             MemoryChunk *temp;
             temp = memoryStart;
             do {
                 if(temp->isInUse) {
-                    stats.processes_in_memory += 1;
-                    stats.processMemoryRegions.push_back({temp->startAddress, temp->endAddress, temp->owningProcess});
-                } else {
-                    stats.totalFragmentation += temp->size;
+                    regions.push_back({temp->startAddress, temp->endAddress, temp->owningPid});
                 }
                 temp = temp->next;
             } while(temp != nullptr);
 
-            stats.pagedInCount = backingStore.getPagedIn();
-            stats.pagedOutCount = backingStore.getPagedOut();
-
             lock.unlock();
-            return stats;
+            return regions;
+        }
+
+        uint64_t computeLargestFreeChunk() override {
+            return ((FirstFitFreeList*) freeList)->getLargest();
+        }
+
+        void rebuildLayout(const std::vector<MemoryBlock>& blocks) override {
+            MemoryChunk* previous = nullptr;
+
+            for(MemoryChunk* chunk = memoryStart; chunk != nullptr; ) {
+                MemoryChunk* next = chunk->next;
+                delete chunk;
+                chunk = next;
+            }
+
+            delete freeList;
+            freeList = new FirstFitFreeList();
+            compactionWaiters.clear();
+
+            for(const auto& block: blocks) {
+                bool inUse = block.owningPid != INVALID_PID;
+                MemoryChunk* chunk = new MemoryChunk(block.size, block.startAddress, nullptr, previous, block.owningPid, inUse);
+
+                if(previous == nullptr) {
+                    memoryStart = chunk;
+                } else {
+                    previous->next = chunk;
+                }
+
+                if(inUse) {
+                    processes->at(block.owningPid)->allocatedMemory.push_back(chunk);
+                } else {
+                    freeList->push(chunk);
+                }
+                previous = chunk;
+            }
         }
 
         void nonLockingFree(AllocatedMemory* allocated) override {
             MemoryChunk* chunk = (MemoryChunk*) allocated;
             MemoryChunk* previousChunk = (chunk)->prev;
             MemoryChunk* nextChunk = chunk->next;
+            uint64_t freedSize = chunk->size;
 
-            chunk->owningProcess = "";
+            chunk->owningPid = INVALID_PID;
             chunk->isInUse = false;
 
             if(previousChunk != nullptr) {
@@ -219,6 +517,8 @@ class FlatMemoryInterface: public AbstractMemoryInterface {
 
             //Add the freed and coalesced chunk into the freelist
             freeList->push(chunk);
+            availableMemory += freedSize;
+            updateCounters(-(int64_t) freedSize, 0);
         }
 
     public:
@@ -240,32 +540,55 @@ class FlatMemoryInterface: public AbstractMemoryInterface {
             this->availableMemory = memorySize;
             this->startAddress = 0;
             this->endAddress = memorySize - 1;
-            this->memoryStart = new MemoryChunk(memorySize, 0, nullptr, nullptr, "", false);
+            this->memoryStart = new MemoryChunk(memorySize, 0, nullptr, nullptr, INVALID_PID, false);
             this->freeList = new FirstFitFreeList();
             this->freeList->push(memoryStart);
             this->getCurrentTimestamp = getCurrentTimestamp;
             this->cores = cores;
             this->backingStore.init(false);
+            this->usableMemory = memorySize;
+            updateCounters(0, 0);
+        }
+
+        // A process that leaves the list is running, finished or released, it no longer waits for a hole
+        void removeFromProcessList(Process* p) override {
+            std::lock_guard<std::mutex> lock(mtx);
+            processesList.erase(p);
+            compactionWaiters.erase(p->handle.pid);
         }
 
-        void reserve(uint64_t size, std::string processName) override {
+        void reserve(uint64_t size, uint32_t pid) override {
             std::unique_lock<std::mutex> lock(mtx);
             while(!(((FirstFitFreeList*) freeList)->hasAvailable(size))) {
+                //Compaction will make the hole within a few ticks, the process waits for it like for any memory
+                if(compactionBudget > 0 && computeCompactableHole() >= size) {
+                    compactionWaiters[pid] = size;
+                    break;
+                }
+
                 Process* p = getFirstWithFreeable();
 
                 if(p == nullptr) {
                     break;
                 }
 
+                uint64_t freedSize = 0;
+
+                for(const auto& memory: p->allocatedMemory) {
+                    freedSize += memory->size;
+                }
+
                 if(p->core != -1 && p->completed) {
+                    tracer->record(TRACE_FREE, p->core, p->id, freedSize);
                     cores->at(p->core)->finish();
                 } else {
-                    backingStore.store(p);
+                    tracer->record(TRACE_EVICT, p->core, p->id, freedSize);
+                    backingStore.store(p); //Paged out count is published by the release below
+                    p->swaps++;
+                    counters.swappedOutBytes += freedSize;
                 }
 
-                for(const auto& memory: p->allocatedMemory) {
-                    nonLockingFree(memory);
-                }
+                nonLockingRelease(p->allocatedMemory);
 
                 p->allocatedMemory = {};
 
@@ -274,7 +597,43 @@ class FlatMemoryInterface: public AbstractMemoryInterface {
             lock.unlock();
         }
 
-        std::vector<AllocatedMemory *> allocate(uint64_t size, std::string owningProcess) override {
+        // While a reserve waits for a hole, slides movable chunks down into the holes below them, lowest
+        // first, until compactionBudget bytes moved. A chunk larger than the budget still moves when it is
+        // the first of the tick, so every chunk gets its turn.
+        void compact() override {
+            std::lock_guard<std::mutex> lock(mtx);
+            uint64_t moved = 0;
+
+            if(compactionBudget == 0 || !needsCompaction()) {
+                return;
+            }
+
+            dropWaiters(UINT64_MAX);
+
+            MemoryChunk* chunk = memoryStart;
+            while(chunk != nullptr && chunk->next != nullptr && moved < compactionBudget && needsCompaction()) {
+                MemoryChunk* next = chunk->next;
+
+                if(!chunk->isInUse && next->isInUse && isMovable(next) && (moved == 0 || moved + next->size <= compactionBudget)) {
+                    moved += next->size;
+                    chunk = slide(chunk, next);
+                } else {
+                    chunk = next;
+                }
+            }
+
+            //Nothing left to slide, a waiter still short cannot get its hole while the processes now on the cores stay
+            if(moved == 0 && needsCompaction()) {
+                dropWaiters(computeCompactableHole());
+            }
+
+            if(moved > 0) {
+                counters.compactedBytes += moved;
+                updateCounters(0, 0);
+            }
+        }
+
+        std::vector<AllocatedMemory *> allocate(uint64_t size, uint32_t owningPid) override {
             std::unique_lock<std::mutex> lock(mtx);
             MemoryChunk* allocated = (MemoryChunk*) freeList->pop(size);
 
@@ -282,36 +641,47 @@ class FlatMemoryInterface: public AbstractMemoryInterface {
                 return {};
             }
 
-            allocated->owningProcess = owningProcess;
+            allocated->owningPid = owningPid;
 
             if(allocated->startAddress == 0) {
                 this->memoryStart = allocated;
             }
 
+            if(compactionWaiters.erase(owningPid) > 0) {
+                counters.swapAvoidedBytes += size;
+            }
+
             availableMemory -= size;
+            updateCounters(size, 1);
 
             lock.unlock();
             return { allocated };
         }
+        
+        std::vector<MemoryBlock> exportLayout() override {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::vector<MemoryBlock> blocks;
 
-        void free(AllocatedMemory* allocated) override {
-            std::unique_lock<std::mutex> lock(mtx);
-            nonLockingFree(allocated);
-            lock.unlock();
+            for(MemoryChunk* chunk = memoryStart; chunk != nullptr; chunk = chunk->next) {
+                blocks.push_back({ chunk->startAddress, chunk->size, chunk->isInUse ? chunk->owningPid : INVALID_PID, 0 });
+            }
+
+            return blocks;
         }
-        
+
         void printMemory(long long quantum_cycle) override {
-            MemoryStats stats = computeMemoryStats();
+            std::vector<ProcessMemory> regions = computeMemoryRegions();
+            MemoryStats stats = getMemoryStats();
             std::ostringstream oss;
 
-            std::string fileMemoryPath = "./Logs/memory_stamp_" + std::to_string(quantum_cycle) + ".txt";
+            std::string fileMemoryPath = logDirectory + "memory_stamp_" + std::to_string(quantum_cycle) + ".txt";
             FILE* f = fopen(fileMemoryPath.c_str(), "a");
             fprintf(f, "Timestamp: (%s)\n", getCurrentTimestamp().c_str());
             fprintf(f, "Number of process in memory: %llu\n", stats.processes_in_memory);
             fprintf(f, "Total external fragmentation in KB: %llu\n", stats.totalFragmentation);
             fprintf(f, "----end---- = %llu\n\n", endAddress);
-            for (auto memoryRegion = stats.processMemoryRegions.rbegin(); memoryRegion != stats.processMemoryRegions.rend(); ++memoryRegion) {
-                oss << memoryRegion->endAddress << "\n" << memoryRegion->process_name << "\n" << memoryRegion->startAddress << "\n\n";                
+            for (auto memoryRegion = regions.rbegin(); memoryRegion != regions.rend(); ++memoryRegion) {
+                oss << memoryRegion->endAddress << "\n" << getOwnerName(memoryRegion->pid) << "\n" << memoryRegion->startAddress << "\n\n";                
             }
             fprintf(f, "%s", oss.str().c_str());
             fprintf(f, "----start---- = %llu\n\n", startAddress);
@@ -324,54 +694,153 @@ class PagingMemoryInterface: public AbstractMemoryInterface {
         uint64_t frameSize;
         std::vector<MemoryFrame*> memoryMap;
 
-        MemoryStats computeMemoryStats() override {
+        // A huge frame covers an aligned run of framesPerHuge frames. The frames of a run that is entirely
+        // free stay off the free list, so huge frames are taken from freeRuns and frames from the list,
+        // which only splits a free run when it runs dry.
+        uint64_t hugeFrameSize = 0;             // 0 without huge frames
+        uint64_t framesPerHuge = 1;
+        std::vector<MemoryFrame*> hugeMap;      // One per run, a partial run at the end of memory has none
+        std::vector<uint64_t> runFree;          // Free frames of each run
+        std::set<uint64_t> freeRuns;
+        std::set<uint32_t> promotionCandidates; // Pids that may hold a run's worth of frames
+
+        FirstFitPagingFreeList* frameList() {
+            return (FirstFitPagingFreeList*) freeList;
+        }
+
+        uint64_t getFreeMemory() {
+            return frameList()->getAvailableMemory() + freeRuns.size() * hugeFrameSize;
+        }
+
+        // The run a frame belongs to, hugeMap.size() if none
+        uint64_t runOf(const MemoryFrame* frame) {
+            uint64_t run = hugeFrameSize == 0 ? hugeMap.size() : frame->frameNumber / framesPerHuge;
+            return run < hugeMap.size() ? run : hugeMap.size();
+        }
+
+        // Frees a frame onto the list, or takes its run off the list once the whole run is free
+        void pushFrame(MemoryFrame* frame) {
+            uint64_t run = runOf(frame);
+            frame->owningPid = INVALID_PID;
+            frame->isInUse = false;
+
+            if(run == hugeMap.size() || ++runFree[run] < framesPerHuge) {
+                freeList->push(frame);
+                return;
+            }
+
+            for(uint64_t i = run * framesPerHuge; i < (run + 1) * framesPerHuge; i++) {
+                freeList->remove(memoryMap[i]);
+            }
+            freeRuns.insert(run);
+        }
+
+        MemoryFrame* popFrame() {
+            if(frameList()->getAvailableMemory() == 0) {
+                auto last = std::prev(freeRuns.end()); //Low runs are left for huge frames
+                uint64_t run = *last;
+                freeRuns.erase(last);
+                counters.hugeDemotions++;
+
+                for(uint64_t i = run * framesPerHuge; i < (run + 1) * framesPerHuge; i++) {
+                    freeList->push(memoryMap[i]);
+                }
+            }
+
+            MemoryFrame* frame = frameList()->pop(frameSize);
+            uint64_t run = runOf(frame);
+
+            if(run != hugeMap.size()) {
+                runFree[run]--;
+            }
+            return frame;
+        }
+
+        MemoryFrame* claimRun(uint64_t run, uint32_t owningPid) {
+            for(uint64_t i = run * framesPerHuge; i < (run + 1) * framesPerHuge; i++) {
+                memoryMap[i]->owningPid = owningPid;
+                memoryMap[i]->isInUse = true;
+            }
+
+            runFree[run] = 0;
+            hugeMap[run]->owningPid = owningPid;
+            hugeMap[run]->isInUse = true;
+            counters.hugeFramesInUse++;
+            return hugeMap[run];
+        }
+
+        // Replaces the frames of every run the process owns entirely by its huge frame, in place
+        void promoteOwnedRuns(std::vector<AllocatedMemory*>& allocated, uint32_t owningPid) {
+            std::map<uint64_t, uint64_t> owned;
+            std::vector<AllocatedMemory*> kept;
+
+            for(const auto& memory: allocated) {
+                uint64_t run = memory->size == frameSize ? runOf((MemoryFrame*) memory) : hugeMap.size();
+                if(run != hugeMap.size()) {
+                    owned[run]++;
+                }
+            }
+
+            for(const auto& memory: allocated) {
+                uint64_t run = memory->size == frameSize ? runOf((MemoryFrame*) memory) : hugeMap.size();
+                if(run == hugeMap.size() || owned[run] < framesPerHuge) {
+                    kept.push_back(memory);
+                }
+            }
+
+            for(const auto& entry: owned) {
+                if(entry.second == framesPerHuge) {
+                    kept.push_back(claimRun(entry.first, owningPid));
+                    counters.hugePromotions++;
+                }
+            }
+
+            allocated = kept;
+        }
+
+        std::vector<ProcessMemory> computeMemoryRegions() override {
             std::unique_lock<std::mutex> lock(mtx);
-            std::set<std::string> unique_processes;
-            MemoryStats stats = {0, 0, {}};
-            ProcessMemory currentProcess = {0, 0, ""};
+            std::vector<ProcessMemory> regions;
+            ProcessMemory currentProcess = {0, 0, INVALID_PID};
 
             for(const auto& frame: memoryMap) {
                 if(frame->isInUse) {
-                    if(currentProcess.process_name != frame->owningProcess) {
-                        if(currentProcess.process_name != "") { 
-                            stats.processMemoryRegions.push_back(currentProcess);
+                    if(currentProcess.pid != frame->owningPid) {
+                        if(currentProcess.pid != INVALID_PID) { 
+                            regions.push_back(currentProcess);
                         }
 
-                        currentProcess.process_name = frame->owningProcess;
+                        currentProcess.pid = frame->owningPid;
                         currentProcess.startAddress = frame->startAddress;
                         currentProcess.endAddress = frame->endAddress;
                     } else {
                         currentProcess.endAddress = frame->endAddress; //Update end address only as memoryFrames is in order
                     }
 
-                    unique_processes.insert(frame->owningProcess); //This wont insert if the process is already in the set
-
                 } else {
                     //Frame not in use with a non-default current process signals end of that process' memory region
-                    if(currentProcess.process_name != "") { 
-                        stats.processMemoryRegions.push_back(currentProcess);
+                    if(currentProcess.pid != INVALID_PID) { 
+                        regions.push_back(currentProcess);
                     }
 
                     //Reset the current process to default as the contiguous block for that process is done
-                    currentProcess.process_name = "";
+                    currentProcess.pid = INVALID_PID;
                     currentProcess.startAddress = 0;
                     currentProcess.endAddress = 0;
-
-                    stats.totalFragmentation += frame->size;
                 }
             }
 
-            if(currentProcess.process_name != "") { 
-                stats.processMemoryRegions.push_back(currentProcess);
+            if(currentProcess.pid != INVALID_PID) { 
+                regions.push_back(currentProcess);
             }
 
-            stats.processes_in_memory = unique_processes.size();
-            
-            stats.pagedInCount = backingStore.getPagedIn();
-            stats.pagedOutCount = backingStore.getPagedOut();
-
             lock.unlock();
-            return stats;
+            return regions;
+        }
+
+        //Any set of free frames can back an allocation, so paging has no external fragmentation
+        uint64_t computeLargestFreeChunk() override {
+            return getFreeMemory();
         }
 
         void createChunks() {
@@ -380,18 +849,99 @@ class PagingMemoryInterface: public AbstractMemoryInterface {
             MemoryFrame* addr;
 
             for(uint64_t frameNum = 0; frameNum < num_frames; frameNum++) {
-                addr = new MemoryFrame(frameSize, start_addr, frameNum, "");
+                addr = new MemoryFrame(frameSize, start_addr, frameNum, INVALID_PID);
                 this->memoryMap.push_back(addr);
-                this->freeList->push(addr);
                 start_addr += frameSize;
             }
+
+            for(uint64_t run = 0; hugeFrameSize != 0 && (run + 1) * framesPerHuge <= num_frames; run++) {
+                this->hugeMap.push_back(new MemoryFrame(hugeFrameSize, run * hugeFrameSize, run * framesPerHuge, INVALID_PID));
+            }
+            this->runFree.assign(hugeMap.size(), 0);
+
+            for(const auto& frame: memoryMap) {
+                pushFrame(frame);
+            }
+        }
+
+        //Blocks are the frames in order, free frames go back on the free list in their saved order. A run
+        //owned entirely by one process is always held as its huge frame, so the frames say which they were.
+        void rebuildLayout(const std::vector<MemoryBlock>& blocks) override {
+            std::vector<std::pair<uint32_t, MemoryFrame*>> free;
+            std::map<uint32_t, std::vector<AllocatedMemory*>> owned;
+            uint64_t promotions = counters.hugePromotions; //Restored runs were not promoted
+
+            delete freeList;
+            freeList = new FirstFitPagingFreeList(frameSize);
+            freeRuns.clear();
+            promotionCandidates.clear();
+            runFree.assign(hugeMap.size(), 0);
+            counters.hugeFramesInUse = 0;
+
+            for(const auto& huge: hugeMap) {
+                huge->owningPid = INVALID_PID;
+                huge->isInUse = false;
+            }
+
+            for(size_t i = 0; i < memoryMap.size(); i++) {
+                MemoryFrame* frame = memoryMap[i];
+                frame->owningPid = blocks[i].owningPid;
+                frame->isInUse = blocks[i].owningPid != INVALID_PID;
+
+                if(frame->isInUse) {
+                    owned[frame->owningPid].push_back(frame);
+                } else {
+                    free.push_back({ blocks[i].freeRank, frame });
+                }
+            }
+
+            for(auto& entry: owned) {
+                promoteOwnedRuns(entry.second, entry.first);
+                processes->at(entry.first)->allocatedMemory = entry.second;
+
+                if(hugeFrameSize != 0 && countFrames(entry.second) >= framesPerHuge) {
+                    promotionCandidates.insert(entry.first);
+                }
+            }
+
+            std::stable_sort(free.begin(), free.end(), [](const auto& x, const auto& y) { return x.first < y.first; });
+            for(const auto& entry: free) {
+                pushFrame(entry.second);
+            }
+            counters.hugePromotions = promotions;
+        }
+
+        uint64_t countFrames(const std::vector<AllocatedMemory*>& allocated) {
+            uint64_t frames = 0;
+
+            for(const auto& memory: allocated) {
+                frames += memory->size == frameSize;
+            }
+            return frames;
         }
 
         void nonLockingFree(AllocatedMemory* allocated) override {
-            allocated->owningProcess = "";
-            allocated->isInUse = false;
-            freeList->push(allocated);
+            promotionCandidates.erase(allocated->owningPid);
+
+            if(allocated->size == frameSize) {
+                pushFrame((MemoryFrame*) allocated);
+            } else {
+                uint64_t run = runOf((MemoryFrame*) allocated);
+
+                for(uint64_t i = run * framesPerHuge; i < (run + 1) * framesPerHuge; i++) {
+                    memoryMap[i]->owningPid = INVALID_PID;
+                    memoryMap[i]->isInUse = false;
+                }
+
+                allocated->owningPid = INVALID_PID;
+                allocated->isInUse = false;
+                runFree[run] = framesPerHuge;
+                freeRuns.insert(run);
+                counters.hugeFramesInUse--;
+            }
+
             availableMemory += allocated->size;
+            updateCounters(-(int64_t) allocated->size, 0);
         }
 
     public:
@@ -401,27 +951,67 @@ class PagingMemoryInterface: public AbstractMemoryInterface {
             for(const auto& frame: memoryMap) {
                 delete frame;
             }
+
+            for(const auto& huge: hugeMap) {
+                delete huge;
+            }
         }
 
         PagingMemoryInterface() {}
 
-        PagingMemoryInterface(uint64_t memorySize, uint64_t frameSize, std::string (*getCurrentTimestamp)(), std::vector<Core*>* cores) {
+        // hugeFrameSize is a multiple of at least two frames, or 0 for frames only
+        PagingMemoryInterface(uint64_t memorySize, uint64_t frameSize, std::string (*getCurrentTimestamp)(), std::vector<Core*>* cores,
+                              uint64_t hugeFrameSize = 0) {
             this->memorySize = memorySize;
             this->availableMemory = memorySize;
             this->startAddress = 0;
             this->endAddress = memorySize - 1;
             this->frameSize = frameSize;
+            this->hugeFrameSize = hugeFrameSize >= 2 * frameSize && hugeFrameSize % frameSize == 0 ? hugeFrameSize : 0;
+            this->framesPerHuge = this->hugeFrameSize == 0 ? 1 : this->hugeFrameSize / frameSize;
             this->freeList = new FirstFitPagingFreeList(frameSize);
             this->getCurrentTimestamp = getCurrentTimestamp;
             this->cores = cores;
             this->backingStore.init(true, frameSize);
             
             createChunks();
+            this->usableMemory = (memorySize / frameSize) * frameSize;
+            updateCounters(0, 0);
         }
 
-        std::vector<AllocatedMemory*> allocate(uint64_t size, std::string owningProcess) override {
+        std::vector<MemoryBlock> exportLayout() override {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::vector<MemoryBlock> blocks;
+            std::map<MemoryFrame*, uint32_t> ranks;
+            std::vector<MemoryFrame*> free = frameList()->getFrames();
+
+            //Free runs come after the list, which they are not on
+            for(const auto& run: freeRuns) {
+                for(uint64_t i = run * framesPerHuge; i < (run + 1) * framesPerHuge; i++) {
+                    free.push_back(memoryMap[i]);
+                }
+            }
+
+            for(size_t i = 0; i < free.size(); i++) {
+                ranks.insert({ free[i], (uint32_t) i });
+            }
+
+            for(const auto& frame: memoryMap) {
+                auto rank = ranks.find(frame);
+                blocks.push_back({ frame->startAddress, frame->size, frame->isInUse ? frame->owningPid : INVALID_PID,
+                                   rank == ranks.end() ? 0 : rank->second });
+            }
+
+            return blocks;
+        }
+
+        uint64_t getFrameSize() override {
+            return frameSize;
+        }
+
+        std::vector<AllocatedMemory*> allocate(uint64_t size, uint32_t owningPid) override {
             std::unique_lock<std::mutex> lock(mtx);
-            if(size > ((FirstFitPagingFreeList*) freeList)->getAvailableMemory()) {
+            if(size > getFreeMemory()) {
                 lock.unlock();
                 return {};
             }
@@ -430,38 +1020,96 @@ class PagingMemoryInterface: public AbstractMemoryInterface {
             uint64_t allocatedSize = 0;
             MemoryFrame* temp;
 
+            //Whole huge frames first, the rest and anything no free run can back in frames
+            while(hugeFrameSize != 0 && size - allocatedSize >= hugeFrameSize) {
+                if(freeRuns.empty()) {
+                    counters.hugeFallbacks++;
+                    break;
+                }
+
+                allocatedMem.push_back(claimRun(*freeRuns.begin(), owningPid));
+                freeRuns.erase(freeRuns.begin());
+                allocatedSize += hugeFrameSize;
+            }
+
             while(allocatedSize < size) {
-                temp = (MemoryFrame*) freeList->pop(frameSize);
-                temp->owningProcess = owningProcess;
+                temp = popFrame();
+                temp->owningPid = owningPid;
                 temp->isInUse = true;
                 allocatedMem.push_back(temp);
                 allocatedSize += frameSize;
             }
 
+            if(hugeFrameSize != 0 && countFrames(allocatedMem) >= framesPerHuge) {
+                promoteOwnedRuns(allocatedMem, owningPid);
+                promotionCandidates.insert(owningPid);
+            }
+
             availableMemory -= allocatedSize;
+            counters.allocations++;
+            counters.framesAllocated += allocatedMem.size();
+            updateCounters(allocatedSize, 1);
             
             lock.unlock();
             return allocatedMem;
         }
 
-        void free(AllocatedMemory* allocated) override {
-            std::unique_lock<std::mutex> lock(mtx);
-            nonLockingFree(allocated);
-            lock.unlock();
+        // Collapses a run's worth of frames of a process off the cores into a free huge frame, copying
+        // hugeFrameSize bytes against the compaction budget, while free runs last
+        void compact() override {
+            std::lock_guard<std::mutex> lock(mtx);
+            uint64_t moved = 0;
+
+            for(auto it = promotionCandidates.begin(); it != promotionCandidates.end() && moved < compactionBudget && !freeRuns.empty(); ) {
+                Process* p = processes->at(*it);
+
+                if(p == nullptr || countFrames(p->allocatedMemory) < framesPerHuge) {
+                    it = promotionCandidates.erase(it);
+                    continue;
+                }
+
+                if(processesList.count(p) == 0) {
+                    ++it; //On a core, its frames stay where they are
+                    continue;
+                }
+
+                std::vector<AllocatedMemory*> kept = { claimRun(*freeRuns.begin(), p->handle.pid) };
+                uint64_t taken = 0;
+
+                freeRuns.erase(freeRuns.begin());
+                for(const auto& memory: p->allocatedMemory) {
+                    if(memory->size == frameSize && taken < framesPerHuge) {
+                        pushFrame((MemoryFrame*) memory);
+                        taken++;
+                    } else {
+                        kept.push_back(memory);
+                    }
+                }
+
+                p->allocatedMemory = kept;
+                counters.hugePromotions++;
+                counters.compactedBytes += hugeFrameSize;
+                moved += hugeFrameSize;
+            }
+
+            if(moved > 0) {
+                updateCounters(0, 0);
+            }
         }
         
         void printMemory(long long quantum_cycle) override {
-            MemoryStats stats = computeMemoryStats();
+            std::vector<ProcessMemory> regions = computeMemoryRegions();
+            MemoryStats stats = getMemoryStats();
             std::ostringstream oss;
 
-            std::string fileMemoryPath = "./Logs/memory_stamp_" + std::to_string(quantum_cycle) + ".txt";
+            std::string fileMemoryPath = logDirectory + "memory_stamp_" + std::to_string(quantum_cycle) + ".txt";
             FILE* f = fopen(fileMemoryPath.c_str(), "a");
             fprintf(f, "Timestamp: (%s)\n", getCurrentTimestamp().c_str());
             fprintf(f, "Number of process in memory: %llu\n", stats.processes_in_memory);
             fprintf(f, "Total external fragmentation in KB: %llu\n", stats.totalFragmentation);
             fprintf(f, "----end---- = %llu\n\n", endAddress);
-            for (auto memoryRegion = stats.processMemoryRegions.rbegin(); memoryRegion != stats.processMemoryRegions.rend(); ++memoryRegion) {
-                oss << memoryRegion->endAddress << "\n" << memoryRegion->process_name << "\n" << memoryRegion->startAddress << "\n\n";                
+            for (auto memoryRegion = regions.rbegin(); memoryRegion != regions.rend(); ++memoryRegion) {
+                oss << memoryRegion->endAddress << "\n" << getOwnerName(memoryRegion->pid) << "\n" << memoryRegion->startAddress << "\n\n";                
             }
             fprintf(f, "%s", oss.str().c_str());
             fprintf(f, "----start---- = %llu\n\n", startAddress);
@@ -0,0 +1,84 @@
+/*
+    This file defines the background thread that periodically appends metric snapshots to a file
+*/
+#pragma once
+#include <atomic>
+#include <thread>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <algorithm>
+
+class MetricsDumper {
+    private:
+        std::thread t;
+        std::atomic<bool> active;
+        std::string path;
+        long long intervalMs;
+        std::function<std::string()> snapshot;
+
+    public:
+        MetricsDumper() {
+            active.store(false);
+            intervalMs = 1000;
+        }
+
+        ~MetricsDumper() {
+            turnOff();
+        }
+
+        bool start(const std::string& path, long long intervalMs, std::function<std::string()> snapshot) {
+            turnOff();
+
+            FILE* f = fopen(path.c_str(), "a");
+            if(f == nullptr) {
+                return false;
+            }
+            fclose(f);
+
+            this->path = path;
+            this->intervalMs = intervalMs;
+            this->snapshot = snapshot;
+            active.store(true);
+            t = std::thread(run, this);
+            return true;
+        }
+
+        void run() {
+            auto next = std::chrono::steady_clock::now();
+
+            while(active.load()) {
+                //One JSON object per line so the file can be streamed while it grows
+                FILE* f = fopen(path.c_str(), "a");
+                if(f != nullptr) {
+                    fprintf(f, "%s\n", snapshot().c_str());
+                    fclose(f);
+                }
+
+                next += std::chrono::milliseconds(intervalMs);
+                while(active.load() && std::chrono::steady_clock::now() < next) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(std::min(intervalMs, 50LL)));
+                }
+            }
+        }
+
+        void turnOff() {
+            active.store(false);
+            join();
+        }
+
+        void join() {
+            if(this->t.joinable()) {
+                this->t.join();
+            }
+        }
+
+        bool isActive() {
+            return active.load();
+        }
+
+        std::string getPath() {
+            return path;
+        }
+};
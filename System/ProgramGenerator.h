@@ -0,0 +1,222 @@
+/*
+    This file defines the instruction mixes and the generator that writes a random program for a process
+*/
+#pragma once
+#include <memory>
+#include <string>
+#include "../DataTypes/Program.h"
+#include "../DataTypes/ProgramCache.h"
+#include "../DataTypes/Random.h"
+
+enum InstructionMix {
+    MIX_PLAIN,          // No program, every line prints the greeting as before
+    MIX_MIXED,
+    MIX_ARITHMETIC,
+    MIX_PRINT,
+    MIX_LOOPS,
+    MIX_SLEEP,
+    MIX_IO
+};
+
+const char* INSTRUCTION_MIX_NAMES[] = { "plain", "mixed", "arithmetic", "print", "loops", "sleep", "io" };
+
+// Relative weights of each kind of instruction
+struct MixWeights {
+    int print;
+    int declare;
+    int arithmetic;
+    int sleep;
+    int loop;
+    int io;
+};
+
+const MixWeights MIX_WEIGHTS[] = {
+    { 0, 0, 0, 0, 0, 0 },
+    { 2, 2, 4, 1, 1, 1 },
+    { 1, 1, 8, 0, 0, 0 },
+    { 8, 1, 1, 0, 0, 0 },
+    { 1, 1, 3, 0, 5, 0 },
+    { 1, 1, 2, 6, 0, 0 },
+    { 1, 1, 2, 0, 0, 6 }
+};
+
+const long long PROGRAM_STRAIGHT_CYCLES = 64;   // Beyond this a block is mostly loops, so code size stays small
+const long long PROGRAM_MAX_REPEATS = 65535;
+const long long PROGRAM_MAX_SLEEP = 32;  // Ticks
+const long long PROGRAM_MAX_IO_UNITS[PROGRAM_IO_DEVICES] = { 8, 32 }; // Disk sectors, terminal characters
+const long long DEFAULT_PROGRAM_VARIANTS = 16;
+
+class ProgramGenerator {
+    private:
+        Xoshiro256& source;
+        Xoshiro256 variantRandom;
+        Xoshiro256* draw;   // source, or variantRandom while writing a variant
+        InstructionMix mix;
+        MixWeights weights;
+        long long variants;
+        ProgramCache* cache;
+        int capacity;       // Variables the process's memory has room for
+        Program* program;
+
+        void emit(uint8_t byte) {
+            program->code.push_back(byte);
+        }
+
+        void emitValue(uint16_t value) {
+            emit(value & 0xFF);
+            emit(value >> 8);
+        }
+
+        uint8_t variable() {
+            uint8_t slot = (uint8_t) draw->below(capacity);
+            program->variables = slot + 1 > program->variables ? slot + 1 : program->variables;
+            return slot;
+        }
+
+        uint16_t value() {
+            return (uint16_t) draw->below(1000);
+        }
+
+        void emitSimple(int kind) {
+            if(capacity == 0 || kind == 0) {
+                if(capacity > 0 && draw->below(4) == 0) {
+                    emit(OP_PRINT_VAR);
+                    emit(variable());
+                } else {
+                    emit(OP_PRINT);
+                }
+                return;
+            }
+
+            if(kind == 1) {
+                emit(OP_DECLARE);
+                emit(variable());
+                emitValue(value());
+                return;
+            }
+
+            //Both sources are drawn as variables or values independently, matching the opcode order
+            int sources = (int) draw->below(4);
+            bool firstValue = sources & 2;
+            bool secondValue = sources & 1;
+            emit((draw->below(2) == 0 ? OP_ADD_VV : OP_SUBTRACT_VV) + sources);
+            emit(variable());
+            firstValue ? emitValue(value()) : emit(variable());
+            secondValue ? emitValue(value()) : emit(variable());
+        }
+
+        // FOR repeats { body } END costs 1 + repeats * (body + 1) cycles
+        long long emitLoop(long long cycles, int depth) {
+            long long body;
+            long long repeats;
+
+            if(cycles > PROGRAM_STRAIGHT_CYCLES) {
+                body = 1 + (long long) draw->below(16);
+                if(depth + 1 < PROGRAM_MAX_DEPTH && (cycles - 1) / (body + 1) > PROGRAM_MAX_REPEATS) {
+                    body = (cycles - 1) / PROGRAM_MAX_REPEATS - 1;
+                }
+                repeats = (cycles - 1) / (body + 1);
+                repeats = repeats > PROGRAM_MAX_REPEATS ? PROGRAM_MAX_REPEATS : repeats;
+            } else {
+                long long maxBody = (cycles - 1) / 2 - 1;
+                body = 1 + (long long) draw->below(maxBody < 8 ? maxBody : 8);
+                long long maxRepeats = (cycles - 1) / (body + 1);
+                repeats = 2 + (long long) draw->below((maxRepeats < 5 ? maxRepeats : 5) - 1);
+            }
+
+            emit(OP_FOR);
+            emitValue((uint16_t) repeats);
+            block(body, depth + 1);
+            emit(OP_END);
+            return 1 + repeats * (body + 1);
+        }
+
+        // Writes code that takes exactly the given number of cycles
+        void block(long long cycles, int depth) {
+            int total = weights.print + weights.declare + weights.arithmetic + weights.sleep + weights.loop + weights.io;
+
+            while(cycles > 0) {
+                bool loopFits = depth < PROGRAM_MAX_DEPTH && cycles >= 5;
+
+                if(loopFits && cycles > PROGRAM_STRAIGHT_CYCLES) {
+                    cycles -= emitLoop(cycles, depth);
+                    continue;
+                }
+
+                int pick = (int) draw->below(total);
+
+                if(pick < weights.print) {
+                    emitSimple(0);
+                } else if((pick -= weights.print) < weights.declare) {
+                    emitSimple(1);
+                } else if((pick -= weights.declare) < weights.arithmetic) {
+                    emitSimple(2);
+                } else if((pick -= weights.arithmetic) < weights.sleep) {
+                    emit(OP_SLEEP);
+                    emit((uint8_t) (1 + draw->below(PROGRAM_MAX_SLEEP)));
+                } else if((pick -= weights.sleep) < weights.io) {
+                    uint8_t device = (uint8_t) draw->below(PROGRAM_IO_DEVICES);
+                    emit(OP_IO);
+                    emit(device);
+                    emit((uint8_t) (1 + draw->below(PROGRAM_MAX_IO_UNITS[device])));
+                } else if(loopFits) {
+                    cycles -= emitLoop(cycles, depth);
+                    continue;
+                } else {
+                    emitSimple(2);
+                }
+
+                cycles--;
+            }
+        }
+
+    public:
+        // variants > 0 limits the programs of each length and memory size to that many, drawn from source,
+        // so the cache can share them. 0 writes every program from source.
+        ProgramGenerator(Xoshiro256& source, InstructionMix mix, long long variants = 0, ProgramCache* cache = nullptr) : source(source) {
+            this->draw = &source;
+            this->mix = mix;
+            this->weights = MIX_WEIGHTS[mix == MIX_PLAIN ? MIX_MIXED : mix];
+            this->variants = variants;
+            this->cache = cache;
+            this->capacity = 0;
+            this->program = nullptr;
+        }
+
+        // A program that runs for exactly cycles, using no more variables than memoryRequired bytes hold
+        std::shared_ptr<const Program> generate(long long cycles, long long memoryRequired) {
+            std::shared_ptr<Program> generated = std::make_shared<Program>();
+            long long slots = memoryRequired / 2;
+
+            capacity = slots < PROGRAM_MAX_VARIABLES ? (int) slots : PROGRAM_MAX_VARIABLES;
+            program = generated.get();
+            program->cycles = cycles > 0 ? cycles : 0;
+            program->variables = 0;
+
+            //A variant is the same program every time, whatever the source has drawn before
+            if(variants > 0) {
+                uint64_t variant = source.below(variants);
+                variantRandom.seed(((uint64_t) program->cycles * 0x9e3779b97f4a7c15ULL) ^ ((uint64_t) capacity << 48) ^ ((uint64_t) mix << 40) ^ variant);
+                draw = &variantRandom;
+            }
+
+            block(program->cycles, 0);
+            emit(OP_HALT);
+            program->code.shrink_to_fit();
+            program = nullptr;
+            draw = &source;
+
+            return cache != nullptr ? cache->intern(generated) : generated;
+        }
+};
+
+inline bool parseInstructionMix(const std::string& value, InstructionMix& mix) {
+    for(int i = MIX_PLAIN; i <= MIX_IO; i++) {
+        if(value == INSTRUCTION_MIX_NAMES[i]) {
+            mix = (InstructionMix) i;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -1,68 +1,199 @@
 #pragma once
 #include "../DataTypes/TSQueue.h"
+#include "../DataTypes/ProcessTable.h"
 #include "./Core.h"
 #include "MemoryInterface.h"
+#include "Tracer.h"
+#include "Workload.h"
+#include "Affinity.h"
+#include "IoDevice.h"
+#include "../DataTypes/Seqlock.h"
+#include "../DataTypes/TimingWheel.h"
 #include <vector>
 #include <atomic>
 
+struct SchedulerMetrics {
+    long long clock;
+    long long readyQueueLength;
+    unsigned long long dispatches;
+    unsigned long long preemptions;
+    unsigned long long completions;
+    unsigned long long memoryRequeues;  // Dispatches deferred because memory could not be allocated
+    unsigned long long sleeps;          // Times a process left its core to sleep
+    long long sleeping;                 // Processes in the timing wheel
+    unsigned long long ioRequests;      // Times a process left its core to wait for a device
+    unsigned long long interrupts;      // Device completions handled
+    long long overlapTicks;             // Ticks with a core executing while a device was busy
+};
+
 class Scheduler {
     private:
-        long long schedulerClock;
+        std::atomic<long long> schedulerClock; // Ticks handled, the clock spins on it so it is read without a lock
         TSQueue readyQueue;
+        ProcessTable* processes;
         std::vector<Core*>* cores;
         std::thread t;
         std::atomic<bool> active;
         std::atomic<long long>* currentSystemClock;
-        std::mutex mtx;
         AbstractMemoryInterface* memory;
+        IoController* io;
+        Tracer* tracer;
+        WorkloadRecorder* recorder;
         bool isFCFS = false;
+        int hostCpu = -1;   // host CPU the thread is pinned to, -1 for none
+        bool pinned = false;
+        SchedulerMetrics counters = {};
+        Seqlock<SchedulerMetrics> metrics; // Published by the scheduler thread once per tick
+        TimingWheel sleepers;               // Processes that slept off their core, keyed by wakeup tick
+        std::vector<ProcessHandle> woken;
+        std::vector<Process*> wakeBatch;    // Woken sleepers and I/O completions, requeued under one lock
+
+        void accountDispatch(Process* process) {
+            long long tick = currentSystemClock->load();
+            long long blocked = 0;
+
+            if(process->memoryBlockedSinceTick != -1) {
+                blocked = tick - process->memoryBlockedSinceTick;
+                process->memoryBlockedTicks += blocked;
+                process->memoryBlockedSinceTick = -1;
+            }
+
+            if(process->firstDispatchTick == -1) {
+                process->firstDispatchTick = tick;
+            }
+
+            process->waitingTicks += tick - process->readySinceTick - blocked;
+        }
+
+        uint64_t totalSize(const std::vector<AllocatedMemory*>& allocated) {
+            uint64_t size = 0;
+
+            for(const auto& mem: allocated) {
+                size += mem->size;
+            }
+
+            return size;
+        }
 
     public:
         Scheduler(std::vector<Core*>* cores, std::atomic<long long>* currentSystemClock) {
-            this->schedulerClock = 0;
+            this->schedulerClock.store(0);
             this->currentSystemClock = currentSystemClock;
             this->cores = cores;
             this->active.store(false);
+            this->tracer = nullptr;
+            this->processes = nullptr;
+            this->recorder = nullptr;
+            this->io = nullptr;
         }
 
         void setMemoryInterface(AbstractMemoryInterface* memory) {
             this->memory = memory;
         }
+
+        void setIoController(IoController* io) {
+            this->io = io;
+        }
+
+        void setTracer(Tracer* tracer) {
+            this->tracer = tracer;
+        }
+
+        void setProcessTable(ProcessTable* processes) {
+            this->processes = processes;
+        }
+
+        void setWorkloadRecorder(WorkloadRecorder* recorder) {
+            this->recorder = recorder;
+        }
         
         void assignReadyQueueToCores() {
-            for(int i = 0; i < cores->size(); i++) {
-                cores->at(i)->assignReadyQueue(std::addressof(readyQueue));
+            for(Core* core: *cores) {
+                core->assignReadyQueue(std::addressof(readyQueue));
             }
         }
 
+        void setHostCpu(int hostCpu) {
+            this->hostCpu = hostCpu;
+        }
+
+        int getHostCpu() {
+            return this->hostCpu;
+        }
+
+        bool isPinned() {
+            return this->pinned;
+        }
+
         void start() {
             this->active.store(true);
             t = std::thread(run, this);
+            pinned = pinThread(t, hostCpu);
         }
 
         void run() {
             Process* process;
 
             while(active.load()) {
-                while(currentSystemClock->load() == this->schedulerClock && active.load()) {} // Block if not synced
+                while(currentSystemClock->load() == this->schedulerClock.load(std::memory_order_relaxed) && active.load()) {} // Block if not synced
+
+                long long now = currentSystemClock->load();
+                wakeBatch.clear();
+                if(io != nullptr) {
+                    io->advance(now);
+                }
+                memory->compact();
+
+                for(size_t i = 0; i < cores->size(); i++) {
+                    serviceInterrupts(i, now);
 
-                for(int i = 0; i < cores->size(); i++) {
                     if(cores->at(i)->getProcessCompleted()) {
                         Process* p = cores->at(i)->finish();
+                        tracer->record(TRACE_COMPLETE, i, p->id, p->current_instruction);
+                        counters.completions++;
+                        p->completionTick = currentSystemClock->load();
+                        tracer->record(TRACE_FREE, i, p->id, totalSize(p->allocatedMemory));
                         
-                        for(const auto& mem: p->allocatedMemory) {
-                            memory->free(mem);
-                        }
-
+                        memory->release(p->allocatedMemory);
                         p->allocatedMemory = {};
-                        memory->removeFromProcessList(process);
+                        memory->removeFromProcessList(p);
                     } else if(cores->at(i)->getShouldPreempt()) {
                         Process* p = cores->at(i)->preempt();
+                        tracer->record(TRACE_PREEMPT, i, p->id, p->current_instruction);
+                        counters.preemptions++;
+                        p->preemptions++;
+                        p->readySinceTick = currentSystemClock->load(); // Core::preempt put it back in the ready queue
                         memory->addToProcessList(p); // Add back as it is freeable now
+                    } else if(cores->at(i)->getShouldBlock()) {
+                        Process* p = cores->at(i)->block();
+
+                        //Without a controller a device request ends like a sleep of 0 ticks
+                        if(p->ioDevice != -1 && io != nullptr) {
+                            tracer->record(TRACE_IO_SUBMIT, i, p->id, ((uint64_t) p->ioDevice << 32) | (uint64_t) p->ioUnits);
+                            counters.ioRequests++;
+                            p->ioSinceTick = now;
+                            io->submit(p, p->ioDevice, i, p->ioUnits, now);
+                            p->ioDevice = -1;
+                            p->ioUnits = 0;
+                        } else {
+                            tracer->record(TRACE_SLEEP, i, p->id, p->sleepRequest);
+                            counters.sleeps++;
+                            sleepers.schedule(p->handle, now + p->sleepRequest);
+                            p->sleepRequest = 0;
+                            p->ioDevice = -1;
+                            p->ioUnits = 0;
+                        }
+
+                        memory->addToProcessList(p); // While it waits it can be swapped out like a ready process
                     }
                 }
 
-                for(int i = 0; i < cores->size(); i++) {
+                wake(now);
+                if(!wakeBatch.empty()) {
+                    readyQueue.push(wakeBatch);
+                }
+
+                for(size_t i = 0; i < cores->size(); i++) {
                     if(readyQueue.isEmpty()) {
                         break; 
                         //Ready queue for this time step has all been dispatch already, 
@@ -70,40 +201,171 @@ class Scheduler {
                     } 
 
                     if(!((*cores->at(i)).isActive())) { //Check if the core is free
-                        process = readyQueue.peek();
+                        process = processes->get(readyQueue.peek());
+
+                        if(process == nullptr) {
+                            readyQueue.pop(); // Released while it waited, the core stays free until the next tick
+                            continue;
+                        }
 
                         if(process->allocatedMemory.size() == 0) {
-                            uint64_t memoryRequirement = memory->fetchFromBackingStore(process->name);
+                            uint64_t memoryRequirement = memory->fetchFromBackingStore(process->handle.pid);
 
                             if(memoryRequirement == 0) {
                                 memoryRequirement = process->memoryRequired;
+                            } else {
+                                tracer->record(TRACE_SWAP_IN, i, process->id, memoryRequirement);
                             }
 
-                            memory->reserve(memoryRequirement, process->name);
-                            process->allocatedMemory = memory->allocate(memoryRequirement, process->name);
+                            memory->reserve(memoryRequirement, process->handle.pid);
+                            process->allocatedMemory = memory->allocate(memoryRequirement, process->handle.pid);
+
+                            if(process->allocatedMemory.size() != 0) {
+                                tracer->record(TRACE_ALLOCATE, i, process->id, totalSize(process->allocatedMemory));
+                            }
                         }
 
                         if(process->allocatedMemory.size() == 0) {
-                            if(!isFCFS) {
-                                readyQueue.pop();
-                                enqueue(process);
+                            counters.memoryRequeues++;
+
+                            if(process->memoryBlockedSinceTick == -1) {
+                                process->memoryBlockedSinceTick = currentSystemClock->load();
                             }
+
+                            //FCFS keeps the head in place, nothing behind it may go first, so this tick is done
+                            if(isFCFS) {
+                                break;
+                            }
+
+                            readyQueue.pop();
+                            enqueue(process);
                         } else {
                             (*cores->at(i)).assignProcess(process);
+                            tracer->record(TRACE_DISPATCH, i, process->id, process->current_instruction);
+                            counters.dispatches++;
+                            accountDispatch(process);
                             memory->removeFromProcessList(process);
                             readyQueue.pop();
                         }
                     }     
                 }
 
-                std::unique_lock<std::mutex> lock(mtx);
-                this->schedulerClock++;
-                lock.unlock();
+                if(io != nullptr && io->isBusy()) {
+                    for(Core* core: *cores) {
+                        if(core->isActive()) {
+                            counters.overlapTicks++;
+                            break;
+                        }
+                    }
+                }
+
+                counters.clock = this->schedulerClock.load(std::memory_order_relaxed) + 1;
+                counters.readyQueueLength = readyQueue.size();
+                counters.sleeping = sleepers.size();
+                metrics.write(counters);
+
+                //Publishes the whole tick to the clock, which reads it with acquire
+                this->schedulerClock.store(counters.clock, std::memory_order_release);
+            }
+        }
+
+        // Adds every sleeper due by tick to the batch requeued at the end of the tick. A process released
+        // while it slept is dropped.
+        void wake(long long tick) {
+            woken.clear();
+            sleepers.advance(tick, woken);
+
+            for(const ProcessHandle& handle: woken) {
+                Process* p = processes->get(handle);
+
+                if(p != nullptr) {
+                    p->readySinceTick = tick;
+                    tracer->record(TRACE_WAKE, -1, p->id, p->current_instruction);
+                    wakeBatch.push_back(p);
+                }
             }
         }
 
+        // Handles the device completions raised on the core's interrupt line, their processes join the
+        // same batch as the sleepers
+        void serviceInterrupts(int core, long long tick) {
+            if(io == nullptr) {
+                return;
+            }
+
+            std::vector<IoRequest>& line = io->getInterrupts(core);
+
+            for(const IoRequest& request: line) {
+                Process* p = processes->get(request.handle);
+                counters.interrupts++;
+
+                if(p != nullptr) {
+                    p->ioBlockedTicks += tick - p->ioSinceTick;
+                    p->ioSinceTick = -1;
+                    p->readySinceTick = tick;
+                    tracer->record(TRACE_IO_DONE, core, p->id, request.device);
+                    wakeBatch.push_back(p);
+                }
+            }
+
+            line.clear();
+        }
+
         void enqueue(Process* process) {
-            readyQueue.push(process);
+            readyQueue.push(process->handle);
+        }
+
+        // Entry point for newly created processes, enqueue() is also used for requeues
+        void admit(Process* process) {
+            process->arrivalTick = currentSystemClock->load();
+            process->readySinceTick = process->arrivalTick;
+            tracer->record(TRACE_ARRIVE, -1, process->id, process->total_instructions);
+            if(recorder != nullptr) {
+                recorder->record(*process, process->arrivalTick);
+            }
+            enqueue(process);
+        }
+
+        // admit() for many processes arriving on the same tick, enqueued under one lock
+        void admit(const std::vector<Process*>& batch) {
+            long long tick = currentSystemClock->load();
+
+            for(Process* process : batch) {
+                process->arrivalTick = tick;
+                process->readySinceTick = tick;
+                tracer->record(TRACE_ARRIVE, -1, process->id, process->total_instructions);
+                if(recorder != nullptr) {
+                    recorder->record(*process, tick);
+                }
+            }
+            readyQueue.push(batch);
+        }
+
+        // Ready queue front first, at a tick boundary
+        std::vector<ProcessHandle> getReadyQueue() {
+            return readyQueue.snapshot();
+        }
+
+        // Sleepers and their wakeup ticks, at a tick boundary
+        std::vector<std::pair<ProcessHandle, long long>> getSleepers() {
+            return sleepers.entries();
+        }
+
+        // Replaces the ready queue, sleepers and counters, only at a tick boundary. The clock carries on.
+        void restore(const std::vector<ProcessHandle>& ready, const std::vector<std::pair<ProcessHandle, long long>>& asleep, const SchedulerMetrics& restored) {
+            long long clock = counters.clock;
+
+            readyQueue.replace(ready);
+            sleepers.reset(currentSystemClock->load());
+            for(const auto& entry: asleep) {
+                sleepers.schedule(entry.first, entry.second);
+            }
+
+            counters = restored;
+            counters.clock = clock;
+            counters.readyQueueLength = ready.size();
+            counters.sleeping = sleepers.size();
+            metrics.write(counters);
         }
 
         void turnOff() {
@@ -122,8 +384,11 @@ class Scheduler {
         }
 
         long long getTime() {
-            std::lock_guard<std::mutex> lock(mtx);
-            return this->schedulerClock;
+            return this->schedulerClock.load(std::memory_order_acquire);
+        }
+
+        SchedulerMetrics getMetrics() {
+            return metrics.read();
         }
 
         void setIsFCFS(bool isFCFS) {
@@ -4,28 +4,59 @@
 #include "../System/Scheduler.h"
 #include "../System/Tester.h"
 #include "MemoryInterface.h"
+#include "../DataTypes/LatencyHistogram.h"
+#include "../DataTypes/Mailbox.h"
+#include "Affinity.h"
 #include <atomic>
 #include <thread>
 #include <vector>
-#include <mutex>
-#include <condition_variable>
+#include <chrono>
+#include <functional>
+
+enum TickPhase {
+    PHASE_DISPATCH,     // Waiting for the scheduler to dispatch
+    PHASE_EXECUTE,      // Waiting for every core to execute
+    PHASE_TESTER,       // Waiting for the tester to generate processes
+    PHASE_CONTROL,      // Draining control commands
+    PHASE_TICK,         // The whole tick, excluding pacing
+    PHASE_PACING,       // Sleeping to hold the target tick rate
+    PHASE_COUNT
+};
+
+const char* TICK_PHASE_NAMES[PHASE_COUNT] = { "dispatch", "execute", "tester", "control", "tick", "pacing" };
+
+enum ClockCommandType {
+    START_TESTER,
+    STOP_TESTER,
+    SET_TICK_RATE,  // value = ticks per second, 0 for unbounded
+    RUN_BETWEEN_TICKS
+};
+
+struct ClockCommand {
+    ClockCommandType type;
+    long long value;
+    std::function<void()> action; // RUN_BETWEEN_TICKS only
+};
 
 class SynchronizedClock {
     private:
         std::atomic<long long> currentSystemClock;
         std::atomic<bool> active;
-        std::atomic<bool> testerShouldStart;
         std::thread t;
         std::vector<Core*>* cores;
         Tester* tester;
         Scheduler* scheduler;
         AbstractMemoryInterface* memory;
-        std::mutex mtx;
-        std::condition_variable cv;
+        Mailbox<ClockCommand> commands;             // Control plane requests, drained between ticks
+        LatencyHistogram phaseTimes[PHASE_COUNT];   // Written by the clock thread only
+        std::atomic<long long> tickRate;            // Target ticks per second, 0 runs unbounded
+        std::chrono::steady_clock::time_point nextTick;
+        int hostCpu;                                // Host CPU the thread is pinned to, -1 for none
+        bool pinned;
 
         bool coresSynced() {
-            for(int i = 0; i < cores->size(); i++) {
-                if(cores->at(i)->getTime() != currentSystemClock && cores->at(i)->isOn()) {
+            for(Core* core: *cores) {
+                if(core->getTime() != currentSystemClock && core->isOn()) {
                     return false;
                 }
             }
@@ -41,6 +72,54 @@ class SynchronizedClock {
             return true;
         }
 
+        void processCommands() {
+            for(const auto& command: commands.drain()) {
+                switch(command.type) {
+                    case START_TESTER:
+                        if(!tester->isActive() && active.load()) {
+                            tester->start();
+                        }
+                        break;
+                    case STOP_TESTER:
+                        if(tester->isActive()) {
+                            tester->turnOff();
+                        }
+                        break;
+                    case SET_TICK_RATE:
+                        tickRate.store(command.value);
+                        nextTick = std::chrono::steady_clock::now();
+                        break;
+                    case RUN_BETWEEN_TICKS:
+                        command.action();
+                        break;
+                }
+            }
+        }
+
+        //Sleeps for most of the remaining tick period, then spins for the last stretch for precision
+        void pace() {
+            long long rate = tickRate.load(std::memory_order_relaxed);
+
+            if(rate <= 0) {
+                return;
+            }
+
+            const auto spinMargin = std::chrono::microseconds(200);
+            auto now = std::chrono::steady_clock::now();
+            nextTick += std::chrono::nanoseconds(1000000000LL / rate);
+
+            if(nextTick < now) {
+                nextTick = now; // Fell behind, do not burst to catch up
+                return;
+            }
+
+            if(nextTick - now > spinMargin) {
+                std::this_thread::sleep_for(nextTick - now - spinMargin);
+            }
+
+            while(std::chrono::steady_clock::now() < nextTick && active.load()) {}
+        }
+
         bool schedulerSynced() {
             if (scheduler->getTime() != currentSystemClock && scheduler->isActive()) {
                 return false;
@@ -52,8 +131,10 @@ class SynchronizedClock {
     public:
         SynchronizedClock(std::vector<Core*>* cores, Tester* tester, Scheduler* scheduler) {
             active.store(false);
-            testerShouldStart.store(false);
+            tickRate.store(0);
             currentSystemClock.store(0);
+            hostCpu = -1;
+            pinned = false;
             this->cores = cores;
             this->tester = tester;
             this->scheduler = scheduler;
@@ -63,53 +144,89 @@ class SynchronizedClock {
             this->memory = memory;
         }
 
+        void setHostCpu(int hostCpu) {
+            this->hostCpu = hostCpu;
+        }
+
+        int getHostCpu() {
+            return this->hostCpu;
+        }
+
+        bool isPinned() {
+            return this->pinned;
+        }
+
+        // The cores and scheduler must be on first, a core that starts after the clock advanced never
+        // catches up with it
         void start() {
             active.store(true);
             t = std::thread(run, this);
+            pinned = pinThread(t, hostCpu);
         }
 
         void run(){
+            nextTick = std::chrono::steady_clock::now();
+
             while(active.load()) {
+                uint64_t tickStart = nowNanoseconds();
+                uint64_t phaseStart = tickStart;
+                uint64_t phaseEnd;
+
                 while(!schedulerSynced() && active.load()) {} //Halt to wait for scheduler to dispatch
 
+                phaseEnd = nowNanoseconds();
+                phaseTimes[PHASE_DISPATCH].record(phaseEnd - phaseStart);
+                phaseStart = phaseEnd;
+
                 if(!active.load() || schedulerSynced()) { //Unlock all cores after scheduler completes or system is being shutoff
-                    for(int i = 0; i < cores->size(); i++) {
-                        cores->at(i)->unlock();
+                    for(Core* core: *cores) {
+                        core->unlock();
                     }
                 }
 
                 while(!coresSynced() && active.load()) {} //Halt to wait for core execution
+
+                phaseEnd = nowNanoseconds();
+                phaseTimes[PHASE_EXECUTE].record(phaseEnd - phaseStart);
+                phaseStart = phaseEnd;
                 
                 if((!active.load() || schedulerSynced()) && tester->isActive()) { //Unlock tester after cores execute or system is being shutoff and the tester is active
                     tester->setCanProceed(); //Allow tester to proceed
                 }
 
                 while((!testerSynced() && tester->isActive()) && active.load()) {} //Halt to wait for tester execution if it is active
-                
-                std::unique_lock<std::mutex> input_lock(this->mtx);
-                this->cv.wait_for(input_lock, std::chrono::microseconds(30), [this] { return testerShouldStart.load(); });
 
-                if(testerShouldStart.load() && active.load()) {
-                    tester->start();
+                phaseEnd = nowNanoseconds();
+                phaseTimes[PHASE_TESTER].record(phaseEnd - phaseStart);
+                phaseStart = phaseEnd;
+                
+                if(!commands.isEmpty()) {
+                    processCommands();
+                }
 
-                    while(!tester->isActive() && testerShouldStart.load() && active.load()) {} //Halt for tester thread to turn on
+                phaseEnd = nowNanoseconds();
+                phaseTimes[PHASE_CONTROL].record(phaseEnd - phaseStart);
+                phaseTimes[PHASE_TICK].record(phaseEnd - tickStart);
+                phaseStart = phaseEnd;
 
-                    testerShouldStart.store(false); //Reset to false as tester has already started  
-                } 
+                pace();
 
-                input_lock.unlock();
+                phaseTimes[PHASE_PACING].record(nowNanoseconds() - phaseStart);
 
                 incrementClock();
             }
         }
 
+        LatencyHistogram* getPhaseTime(TickPhase phase) {
+            return std::addressof(phaseTimes[phase]);
+        }
+
         std::atomic<long long>* getSyncClock() {
             return std::addressof(currentSystemClock);
         }
 
         void incrementClock() {
             currentSystemClock.store((currentSystemClock.load() + 1) % LLONG_MAX);
-            // std::this_thread::sleep_for(std::chrono::milliseconds(1000));
         }
 
         void turnOff() {
@@ -124,7 +241,27 @@ class SynchronizedClock {
         }
         
         void startTester() {
-            std::unique_lock<std::mutex> input_lock(this->mtx);
-            testerShouldStart.store(true);
+            commands.post({ START_TESTER, 0, nullptr });
+        }
+
+        void stopTester() {
+            commands.post({ STOP_TESTER, 0, nullptr });
+        }
+
+        // Runs action on the clock thread between two ticks, while the scheduler, cores and tester all wait
+        // for the next one, and returns once it ran. The clock must be running.
+        void runBetweenTicks(const std::function<void()>& action) {
+            std::atomic<bool> done(false);
+
+            commands.post({ RUN_BETWEEN_TICKS, 0, [&]() { action(); done.store(true); } });
+            while(!done.load() && active.load()) {}
+        }
+
+        void setTickRate(long long ticksPerSecond) {
+            commands.post({ SET_TICK_RATE, ticksPerSecond, nullptr });
+        }
+
+        long long getTickRate() {
+            return tickRate.load();
         }
 };
\ No newline at end of file
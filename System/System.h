@@ -3,11 +3,23 @@
 */
 #include "../DataTypes/TSQueue.h"
 #include "../DataTypes/SchedAlgo.h"
+#include "../DataTypes/ProcessTable.h"
 #include "../System/Scheduler.h"
 #include "../System/Tester.h"
 #include "../System/Core.h"
 #include "../System/SynchronizedClock.h"
+#include "../System/LogWriter.h"
+#include "../System/Tracer.h"
+#include "../System/Workload.h"
+#include "../System/Arrivals.h"
+#include "../System/ProgramGenerator.h"
+#include "../System/IoDevice.h"
+#include "../System/Checkpoint.h"
+#include "../System/MetricsDumper.h"
+#include "../System/Affinity.h"
+#include "../System/CoreWorkerPool.h"
 #include "../UI/Display.h"
+#include "../UI/ScreenHistory.h"
 #include <vector>
 #include <sstream>
 #include <ctime>
@@ -16,13 +28,33 @@
 #include <cmath>
 #include "MemoryInterface.h"
 
+// One system's results, as the sweep runner tabulates them
+struct RunMetrics {
+    long long ticks;
+    long long processes;
+    long long finished;
+    double cpuUtilization;      // Percent of core ticks spent executing
+    double meanResponse;        // Ticks from arrival to first dispatch, over dispatched processes
+    double meanTurnaround;      // Ticks from arrival to completion, over finished processes
+    unsigned long long dispatches;
+    unsigned long long preemptions;
+    unsigned long long memoryRequeues;
+    uint64_t usedMemory;
+    uint64_t pagedIn;
+    uint64_t pagedOut;
+};
+
 class System
 {
     private:
-        std::map<std::string, std::shared_ptr<Process>> processes;
+        ProcessTable processes;
+        std::string directory; // Root of config.txt, Logs and BackingStore
+        std::ostream* console; // Where command output goes, history keeps it either way
         bool isInMainConsole = true; // Flag to track if commands are valid
         bool isInitialized = false;
         std::vector<Core*> cores;
+        CoreControlTable coreControl;
+        CoreStateTable coreState;
         int totalCores = 0;
         long long processMinIns = 100;
         long long processMaxIns = 100;
@@ -30,16 +62,47 @@ class System
         long long processMinMem = 128;
         long long processMaxMem = 128;
         int memAdd = 0;
+        long long memPerFrame = 0;
+        long long quantumCycles = 0;
+        long long delayPerExec = 0;
+        SchedAlgo schedulerAlgorithm = FCFS;
+        long long tickRate = 0; // Target ticks per second, 0 runs unbounded
+        AffinityMode affinityMode = AFFINITY_NONE;
+        int affinityClock = -1;
+        int affinityScheduler = -1;
+        std::vector<int> affinityCores;
+        AffinityPlan affinity;
+        ExecutionMode executionMode = EXECUTION_THREADS;
+        int workerCount = 0; // Pooled execution workers, 0 sizes the pool to the host
+        CoreWorkerPool corePool;
+        CoreStepMode coreStepMode = CORE_STEP_OBJECT;
         MemoryStats computeMemoryStats();
 
 
         std::string current_process; // Global variable to store the current process
-        std::map<std::string, std::vector<std::pair<std::string, std::string>>> processHistory;
+        std::map<std::string, ScreenHistory> processHistory;
+        size_t historyCap = DEFAULT_HISTORY_CAP; // Bytes kept per screen
+        uint64_t compactionBudget = DEFAULT_COMPACTION_BUDGET;
+        uint64_t hugeFrameSize = 0; // 0 pages with frames only
 
         Scheduler scheduler;
         Tester tester;
         SynchronizedClock synchronizer;
-        AbstractMemoryInterface* memory;
+        AbstractMemoryInterface* memory = nullptr;
+        LogWriter logWriter;
+        Tracer tracer;
+        MetricsDumper metricsDumper;
+        WorkloadReader workload;
+        std::string workloadPath; // Empty for random generation
+        WorkloadRecorder workloadRecorder;
+        ArrivalSettings arrivalSettings;
+        uint64_t seed = 1; // Seeds every random draw, so a run can be repeated
+        InstructionMix instructionMix = MIX_MIXED; // What the programs of new processes are made of
+        long long programVariants = DEFAULT_PROGRAM_VARIANTS;
+        ProgramCache programCache; // Shares identical programs between processes
+        Xoshiro256 shellRandom; // Draws for screen -s, the tester has its own generator
+        IoController io;
+        IoServiceModel ioService[IO_DEVICE_COUNT] = { DEFAULT_IO_SERVICE[IO_DISK], DEFAULT_IO_SERVICE[IO_TERMINAL] };
 
     public:    
         //Constructor
@@ -51,47 +114,117 @@ class System
             delete memory;
         }
 
-        System(): synchronizer(std::addressof(cores), std::addressof(tester), std::addressof(scheduler)),
+        System(const std::string& directory = ".", std::ostream* console = std::addressof(std::cout)): synchronizer(std::addressof(cores), std::addressof(tester), std::addressof(scheduler)),
         scheduler(std::addressof(cores), synchronizer.getSyncClock()), 
         tester(synchronizer.getSyncClock(), &processFreq, &processes, &processMinIns, &processMaxIns, getCurrentTimestamp, std::addressof(scheduler), &processMinMem, &processMaxMem)
-        {}
+        {
+            this->directory = directory;
+            this->console = console;
+            processes.setLogDirectory(directory + "/Logs/");
+            tracer.setSyncClock(synchronizer.getSyncClock());
+            scheduler.setTracer(std::addressof(tracer));
+            scheduler.setProcessTable(std::addressof(processes));
+            scheduler.setWorkloadRecorder(std::addressof(workloadRecorder));
+            scheduler.setIoController(std::addressof(io));
+        }
 
         //Methods
         void boot() {
-            synchronizer.start();
+            logWriter.start();
             scheduler.start();
-            for(int i = 0; i < cores.size(); i++) {
-                (*(cores.at(i))).start();
+            if (executionMode == EXECUTION_POOLED) {
+                corePool.start();
+            } else {
+                for(Core* core: cores) {
+                    core->start();
+                }
             }
-            std::cout << "System booted successfully.\n";
+            synchronizer.start(); // Last, so every core is on before the first tick
+            *console << "System booted successfully.\n";
         }
 
         void terminate() {
             synchronizer.turnOff();
             scheduler.turnOff();
-            for(int i = 0; i < 4; i++) {
-                (*cores[i]).turnOff();
+            for(Core* core: cores) {
+                core->turnOff();
+            }
+            corePool.turnOff(); // After the cores, so no worker is left waiting on a core
+            metricsDumper.turnOff();
+            logWriter.turnOff();
+            tracer.stop();
+            workloadRecorder.stop();
+        }
+
+        bool isReady() {
+            return isInitialized;
+        }
+
+        long long getTick() {
+            return synchronizer.getSyncClock()->load();
+        }
+
+        RunMetrics collectRunMetrics() {
+            RunMetrics metrics = {};
+            SchedulerMetrics schedulerMetrics = scheduler.getMetrics();
+            MemoryStats memoryStats = memory->getMemoryStats();
+            long long totalTicks = 0;
+            long long activeTicks = 0;
+            long long dispatched = 0;
+            double responseSum = 0;
+            double turnaroundSum = 0;
+
+            for (Core* core : cores) {
+                TickData tickData = core->getTickData();
+                totalTicks += tickData.total;
+                activeTicks += tickData.active;
             }
+
+            processes.forEach([&](const Process& p) {
+                metrics.processes++;
+
+                if (p.getResponseTicks() >= 0) {
+                    dispatched++;
+                    responseSum += p.getResponseTicks();
+                }
+
+                if (p.getTurnaroundTicks() >= 0) {
+                    metrics.finished++;
+                    turnaroundSum += p.getTurnaroundTicks();
+                }
+            });
+
+            metrics.ticks = getTick();
+            metrics.cpuUtilization = totalTicks > 0 ? 100.0 * activeTicks / totalTicks : 0;
+            metrics.meanResponse = dispatched > 0 ? responseSum / dispatched : 0;
+            metrics.meanTurnaround = metrics.finished > 0 ? turnaroundSum / metrics.finished : 0;
+            metrics.dispatches = schedulerMetrics.dispatches;
+            metrics.preemptions = schedulerMetrics.preemptions;
+            metrics.memoryRequeues = schedulerMetrics.memoryRequeues;
+            metrics.usedMemory = memoryStats.usedMemory;
+            metrics.pagedIn = memoryStats.pagedInCount;
+            metrics.pagedOut = memoryStats.pagedOutCount;
+            return metrics;
         }
 
         void cmd_initialize() {
             if (isInitialized) {
-                std::cout << "Error! System already initialized.\n";
-                processHistory["Main"].emplace_back("Error! System already initialized.\n", "RESET");
+                *console << "Error! System already initialized.\n";
+                history("Main").add("Error! System already initialized.\n", RESET);
                 return;
             }
 
-            FILE* f = fopen("config.txt", "r");
-            int num_cpu;
-            SchedAlgo algorithm;
-            long long quantum_cycles;
-            long long process_freq;
-            long long min_ins;
-            long long max_ins;
-            long long delay_per_exec;
-            long long max_overall_mem;
-            long long mem_per_frame;
-            long long min_mem_per_proc, max_mem_per_proc;
+            FILE* f = fopen((directory + "/config.txt").c_str(), "r");
+            int num_cpu = 0;
+            SchedAlgo algorithm = FCFS;
+            long long quantum_cycles = 0;
+            long long process_freq = 0;
+            long long min_ins = 0;
+            long long max_ins = 0;
+            long long delay_per_exec = 0;
+            long long max_overall_mem = 0;
+            long long mem_per_frame = 0;
+            long long min_mem_per_proc = 0, max_mem_per_proc = 0;
             long long limit = (long long)1 << 32;
             bool isFlatAllocator = false; //CHANGE BASED ON CONFIG
 
@@ -101,8 +234,8 @@ class System
                 std::vector<std::string> tokens = tokenizeInput(buffer);
 
                 if (tokens.size() != 2) {
-                    std::cout << "Error! Invalid config file. Line " << i << "\n";
-                    processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                    *console << "Error! Invalid config file. Line " << i << "\n";
+                    history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                     return;
                 }
 
@@ -110,241 +243,1002 @@ class System
                 {
                     case 1:
                         if (tokens[0] != "num-cpu") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
                         
                         num_cpu = std::stoi(tokens[1]);
-                        if (num_cpu < 1 || num_cpu > 128) {
-                            std::cout << "Error! Invalid number of CPUs.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid number of CPUs.\n", "RESET");
+                        if (num_cpu < 1 || num_cpu > 1024) {
+                            *console << "Error! Invalid number of CPUs.\n";
+                            history("Main").add("Error! Invalid number of CPUs.\n", RESET);
                             return;
                         }
                         break;
                     case 2:
                         if (tokens[0] != "scheduler") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
 
                         algorithm = (SchedAlgo) parseSchedAlgo(tokens[1]);
                         if (algorithm == -1) {
-                            std::cout << "Error! Invalid scheduling algorithm.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid scheduling algorithm.\n", "RESET");
+                            *console << "Error! Invalid scheduling algorithm.\n";
+                            history("Main").add("Error! Invalid scheduling algorithm.\n", RESET);
                             return;
                         }
                         break;
                     case 3:
                         if (tokens[0] != "quantum-cycles") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
                         quantum_cycles = std::stoll(tokens[1]);
                         if (quantum_cycles < 1 || quantum_cycles > limit) {
-                            std::cout << "Error! Invalid quantum cycles.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid quantum cycles.\n", "RESET");
+                            *console << "Error! Invalid quantum cycles.\n";
+                            history("Main").add("Error! Invalid quantum cycles.\n", RESET);
                             return;
                         }
                         break;
                     case 4:
                         if (tokens[0] != "batch-process-freq") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
                         process_freq = std::stoll(tokens[1]);
                         if (process_freq < 1 || process_freq > limit) {
-                            std::cout << "Error! Invalid batch process frequency.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid batch process frequency.\n", "RESET");
+                            *console << "Error! Invalid batch process frequency.\n";
+                            history("Main").add("Error! Invalid batch process frequency.\n", RESET);
                             return;
                         }
                         break;
                     case 5:
                         if (tokens[0] != "min-ins") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
                         min_ins = std::stoll(tokens[1]);
                         if (min_ins < 1 || min_ins > limit) {
-                            std::cout << "Error! Invalid minimum instructions.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid minimum instructions.\n", "RESET");
+                            *console << "Error! Invalid minimum instructions.\n";
+                            history("Main").add("Error! Invalid minimum instructions.\n", RESET);
                             return;
                         }
                         break;
                     case 6:
                         if (tokens[0] != "max-ins") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
                         max_ins = std::stoll(tokens[1]);
                         if (max_ins < 1 || max_ins > limit) {
-                            std::cout << "Error! Invalid maximum instructions.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid maximum instructions.\n", "RESET");
+                            *console << "Error! Invalid maximum instructions.\n";
+                            history("Main").add("Error! Invalid maximum instructions.\n", RESET);
                             return;
                         }
                         break;
                     case 7:
                         if (tokens[0] != "delays-per-exec") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
                         delay_per_exec = std::stoll(tokens[1]);
                         if (delay_per_exec < 0 || delay_per_exec > limit) {
-                            std::cout << "Error! Invalid delay per execution.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid delay per execution.\n", "RESET");
+                            *console << "Error! Invalid delay per execution.\n";
+                            history("Main").add("Error! Invalid delay per execution.\n", RESET);
                             return;
                         }
                         break;
                     case 8: 
                         if (tokens[0] != "max-overall-mem") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
                         max_overall_mem = std::stoll(tokens[1]);
                         if (max_overall_mem < 2 || max_overall_mem > limit) {
-                            std::cout << "Error! Invalid maximum overall memory.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid maximum overall memory.\n", "RESET");
+                            *console << "Error! Invalid maximum overall memory.\n";
+                            history("Main").add("Error! Invalid maximum overall memory.\n", RESET);
                             return;
                         }
                         break;
                     case 9:
                         if (tokens[0] != "mem-per-frame") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
                         mem_per_frame = std::stoll(tokens[1]);
                         if (mem_per_frame < 2 || mem_per_frame > limit) {
-                            std::cout << "Error! Invalid memory per frame.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid memory per frame.\n", "RESET");
+                            *console << "Error! Invalid memory per frame.\n";
+                            history("Main").add("Error! Invalid memory per frame.\n", RESET);
                             return;
                         }
                         break;
                     case 10:
                         if (tokens[0] != "min-mem-per-proc") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
                         min_mem_per_proc = std::stoll(tokens[1]);
                         if (min_mem_per_proc < 2 || min_mem_per_proc > limit) {
-                            std::cout << "Error! Invalid memory per process.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid memory per process.\n", "RESET");
+                            *console << "Error! Invalid memory per process.\n";
+                            history("Main").add("Error! Invalid memory per process.\n", RESET);
                             return;
                         }
                         break;
                     case 11:
                         if (tokens[0] != "max-mem-per-proc") {
-                            std::cout << "Error! Invalid config file. Line " << i << "\n";
-                            processHistory["Main"].emplace_back("Error! Invalid config file. Line " + std::to_string(i) + "\n", "RESET");
+                            *console << "Error! Invalid config file. Line " << i << "\n";
+                            history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
                             return;
                         }
                         max_mem_per_proc = std::stoll(tokens[1]);
                         if (max_mem_per_proc < 2 || max_mem_per_proc > limit) {
-                            std::cout << "Error! Invalid memory per process.\n";
-                            processHistory["Main"].emplace_back("Error! Invalid memory per process.\n", "RESET");
+                            *console << "Error! Invalid memory per process.\n";
+                            history("Main").add("Error! Invalid memory per process.\n", RESET);
                             return;
                         }
                         break;
                 }
             }
+
+            //Optional settings may follow the required lines in any order
+            char buffer[256];
+            for (int i = 12; fgets(buffer, 256, f) != nullptr; i++) {
+                std::vector<std::string> tokens = tokenizeInput(buffer);
+
+                if (tokens.empty()) {
+                    continue;
+                }
+
+                if (tokens.size() != 2 || !parseOptionalConfig(tokens[0], tokens[1])) {
+                    *console << "Error! Invalid config file. Line " << i << "\n";
+                    history("Main").add("Error! Invalid config file. Line " + std::to_string(i) + "\n", RESET);
+                    fclose(f);
+                    return;
+                }
+            }
+            fclose(f);
+
+            //A host thread per core stops scaling long before this, more cores need pooled execution
+            if (num_cpu > 128 && executionMode == EXECUTION_THREADS) {
+                *console << "Error! More than 128 CPUs requires execution pooled.\n";
+                history("Main").add("Error! More than 128 CPUs requires execution pooled.\n", RESET);
+                return;
+            }
+
+            if (hugeFrameSize != 0 && (max_overall_mem == mem_per_frame || hugeFrameSize % mem_per_frame != 0 ||
+                                       hugeFrameSize < 2 * (uint64_t) mem_per_frame || hugeFrameSize > (uint64_t) max_overall_mem)) {
+                *console << "Error! huge-frame-size must be a multiple of at least two frames that fits in memory.\n";
+                history("Main").add("Error! Invalid huge frame size.\n", RESET);
+                return;
+            }
+
+            if (coreStepMode != CORE_STEP_OBJECT && executionMode != EXECUTION_POOLED) {
+                *console << "Error! core-step " << CORE_STEP_MODE_NAMES[coreStepMode] << " requires execution pooled.\n";
+                history("Main").add("Error! core-step requires execution pooled.\n", RESET);
+                return;
+            }
+
+            if (coreStepMode == CORE_STEP_AVX2 && !cpuSupportsAvx2()) {
+                *console << "Error! This host does not support AVX2.\n";
+                history("Main").add("Error! This host does not support AVX2.\n", RESET);
+                return;
+            }
+
+            if (!workloadPath.empty() && !workload.open(workloadPath)) {
+                *console << "Error! Invalid workload: " << workload.getError() << ".\n";
+                history("Main").add("Error! Invalid workload: " + workload.getError() + ".\n", RESET);
+                return;
+            }
+            tester.setReplay(workloadPath.empty() ? nullptr : std::addressof(workload));
             
             if(max_overall_mem == mem_per_frame) {
                 memAdd = max_overall_mem;
                 memory = new FlatMemoryInterface(max_overall_mem, getCurrentTimestamp, std::addressof(cores));
             } else {
                 memAdd = max_overall_mem;
-                memory = new PagingMemoryInterface(max_overall_mem, mem_per_frame, getCurrentTimestamp, std::addressof(cores));
+                memory = new PagingMemoryInterface(max_overall_mem, mem_per_frame, getCurrentTimestamp, std::addressof(cores), hugeFrameSize);
+            }
+
+            memPerFrame = mem_per_frame;
+            quantumCycles = quantum_cycles;
+            delayPerExec = delay_per_exec;
+            schedulerAlgorithm = algorithm;
+            for (auto& screen : processHistory) {
+                screen.second.setCapacity(historyCap);
             }
 
+            memory->setOutputDirectory(directory);
+            memory->setTracer(std::addressof(tracer));
+            memory->setCompactionBudget(compactionBudget);
+            memory->setProcessTable(std::addressof(processes));
             scheduler.setMemoryInterface(memory);
             synchronizer.setMemoryInterface(memory);
             tester.setMemoryInterface(memory);
 
             totalCores = num_cpu;
+            int producers = executionMode == EXECUTION_POOLED ? CoreWorkerPool::resolveWorkerCount(workerCount, num_cpu) : num_cpu;
+            logWriter.init(producers);
+            coreControl.init(num_cpu);
+            coreState.init(num_cpu);
             for(int i = 0; i < num_cpu; i++) {
-                cores.push_back(new Core(i, quantum_cycles, synchronizer.getSyncClock(), this->getCurrentTimestamp, algorithm, delay_per_exec));
+                cores.push_back(new Core(i, quantum_cycles, synchronizer.getSyncClock(), this->getCurrentTimestamp, algorithm, delay_per_exec, coreControl.at(i), std::addressof(coreState)));
+                cores.back()->setLogWriter(std::addressof(logWriter));
             }
 
             scheduler.assignReadyQueueToCores();
             scheduler.setIsFCFS(algorithm == FCFS);
 
+            //In pooled execution the core placement applies to the workers instead
+            affinity = planAffinity(affinityMode, producers, affinityClock, affinityScheduler, affinityCores);
+            synchronizer.setHostCpu(affinity.clockCpu);
+            scheduler.setHostCpu(affinity.schedulerCpu);
+            if (executionMode == EXECUTION_POOLED) {
+                corePool.init(std::addressof(cores), affinity.coreCpus, coreStepMode, std::addressof(coreState));
+            } else {
+                for(int i = 0; i < num_cpu; i++) {
+                    cores[i]->setHostCpu(affinity.coreCpus[i]);
+                }
+            }
+
             processMaxIns = max_ins;
             processMinIns = min_ins;
             processFreq = process_freq;
             processMaxMem = max_mem_per_proc;
             processMinMem = min_mem_per_proc;
+            tester.setArrivals(arrivalSettings, seed);
+            tester.setInstructionMix(instructionMix, programVariants, std::addressof(programCache));
+            shellRandom.seed(seed);
+            shellRandom.jump();
+            io.init(num_cpu, ioService, seed);
             
             boot();
+            synchronizer.setTickRate(tickRate);
             isInitialized = true;
 
-            processHistory["Main"].emplace_back("System booted successfully.\n", "RESET");
+            history("Main").add("System booted successfully.\n", RESET);
         }
         
+        //Returns false when the key is unknown or the value is out of range
+        bool parseOptionalConfig(const std::string& key, const std::string& value) {
+            if (key == "tick-rate") {
+                return parseTickRate(value, tickRate);
+            }
+
+            if (key == "workload") {
+                workloadPath = value == "random" ? "" : value;
+                return true;
+            }
+
+            if (key == "seed") {
+                char* end;
+                unsigned long long parsed = std::strtoull(value.c_str(), &end, 10);
+
+                if (*end != '\0' || end == value.c_str() || value[0] == '-') {
+                    return false;
+                }
+
+                seed = parsed;
+                return true;
+            }
+
+            if (key == "instruction-mix") {
+                return parseInstructionMix(value, instructionMix);
+            }
+
+            if (key == "disk-service") {
+                return parseIoServiceModel(value, ioService[IO_DISK]);
+            }
+
+            if (key == "terminal-service") {
+                return parseIoServiceModel(value, ioService[IO_TERMINAL]);
+            }
+
+            if (key == "program-variants") {
+                char* end;
+                long long parsed = std::strtoll(value.c_str(), &end, 10);
+
+                if (*end != '\0' || end == value.c_str() || parsed < 0 || parsed > 1000000) {
+                    return false;
+                }
+
+                programVariants = parsed;
+                return true;
+            }
+
+            if (key == "arrival") {
+                for (int kind = ARRIVAL_FIXED; kind <= ARRIVAL_DIURNAL; kind++) {
+                    if (value == ARRIVAL_KIND_NAMES[kind]) {
+                        arrivalSettings.kind = (ArrivalKind) kind;
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            if (key == "arrival-rate") {
+                char* end;
+                double parsed = std::strtod(value.c_str(), &end);
+
+                if (*end != '\0' || !(parsed > 0) || parsed > 1000000) {
+                    return false;
+                }
+
+                arrivalSettings.rate = parsed;
+                return true;
+            }
+
+            if (key == "arrival-batch" || key == "arrival-period") {
+                char* end;
+                long long parsed = std::strtoll(value.c_str(), &end, 10);
+
+                if (*end != '\0' || parsed < 1 || parsed > 1000000000LL) {
+                    return false;
+                }
+
+                (key == "arrival-batch" ? arrivalSettings.batch : arrivalSettings.period) = parsed;
+                return true;
+            }
+
+            if (key == "arrival-burst") {
+                char* end;
+                long long on = std::strtoll(value.c_str(), &end, 10);
+
+                if (*end != ',' || on < 1) {
+                    return false;
+                }
+
+                const char* start = end + 1;
+                long long off = std::strtoll(start, &end, 10);
+
+                if (*end != '\0' || end == start || off < 0 || on > 1000000000LL || off > 1000000000LL) {
+                    return false;
+                }
+
+                arrivalSettings.burstOn = on;
+                arrivalSettings.burstOff = off;
+                return true;
+            }
+
+            if (key == "compaction-budget") {
+                char* end;
+                long long parsed = std::strtoll(value.c_str(), &end, 10);
+
+                if (*end != '\0' || end == value.c_str() || parsed < 0 || parsed > (1LL << 40)) {
+                    return false;
+                }
+
+                compactionBudget = (uint64_t) parsed;
+                return true;
+            }
+
+            if (key == "huge-frame-size") {
+                char* end;
+                long long parsed = std::strtoll(value.c_str(), &end, 10);
+
+                if (*end != '\0' || end == value.c_str() || parsed < 0 || parsed > (1LL << 40)) {
+                    return false;
+                }
+
+                hugeFrameSize = (uint64_t) parsed;
+                return true;
+            }
+
+            if (key == "history-cap") {
+                char* end;
+                long long parsed = std::strtoll(value.c_str(), &end, 10);
+
+                if (*end != '\0' || parsed < 1024 || parsed > (1LL << 30)) {
+                    return false;
+                }
+
+                historyCap = (size_t) parsed;
+                return true;
+            }
+
+            if (key == "affinity") {
+                for (int mode = AFFINITY_NONE; mode <= AFFINITY_L3; mode++) {
+                    if (value == AFFINITY_MODE_NAMES[mode]) {
+                        affinityMode = (AffinityMode) mode;
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            if (key == "affinity-clock" || key == "affinity-scheduler") {
+                std::vector<int> cpus;
+
+                if (!parseCpuList(value, cpus) || cpus.size() != 1) {
+                    return false;
+                }
+
+                (key == "affinity-clock" ? affinityClock : affinityScheduler) = cpus[0];
+                return true;
+            }
+
+            if (key == "affinity-cores") {
+                return parseCpuList(value, affinityCores);
+            }
+
+            if (key == "execution") {
+                if (value != EXECUTION_MODE_NAMES[EXECUTION_THREADS] && value != EXECUTION_MODE_NAMES[EXECUTION_POOLED]) {
+                    return false;
+                }
+
+                executionMode = value == EXECUTION_MODE_NAMES[EXECUTION_POOLED] ? EXECUTION_POOLED : EXECUTION_THREADS;
+                return true;
+            }
+
+            if (key == "core-step") {
+                if (value == "auto") {
+                    coreStepMode = cpuSupportsAvx2() ? CORE_STEP_AVX2 : CORE_STEP_SCALAR;
+                    return true;
+                }
+
+                for (int mode = CORE_STEP_OBJECT; mode <= CORE_STEP_AVX2; mode++) {
+                    if (value == CORE_STEP_MODE_NAMES[mode]) {
+                        coreStepMode = (CoreStepMode) mode;
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            if (key == "workers") {
+                if (value == "auto") {
+                    workerCount = 0;
+                    return true;
+                }
+
+                char* end;
+                long long parsed = std::strtoll(value.c_str(), &end, 10);
+
+                if (*end != '\0' || parsed < 1 || parsed > 1024) {
+                    return false;
+                }
+
+                workerCount = (int) parsed;
+                return true;
+            }
+
+            return false;
+        }
+
+        // Options after "screen -ls", --running and --finished narrow the listing to one section
+        bool parseProcessListFilter(const std::vector<std::string>& tokens, ProcessListFilter& filter) {
+            for (size_t i = 2; i < tokens.size(); i++) {
+                if (tokens[i] == "--running") {
+                    filter.finished = false;
+                } else if (tokens[i] == "--finished") {
+                    filter.running = false;
+                } else if ((tokens[i] == "--limit" || tokens[i] == "--offset") && i + 1 < tokens.size()) {
+                    char* end;
+                    long long parsed = std::strtoll(tokens[i + 1].c_str(), &end, 10);
+
+                    if (*end != '\0' || end == tokens[i + 1].c_str() || parsed < 0) {
+                        return false;
+                    }
+
+                    (tokens[i] == "--limit" ? filter.limit : filter.offset) = parsed;
+                    i++;
+                } else {
+                    return false;
+                }
+            }
+
+            return filter.running || filter.finished;
+        }
+
+        bool parseTickRate(const std::string& value, long long& rate) {
+            if (value == "unbounded") {
+                rate = 0;
+                return true;
+            }
+
+            char* end;
+            long long parsed = std::strtoll(value.c_str(), &end, 10);
+
+            if (*end != '\0' || parsed < 1 || parsed > 1000000000LL) {
+                return false;
+            }
+
+            rate = parsed;
+            return true;
+        }
+
+        void cmd_tick_rate(const std::vector<std::string>& tokens) {
+            std::ostringstream output;
+
+            if (tokens.size() == 1) {
+                long long rate = synchronizer.getTickRate();
+                output << "Tick rate: " << (rate == 0 ? "unbounded" : std::to_string(rate) + " ticks/sec") << "\n";
+            } else if (tokens.size() == 2 && parseTickRate(tokens[1], tickRate)) {
+                synchronizer.setTickRate(tickRate);
+                output << "Tick rate set to " << (tickRate == 0 ? "unbounded" : std::to_string(tickRate) + " ticks/sec") << ".\n";
+            } else {
+                output << "Error! Correct usage: tick-rate, tick-rate <ticks-per-second> or tick-rate unbounded\n";
+            }
+
+            *console << output.str();
+            history("Main").add(output.str(), RESET);
+        }
+
+        void cmd_workload(const std::vector<std::string>& tokens) {
+            std::ostringstream output;
+
+            if (tokens.size() == 3 && tokens[1] == "replay") {
+                if (tester.isActive()) {
+                    output << "Error! Stop scheduler-test before changing the workload.\n";
+                } else if (!workload.open(tokens[2])) {
+                    output << "Error! Invalid workload: " << workload.getError() << ".\n";
+                } else {
+                    workloadPath = tokens[2];
+                    output << "scheduler-test will replay " << tokens[2] << ".\n";
+                }
+            } else if (tokens.size() == 2 && tokens[1] == "random") {
+                if (tester.isActive()) {
+                    output << "Error! Stop scheduler-test before changing the workload.\n";
+                } else {
+                    workloadPath = "";
+                    workload.close();
+                    tester.setReplay(nullptr);
+                    output << "scheduler-test will generate random processes.\n";
+                }
+            } else if (tokens.size() == 3 && tokens[1] == "record") {
+                if (workloadRecorder.start(tokens[2], synchronizer.getSyncClock()->load())) {
+                    output << "Recording arrivals to " << tokens[2] << ".\n";
+                } else {
+                    output << "Error! Could not create workload file " << tokens[2] << ".\n";
+                }
+            } else if (tokens.size() == 2 && tokens[1] == "stop") {
+                if (!workloadRecorder.isEnabled()) {
+                    output << "Error! No workload is being recorded.\n";
+                } else {
+                    workloadRecorder.stop();
+                    output << "Workload saved to " << workloadRecorder.getPath() << " (" << workloadRecorder.getRecordCount() << " arrivals).\n";
+                }
+            } else if (tokens.size() == 2 && tokens[1] == "status") {
+                if (workloadPath.empty()) {
+                    output << "Workload: random, " << tester.describeArrivals() << ", seed " << seed << "\n";
+                } else {
+                    output << "Workload: replay of " << workloadPath << ", " << tester.getReplayed() << " arrivals admitted, "
+                           << tester.getReplaySkipped() << " skipped as duplicate names\n";
+
+                    if (!workload.getError().empty()) {
+                        output << "Replay stopped: " << workload.getError() << "\n";
+                    }
+                }
+
+                output << "Instruction mix: " << INSTRUCTION_MIX_NAMES[instructionMix] << "\n";
+
+                if (instructionMix != MIX_PLAIN) {
+                    ProgramCacheStats images = programCache.getStats();
+                    output << "Program images: " << images.images << " live, " << images.bytes << " bytes, "
+                           << images.hits << " shared, " << images.misses << " new";
+                    output << (programVariants > 0 ? ", " + std::to_string(programVariants) + " variants per size\n" : ", no variant limit\n");
+                }
+
+                if (workloadRecorder.isEnabled()) {
+                    output << "Recording to " << workloadRecorder.getPath() << ", " << workloadRecorder.getRecordCount() << " arrivals\n";
+                }
+            } else {
+                output << "Error! Correct usage: workload replay <file>, workload random, workload record <file>, workload stop or workload status\n";
+            }
+
+            *console << output.str();
+            history("Main").add(output.str(), RESET);
+        }
+
         void cmd_scheduler_test() {
             if(tester.isActive()) {
-                std::cout << "Error! scheduler-test still active!\n";
-                processHistory["Main"].emplace_back("Error! scheduler-test still active!\n", "RESET");
+                *console << "Error! scheduler-test still active!\n";
+                history("Main").add("Error! scheduler-test still active!\n", RESET);
                 return;
             }
 
+            //Every run replays the workload from its first arrival
+            if (!workloadPath.empty() && !workload.rewind()) {
+                *console << "Error! Invalid workload: " << workload.getError() << ".\n";
+                history("Main").add("Error! Invalid workload: " + workload.getError() + ".\n", RESET);
+                return;
+            }
+            tester.setReplay(workloadPath.empty() ? nullptr : std::addressof(workload));
+
             synchronizer.startTester();
 
             while(!tester.isActive()) {};
-            std::cout << "Scheduler started\n";
-            processHistory["Main"].emplace_back("Scheduler started\n", "RESET");
+            *console << "Scheduler started\n";
+            history("Main").add("Scheduler started\n", RESET);
         }
 
         void cmd_scheduler_stop() {
             if(!tester.isActive()) {
-                std::cout << "Error! scheduler-test is not active!\n";
-                processHistory["Main"].emplace_back("Error! scheduler-test is not active!\n", "RESET");
+                *console << "Error! scheduler-test is not active!\n";
+                history("Main").add("Error! scheduler-test is not active!\n", RESET);
                 return;
             }
 
-            tester.turnOff();
-            std::cout << "Scheduler stopped\n";
-            processHistory["Main"].emplace_back("Scheduler stoped\n", "RESET");
+            synchronizer.stopTester();
+
+            while(tester.isActive()) {};
+            *console << "Scheduler stopped\n";
+            history("Main").add("Scheduler stoped\n", RESET);
         }
 
         void cmd_report_util() {
-            std::vector<Process> runningProcesses;
-            std::vector<Process> finishedProcesses;
+            logProcesses(directory + "/Logs/csopesy-log.txt", totalCores, processes.snapshot());
 
-            for(const auto& process: processes) {
-                if(process.second->completed) {
-                    finishedProcesses.push_back(*process.second);
+            std::ostringstream output;                
+            output << "\"csopesy-log.txt\" report generated successfully.\n";
+            *console << output.str();
+            history("Main").add(output.str(), RESET);
+        }
+
+        void cmd_log(const std::vector<std::string>& tokens) {
+            std::ostringstream output;
+
+            if (tokens.size() == 2 && tokens[1] == "on") {
+                logWriter.setEnabled(true);
+                output << "Process logging enabled.\n";
+            } else if (tokens.size() == 2 && tokens[1] == "off") {
+                logWriter.setEnabled(false);
+                output << "Process logging disabled.\n";
+            } else if (tokens.size() == 3 && tokens[1] == "policy") {
+                int policy = parseLogPolicy(tokens[2]);
+
+                if (policy == -1) {
+                    output << "Error! Invalid log policy. Use drop, block or sample.\n";
                 } else {
-                    runningProcesses.push_back(*process.second);
+                    logWriter.setPolicy((LogPolicy) policy);
+                    output << "Log policy set to " << tokens[2] << ".\n";
                 }
+            } else if (tokens.size() == 2 && tokens[1] == "status") {
+                const char* policyNames[] = { "drop", "block", "sample" };
+                output << "Process logging: " << (logWriter.isEnabled() ? "on" : "off") << "\n";
+                output << "Policy: " << policyNames[logWriter.getPolicy()] << "\n";
+                output << "Lines written: " << logWriter.getWritten() << "\n";
+                output << "Lines dropped: " << logWriter.getDropped() << "\n";
+            } else {
+                output << "Error! Correct usage: log on, log off, log policy <drop|block|sample> or log status\n";
             }
 
-            logProcesses(totalCores, runningProcesses, finishedProcesses);
+            *console << output.str();
+            history("Main").add(output.str(), RESET);
+        }
 
-            std::ostringstream output;                
-            output << "\"csopesy-log.txt\" report generated successfully.\n";
-            std::cout << output.str();
-            processHistory["Main"].emplace_back(output.str(), "RESET");
+        CheckpointTargets checkpointTargets() {
+            return { std::addressof(processes), std::addressof(scheduler), std::addressof(cores), memory, std::addressof(tester),
+                     std::addressof(logWriter), std::addressof(io), std::addressof(programCache), synchronizer.getSyncClock(),
+                     quantumCycles, delayPerExec, schedulerAlgorithm };
+        }
+
+        // Releases every finished process that is off the cores, its slot is reused by the next process
+        // created. Between two ticks, after the log writer has written every line of the processes.
+        void cmd_purge(const std::vector<std::string>& tokens) {
+            std::ostringstream output;
+
+            if (tokens.size() != 1) {
+                output << "Error! Correct usage: purge\n";
+            } else {
+                std::vector<std::string> names;
+
+                synchronizer.runBetweenTicks([&]() {
+                    std::vector<ProcessHandle> finished;
+
+                    logWriter.quiesce();
+                    processes.forEach([&](const Process& p) {
+                        if (p.completed && p.core == -1 && p.completionTick != -1 && p.allocatedMemory.empty()) {
+                            finished.push_back(p.handle);
+                            names.push_back(p.name);
+                        }
+                    });
+
+                    for (const ProcessHandle& handle : finished) {
+                        memory->removeFromProcessList(processes.get(handle));
+                        processes.release(handle);
+                    }
+                });
+
+                for (const std::string& name : names) {
+                    processHistory.erase(name);
+                }
+                output << "Released " << names.size() << " finished processes, " << processes.size() << " remain.\n";
+            }
+
+            *console << output.str();
+            history("Main").add(output.str(), RESET);
+        }
+
+        //Both take effect between two ticks, so the saved or restored state is one consistent tick
+        void cmd_checkpoint(const std::vector<std::string>& tokens) {
+            std::ostringstream output;
+
+            if (tokens.size() != 2) {
+                output << "Error! Correct usage: checkpoint <file>\n";
+            } else {
+                bool saved = false;
+                std::string error;
+                long long tick = 0;
+                auto start = std::chrono::steady_clock::now();
+
+                synchronizer.runBetweenTicks([&]() {
+                    tick = synchronizer.getSyncClock()->load();
+                    saved = saveCheckpoint(tokens[1], checkpointTargets(), error);
+                });
+
+                long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+                if (saved) {
+                    output << "Checkpoint of tick " << tick << " saved to " << tokens[1] << " (" << processes.size() << " processes, " << elapsed << " ms).\n";
+                } else {
+                    output << "Error! Checkpoint failed: " << error << ".\n";
+                }
+            }
+
+            *console << output.str();
+            history("Main").add(output.str(), RESET);
+        }
+
+        void cmd_restore(const std::vector<std::string>& tokens) {
+            std::ostringstream output;
+
+            if (tokens.size() != 2) {
+                output << "Error! Correct usage: restore <file>\n";
+            } else {
+                bool restored = false;
+                std::string error;
+                long long savedTick = 0;
+                long long tick = 0;
+                auto start = std::chrono::steady_clock::now();
+
+                synchronizer.runBetweenTicks([&]() {
+                    restored = restoreCheckpoint(tokens[1], checkpointTargets(), savedTick, error);
+                    tick = synchronizer.getSyncClock()->load();
+                });
+
+                long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+                if (restored) {
+                    output << "Restored tick " << savedTick << " from " << tokens[1] << " at tick " << tick << " (" << processes.size() << " processes, " << elapsed << " ms).\n";
+                } else {
+                    output << "Error! Restore failed: " << error << ".\n";
+                }
+            }
+
+            *console << output.str();
+            history("Main").add(output.str(), RESET);
+        }
+
+        void cmd_trace(const std::vector<std::string>& tokens) {
+            std::ostringstream output;
+
+            if (tokens.size() == 3 && tokens[1] == "start") {
+                if (tracer.start(tokens[2], totalCores, memAdd, memPerFrame)) {
+                    output << "Tracing scheduler and memory events to " << tokens[2] << ".\n";
+                } else {
+                    output << "Error! Could not create trace file " << tokens[2] << ".\n";
+                }
+            } else if (tokens.size() == 2 && tokens[1] == "stop") {
+                if (!tracer.isEnabled()) {
+                    output << "Error! No trace is active.\n";
+                } else {
+                    tracer.stop();
+                    output << "Trace saved to " << tracer.getPath() << " (" << tracer.getRecordCount() << " records).\n";
+                }
+            } else if (tokens.size() == 2 && tokens[1] == "status") {
+                if (tracer.isEnabled()) {
+                    output << "Tracing to " << tracer.getPath() << ", " << tracer.getRecordCount() << " records flushed.\n";
+                } else {
+                    output << "Tracing is off.\n";
+                }
+            } else {
+                output << "Error! Correct usage: trace start <file>, trace stop or trace status\n";
+            }
+
+            *console << output.str();
+            history("Main").add(output.str(), RESET);
+        }
+
+        //Reads only the published metric snapshots, so it never waits on the simulation threads
+        std::string buildMetricsJson() {
+            std::ostringstream json;
+            SchedulerMetrics schedulerMetrics = scheduler.getMetrics();
+            MemoryStats memoryStats = memory->getMemoryStats();
+
+            json << "{\"tick\":" << synchronizer.getSyncClock()->load();
+            json << ",\"scheduler\":{\"clock\":" << schedulerMetrics.clock
+                 << ",\"ready_queue\":" << schedulerMetrics.readyQueueLength
+                 << ",\"dispatches\":" << schedulerMetrics.dispatches
+                 << ",\"preemptions\":" << schedulerMetrics.preemptions
+                 << ",\"completions\":" << schedulerMetrics.completions
+                 << ",\"memory_requeues\":" << schedulerMetrics.memoryRequeues
+                 << ",\"sleeps\":" << schedulerMetrics.sleeps
+                 << ",\"sleeping\":" << schedulerMetrics.sleeping
+                 << ",\"io_requests\":" << schedulerMetrics.ioRequests
+                 << ",\"interrupts\":" << schedulerMetrics.interrupts
+                 << ",\"cpu_io_overlap_ticks\":" << schedulerMetrics.overlapTicks << "}";
+
+            IoStats ioStats = io.getStats();
+            json << ",\"devices\":[";
+            for (int i = 0; i < IO_DEVICE_COUNT; i++) {
+                const IoDeviceStats& device = ioStats.devices[i];
+                json << (i > 0 ? "," : "") << "{\"name\":\"" << IO_DEVICE_NAMES[i] << "\""
+                     << ",\"busy_ticks\":" << device.busyTicks
+                     << ",\"queue\":" << device.queueLength
+                     << ",\"requests\":" << device.requests
+                     << ",\"completions\":" << device.completions << "}";
+            }
+            json << "]";
+
+            json << ",\"cores\":[";
+            for (size_t i = 0; i < cores.size(); i++) {
+                CoreMetrics coreMetrics = cores[i]->getMetrics();
+                json << (i > 0 ? "," : "") << "{\"id\":" << i
+                     << ",\"clock\":" << coreMetrics.clock
+                     << ",\"active_ticks\":" << coreMetrics.activeTicks
+                     << ",\"idle_ticks\":" << coreMetrics.clock - coreMetrics.activeTicks
+                     << ",\"quantum_remaining\":" << coreMetrics.quantumRemaining
+                     << ",\"pid\":" << coreMetrics.processId
+                     << ",\"host_cpu\":" << cores[i]->getHostCpu()
+                     << ",\"pinned\":" << (cores[i]->isPinned() ? "true" : "false") << "}";
+            }
+            json << "]";
+
+            json << ",\"memory\":{\"total\":" << memAdd
+                 << ",\"used\":" << memoryStats.usedMemory
+                 << ",\"free\":" << memoryStats.totalFragmentation
+                 << ",\"largest_free_chunk\":" << memoryStats.largestFreeChunk
+                 << ",\"external_fragmentation\":" << memoryStats.externalFragmentation
+                 << ",\"processes_resident\":" << memoryStats.processes_in_memory
+                 << ",\"paged_in\":" << memoryStats.pagedInCount
+                 << ",\"paged_out\":" << memoryStats.pagedOutCount
+                 << ",\"swapped_out_bytes\":" << memoryStats.swappedOutBytes
+                 << ",\"compacted_bytes\":" << memoryStats.compactedBytes
+                 << ",\"swap_avoided_bytes\":" << memoryStats.swapAvoidedBytes
+                 << ",\"allocations\":" << memoryStats.allocations
+                 << ",\"frames_allocated\":" << memoryStats.framesAllocated
+                 << ",\"huge_frames_in_use\":" << memoryStats.hugeFramesInUse
+                 << ",\"huge_promotions\":" << memoryStats.hugePromotions
+                 << ",\"huge_demotions\":" << memoryStats.hugeDemotions
+                 << ",\"huge_fallbacks\":" << memoryStats.hugeFallbacks << "}";
+
+            json << ",\"placement\":{\"mode\":\"" << AFFINITY_MODE_NAMES[affinity.mode] << "\""
+                 << ",\"domain\":" << affinity.domain
+                 << ",\"clock_cpu\":" << synchronizer.getHostCpu()
+                 << ",\"clock_pinned\":" << (synchronizer.isPinned() ? "true" : "false")
+                 << ",\"scheduler_cpu\":" << scheduler.getHostCpu()
+                 << ",\"scheduler_pinned\":" << (scheduler.isPinned() ? "true" : "false")
+                 << ",\"execution\":\"" << EXECUTION_MODE_NAMES[executionMode] << "\""
+                 << ",\"core_step\":\"" << CORE_STEP_MODE_NAMES[coreStepMode] << "\"";
+
+            if (executionMode == EXECUTION_POOLED) {
+                json << ",\"workers\":[";
+                for (int i = 0; i < corePool.getWorkerCount(); i++) {
+                    json << (i > 0 ? "," : "") << "{\"id\":" << i
+                         << ",\"host_cpu\":" << corePool.getWorkerHostCpu(i)
+                         << ",\"pinned\":" << (corePool.isWorkerPinned(i) ? "true" : "false") << "}";
+                }
+                json << "]";
+            }
+            json << "}";
+
+            json << ",\"log\":{\"written\":" << logWriter.getWritten()
+                 << ",\"dropped\":" << logWriter.getDropped() << "}";
+            json << "}";
+
+            return json.str();
+        }
+
+        void cmd_stats(const std::vector<std::string>& tokens) {
+            std::ostringstream output;
+
+            if (tokens.size() == 2 && tokens[1] == "--json") {
+                output << buildMetricsJson() << "\n";
+            } else if (tokens.size() == 3 && tokens[1] == "--dump" && tokens[2] == "off") {
+                metricsDumper.turnOff();
+                output << "Metrics dump stopped.\n";
+            } else if (tokens.size() == 4 && tokens[1] == "--dump") {
+                char* end;
+                long long interval = std::strtoll(tokens[3].c_str(), &end, 10);
+
+                if (*end != '\0' || end == tokens[3].c_str() || interval < 1) {
+                    output << "Error! Invalid dump interval.\n";
+                } else if (metricsDumper.start(tokens[2], interval, [this] { return buildMetricsJson(); })) {
+                    output << "Dumping metrics to " << tokens[2] << " every " << interval << " ms.\n";
+                } else {
+                    output << "Error! Could not open " << tokens[2] << ".\n";
+                }
+            } else {
+                output << "Error! Correct usage: stats --json, stats --dump <file> <interval-ms> or stats --dump off\n";
+            }
+
+            *console << output.str();
+            history("Main").add(output.str(), RESET);
+        }
+
+        void cmd_perf(const std::vector<std::string>& tokens) {
+            std::ostringstream output;
+
+            if (tokens.size() == 2 && tokens[1] == "reset") {
+                for (int phase = 0; phase < PHASE_COUNT; phase++) {
+                    synchronizer.getPhaseTime((TickPhase) phase)->requestReset();
+                }
+
+                for (const auto& core : cores) {
+                    core->getExecuteTime()->requestReset();
+                }
+
+                output << "Performance histograms reset.\n";
+                *console << output.str();
+                history("Main").add(output.str(), RESET);
+                return;
+            }
+
+            if (tokens.size() != 1) {
+                output << "Error! Correct usage: perf or perf reset\n";
+                *console << output.str();
+                history("Main").add(output.str(), RESET);
+                return;
+            }
+
+            char line[160];
+            snprintf(line, sizeof(line), "%-12s %12s %10s %10s %10s %10s %10s %10s\n", "phase (ns)", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+            output << line;
+
+            auto printRow = [&](const std::string& name, const HistogramSnapshot& snapshot) {
+                snprintf(line, sizeof(line), "%-12s %12llu %10.0f %10llu %10llu %10llu %10llu %10llu\n", name.c_str(),
+                         (unsigned long long) snapshot.count, snapshot.mean(),
+                         (unsigned long long) snapshot.valueAtPercentile(50), (unsigned long long) snapshot.valueAtPercentile(90),
+                         (unsigned long long) snapshot.valueAtPercentile(99), (unsigned long long) snapshot.valueAtPercentile(99.9),
+                         (unsigned long long) snapshot.max);
+                output << line;
+            };
+
+            double meanTick = 0;
+            for (int phase = 0; phase < PHASE_COUNT; phase++) {
+                //Heap allocated as every snapshot carries the full bucket array
+                std::unique_ptr<HistogramSnapshot> snapshot = std::make_unique<HistogramSnapshot>();
+                synchronizer.getPhaseTime((TickPhase) phase)->mergeInto(*snapshot);
+                printRow(TICK_PHASE_NAMES[phase], *snapshot);
+
+                if (phase == PHASE_TICK) {
+                    meanTick = snapshot->mean();
+                }
+            }
+
+            std::unique_ptr<HistogramSnapshot> allCores = std::make_unique<HistogramSnapshot>();
+            for (const auto& core : cores) {
+                std::unique_ptr<HistogramSnapshot> snapshot = std::make_unique<HistogramSnapshot>();
+                core->getExecuteTime()->mergeInto(*snapshot);
+                core->getExecuteTime()->mergeInto(*allCores);
+                printRow("core " + std::to_string(core->getId()), *snapshot);
+            }
+            printRow("all cores", *allCores);
+
+            snprintf(line, sizeof(line), "\n%.0f ticks/sec at the mean tick time\n", meanTick > 0 ? 1e9 / meanTick : 0.0);
+            output << line;
+
+            *console << output.str();
+            history("Main").add(output.str(), RESET);
         }
 
         void cmd_clear() {
             system("cls");
-            printHeader();
+            printHeader(*console);
             cmd_display_history("Main");
         }
 
-        void cmd_screen(Process process) {
-            isInMainConsole = false; // Set flag to false
-            system("cls");
-            cmd_display_history(process.name);
-
+        std::string formatProcessScreen(const Process& process) {
             std::ostringstream output; 
             output << "\nProcess: " << process.name << "\n";
             output << "ID: " << process.id << "\n\n";
@@ -356,71 +1250,109 @@ class System
                 output << "Lines of code: " << process.total_instructions << "\n\n";
             }
 
-            std::cout << output.str();
-            processHistory[process.name].emplace_back(output.str(), "RESET");
+            if (process.program) {
+                output << "Program: " << process.program->code.size() << " bytes of bytecode, " << process.program->variables
+                       << " variables in " << process.program->variables * 2 << " bytes of memory\n\n";
+            }
+
+            output << "Arrival tick: " << process.arrivalTick << "\n";
+            output << "First dispatch tick: " << process.firstDispatchTick << "\n";
+            output << "Completion tick: " << process.completionTick << "\n";
+            output << "Ticks waiting in ready queue: " << process.waitingTicks << "\n";
+            output << "Ticks blocked on memory: " << process.memoryBlockedTicks << "\n";
+            output << "Ticks blocked on I/O: " << process.ioBlockedTicks << "\n";
+            output << "Preemptions: " << process.preemptions << "\n";
+            output << "Swaps: " << process.swaps << "\n\n";
+
+            return output.str();
+        }
+
+        void cmd_screen(const Process& process) {
+            isInMainConsole = false; // Set flag to false
+            system("cls");
+            cmd_display_history(process.name);
+
+            std::ostringstream output; 
+            output << formatProcessScreen(process);
+
+            *console << output.str();
+            history(process.name).add(output.str(), RESET);
 
             current_process = process.name; // Store process
         }
 
 
+        // A screen's history, created with the configured cap on first use
+        ScreenHistory& history(const std::string& screen) {
+            auto entry = processHistory.find(screen);
+
+            if (entry == processHistory.end()) {
+                entry = processHistory.emplace(screen, ScreenHistory(historyCap)).first;
+            }
+
+            return entry->second;
+        }
+
         void cmd_display_history(const std::string& process_name) {
-            if (processHistory.find(process_name) != processHistory.end()) {
-                const auto& processData = processHistory[process_name];
+            auto screen = processHistory.find(process_name);
 
-                for (const auto& entry : processData) {
-                    TextColor color = stringToColor(entry.second);
-                    printColored(entry.first, color);
-                }
+            if (screen != processHistory.end()) {
+                BufferedWriter out(console, true);
+
+                screen->second.forEach([&](const char* text, size_t length, TextColor color) {
+                    out.write(std::string(text, length), color);
+                });
             }
         }
 
 
         void cmd_screen_r(const std::string& process_name) {
-            for (const auto& process : processes) {
-                if (process.second->name == process_name) {
-                    if(process.second->completed) {
-                        break;
-                    }
+            Process* process = processes.find(process_name);
 
-                    cmd_screen(*process.second);
-                    return;
-                }
+            if (process != nullptr && !process->completed) {
+                cmd_screen(*process);
+                return;
             }
-            std::cout << "Error! Process " << process_name << " not found.\n";
-            processHistory["Main"].emplace_back("Error! Process " + process_name + " not found.\n", "RESET");
+            *console << "Error! Process " << process_name << " not found.\n";
+            history("Main").add("Error! Process " + process_name + " not found.\n", RESET);
         }
 
-        std::shared_ptr<Process> cmd_screen_add(const std::string& process_name) {
+        Process* cmd_screen_add(const std::string& process_name) {
             // Check if the process already exists
             while(tester.isActive() && !tester.isLocked()) {}
             tester.lock();
 
-            for (const auto& process : processes) {
-                if (process.second->name == process_name) {
-                    std::cout << "Error! Process " << process_name << " already exists.\n";
-                    processHistory["Main"].emplace_back("Error! Process " + process_name + " already exists.\n", "RESET");
-                    tester.unlock();
-                    return nullptr;  // Exit the function if a duplicate is found
-                }
+            if (processes.contains(process_name)) {
+                *console << "Error! Process " << process_name << " already exists.\n";
+                history("Main").add("Error! Process " + process_name + " already exists.\n", RESET);
+                tester.unlock();
+                return nullptr;  // Exit the function if a duplicate is found
             }
-            // Set random number of instructions
-            long long instructions = processMinIns + (rand() % (processMaxIns - processMinIns + 1));
-            // Set random memory per process
-            long long memoryPerProcess = static_cast<long long>(pow(2, static_cast<int>(log2(processMinMem)) + 
-                                                                rand() % (static_cast<int>(log2(processMaxMem) - log2(processMinMem) + 1))));
+            long long instructions = drawInstructions(shellRandom, processMinIns, processMaxIns);
+            long long memoryPerProcess = drawMemorySize(shellRandom, processMinMem, processMaxMem);
             // If no duplicates, create and add the new process
-            std::shared_ptr<Process> newProcess = std::make_shared<Process>(process_name, instructions, getCurrentTimestamp(), memoryPerProcess);
-            processes.insert(std::make_pair(process_name, newProcess));
+            Process* newProcess = processes.create(process_name, instructions, getCurrentTimestamp(), memoryPerProcess);
+
+            if (newProcess == nullptr) {
+                *console << "Error! Process table is full.\n";
+                history("Main").add("Error! Process table is full.\n", RESET);
+                tester.unlock();
+                return nullptr;
+            }
+
+            if (instructionMix != MIX_PLAIN) {
+                newProcess->load(ProgramGenerator(shellRandom, instructionMix, programVariants, std::addressof(programCache)).generate(instructions, memoryPerProcess));
+            }
 
             //Add to scheduler
-            scheduler.enqueue(newProcess.get());
+            scheduler.admit(newProcess);
             tester.unlock();
             return newProcess;
         }
 
         std::string static getCurrentTimestamp() {
             std::time_t t = std::time(&t);
-            std::tm now = *localtime(&t);
+            std::tm now = toLocalTime(t);
 
             std::ostringstream oss;
             oss << std::put_time(&now, "%m/%d/%Y, %I:%M:%S %p");
@@ -444,9 +1376,9 @@ class System
             std::vector<std::string> tokens = tokenizeInput(input);
 
             if (tokens.empty()) {
-                processHistory["Main"].emplace_back("Enter a command: \n", "RESET");
-                std::cout << "Error! Empty input.\n";
-                processHistory["Main"].emplace_back("Error! Empty input.\n", "RESET");
+                history("Main").add("Enter a command: \n", RESET);
+                *console << "Error! Empty input.\n";
+                history("Main").add("Error! Empty input.\n", RESET);
                 return;
             }
 
@@ -456,46 +1388,38 @@ class System
             if (!isInMainConsole) {
                 if (command == "exit") {
                     isInMainConsole = true;
-                    processHistory[current_process].emplace_back("Enter a command: exit\n\n", "RESET");
+                    history(current_process).add("Enter a command: exit\n\n", RESET);
                     cmd_clear();
                 }
                 else if (command == "process-smi"){
-                    for(const auto& process: processes) {
-                        if (process.second->name == current_process) {
-                            std::ostringstream output; 
-                            output << "\nProcess: " << process.second->name << "\n";
-                            output << "ID: " << process.second->id << "\n\n";
-                            
-                            if (process.second->completed) {
-                                output << "Finished!\n\n";
-                            } else {
-                                output << "Current instruction line: " << process.second->current_instruction << "\n";
-                                output << "Lines of code: " << process.second->total_instructions << "\n\n";
-                            }
-
-                            std::cout << output.str();
-                            processHistory[process.second->name].emplace_back("Enter a command: process-smi\n", "RESET");
-                            processHistory[process.second->name].emplace_back(output.str(), "RESET");
+                    Process* process = processes.find(current_process);
 
-                            return;
-                        }
+                    if (process != nullptr) {
+                        std::ostringstream output; 
+                        output << formatProcessScreen(*process);
+
+                        *console << output.str();
+                        history(process->name).add("Enter a command: process-smi\n", RESET);
+                        history(process->name).add(output.str(), RESET);
+
+                        return;
                     }
                 } 
                 else {
                     std::ostringstream output;
                     output << "Error! Invalid command.\n\n";
-                    std::cout << output.str();
+                    *console << output.str();
 
                     std::ostringstream commandOutput;
                     commandOutput << "Enter a command: " << command << "\n";
-                    processHistory[current_process].emplace_back(commandOutput.str(), "RESET");
-                    processHistory[current_process].emplace_back(output.str(), "RESET");
+                    history(current_process).add(commandOutput.str(), RESET);
+                    history(current_process).add(output.str(), RESET);
 
                     return;
                 } 
             }
             else if (command == "clear") {
-                processHistory["Main"].clear();
+                history("Main").clear();
                 cmd_clear();
             }
             else if (command == "exit") {
@@ -503,21 +1427,21 @@ class System
                 std::exit(0);
             }
             else if (command == "initialize") {
-                processHistory["Main"].emplace_back("Enter a command: initialize\n", "RESET");
+                history("Main").add("Enter a command: initialize\n", RESET);
                 cmd_initialize();
             }
             else if (command == "screen") {
-                processHistory["Main"].emplace_back("Enter a command: "+ input +"\n", "RESET");
+                history("Main").add("Enter a command: "+ input +"\n", RESET);
 
                 if(!isInitialized) {
-                    std::cout << "Error! System not initialized.\n";
-                    processHistory["Main"].emplace_back("Error! System not initialized.\n", "RESET");
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
                     return;
                 }
                 if (tokens.size() == 3 && tokens[1] == "-s") {
                     std::string process_name = tokens[2];
 
-                    std::shared_ptr<Process> newProcess = cmd_screen_add(process_name);  // Add new process
+                    Process* newProcess = cmd_screen_add(process_name);  // Add new process
                     if(newProcess != nullptr)
                         cmd_screen(*newProcess);  // Display the new process info
                 }
@@ -526,172 +1450,230 @@ class System
                     
                     cmd_screen_r(process_name);
                 }
-                else if (tokens.size() == 2 && tokens[1] == "-ls") {
-                    std::vector<Process> runningProcesses;
-                    std::vector<Process> finishedProcesses;
+                else if (tokens.size() >= 2 && tokens[1] == "-ls") {
+                    ProcessListFilter filter;
 
-                    for(const auto& process: processes) {
-                        if(process.second->completed) {
-                            finishedProcesses.push_back(*process.second);
-                        } else {
-                            runningProcesses.push_back(*process.second);
-                        }
+                    if (!parseProcessListFilter(tokens, filter)) {
+                        *console << "Error! Correct usage: screen -ls [--running | --finished] [--limit <count>] [--offset <count>]\n";
+                        history("Main").add("Error! Correct usage: screen -ls [--running | --finished] [--limit <count>] [--offset <count>]\n", RESET);
+                        return;
                     }
 
-                    std::vector<std::pair<std::string, std::string>> processDetails = printProcesses(totalCores, runningProcesses, finishedProcesses);
-                    processHistory["Main"].insert(processHistory["Main"].end(), processDetails.begin(), processDetails.end());
+                    BufferedWriter out(console, true, std::addressof(history("Main")));
+                    writeProcessList(out, processes.snapshot(), totalCores, filter, true);
                 }   
                 else {
-                    std::cout << "Error! Correct usage: screen -s <process_name> or screen -r <process_name> or screen -ls\n";
-                    processHistory["Main"].emplace_back("Error! Correct usage: screen -s <process_name> or screen -r <process_name> or screen -ls\n", "RESET");
+                    *console << "Error! Correct usage: screen -s <process_name> or screen -r <process_name> or screen -ls [options]\n";
+                    history("Main").add("Error! Correct usage: screen -s <process_name> or screen -r <process_name> or screen -ls [options]\n", RESET);
                 }
             }
             else if (command == "scheduler-test") {
-                processHistory["Main"].emplace_back("Enter a command: scheduler-test\n", "RESET");
+                history("Main").add("Enter a command: scheduler-test\n", RESET);
 
                 if(!isInitialized) {
-                    std::cout << "Error! System not initialized.\n";
-                    processHistory["Main"].emplace_back("Error! System not initialized.\n", "RESET");
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
                     return;
                 }
                 cmd_scheduler_test();
             }
             else if (command == "scheduler-stop") {
-                processHistory["Main"].emplace_back("Enter a command: scheduler-stop\n", "RESET");
+                history("Main").add("Enter a command: scheduler-stop\n", RESET);
 
                 if(!isInitialized) {
-                    std::cout << "Error! System not initialized.\n";
-                    processHistory["Main"].emplace_back("Error! System not initialized.\n", "RESET");
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
                     return;
                 }
                 cmd_scheduler_stop();
             }
             else if (command == "report-util") {
-                processHistory["Main"].emplace_back("Enter a command: report-util\n", "RESET");
+                history("Main").add("Enter a command: report-util\n", RESET);
                 if(!isInitialized) {
-                    std::cout << "Error! System not initialized.\n";
-                    processHistory["Main"].emplace_back("Error! System not initialized.\n", "RESET");
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
                     return;
                 }
                 cmd_report_util();
             }
             else if (command == "process-smi"){
-                processHistory["Main"].emplace_back("Enter a command: process-smi\n", "RESET");
+                history("Main").add("Enter a command: process-smi\n", RESET);
                 if(!isInitialized) {
-                    std::cout << "Error! System not initialized.\n";
-                    processHistory["Main"].emplace_back("Error! System not initialized.\n", "RESET");
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
                     return;
                 }
-                std::vector<Process> runningProcesses;
                 int running_ctr = 0; 
 
-
-                for(const auto& process: processes) {
-                    if(!process.second->completed) {
-                        runningProcesses.push_back(*process.second);
-                        if (process.second->core != -1){
-                            running_ctr++;
-                        }
+                processes.forEach([&](const Process& process) {
+                    if (!process.completed && process.core != -1) {
+                        running_ctr++;
                     }
-                }
+                });
 
                 MemoryStats stats = memory->getMemoryStats();
-                int memory_usage = 0;
-                for (auto memoryRegion = stats.processMemoryRegions.rbegin(); memoryRegion != stats.processMemoryRegions.rend(); ++memoryRegion) {
-                    int mem_usage = (memoryRegion->endAddress - memoryRegion->startAddress)+1;
-                    memory_usage += mem_usage;
-                }
+                int memory_usage = stats.usedMemory;
                 int memory_util = static_cast<double>(memory_usage) / memAdd * 100;
                 int cpu_util = static_cast<double>(running_ctr) / totalCores * 100;
                 cpu_util = cpu_util < 0 ? 0 : cpu_util;   
-                printColored("--------------------------------------------------\n", BLUE);
-                printColored("|", BLUE);  
-                std::cout << " PROCESS-SMI V01";
-                printColored(".00 ", YELLOW);
-                std::cout << "Driver Version: ";
-                printColored("01.00 ", YELLOW);
-                printColored("|\n", BLUE);
-                printColored("--------------------------------------------------\n", BLUE);
-                std::cout << "CPU utilization: ";
-                printColored(std::to_string(cpu_util), YELLOW);
-                printColored("%\n", BLUE);
-                std::cout << "Memory Usage: ";
-                // printColored(std::to_string(memory_usage/1024), YELLOW); // convert KB to MiB
-                // printColored("MiB ", YELLOW);
-                printColored(std::to_string(memory_usage), YELLOW);
-                printColored("KB ", YELLOW);
-                printColored("/ ", BLUE);
-                // printColored(std::to_string(memAdd/1024), YELLOW); // convert KB to MiB
-                // printColored("MiB\n", YELLOW);
-                printColored(std::to_string(memAdd), YELLOW); 
-                printColored("KB\n", YELLOW);
-                std::cout << "Memory Util: ";
-                printColored(std::to_string(memory_util), YELLOW);
-                printColored("%\n", BLUE);
-                printColored("==================================================\n", BLUE);
-                std::cout << "Running processes ";
-                printColored("and", BLUE);
-                std::cout << " memory usage:\n";
-                printColored("--------------------------------------------------\n", BLUE);
+                printColored("--------------------------------------------------\n", BLUE, *console);
+                printColored("|", BLUE, *console);  
+                *console << " PROCESS-SMI V01";
+                printColored(".00 ", YELLOW, *console);
+                *console << "Driver Version: ";
+                printColored("01.00 ", YELLOW, *console);
+                printColored("|\n", BLUE, *console);
+                printColored("--------------------------------------------------\n", BLUE, *console);
+                *console << "CPU utilization: ";
+                printColored(std::to_string(cpu_util), YELLOW, *console);
+                printColored("%\n", BLUE, *console);
+                *console << "Memory Usage: ";
+                // printColored(std::to_string(memory_usage/1024), YELLOW, *console); // convert KB to MiB
+                // printColored("MiB ", YELLOW, *console);
+                printColored(std::to_string(memory_usage), YELLOW, *console);
+                printColored("KB ", YELLOW, *console);
+                printColored("/ ", BLUE, *console);
+                // printColored(std::to_string(memAdd/1024), YELLOW, *console); // convert KB to MiB
+                // printColored("MiB\n", YELLOW, *console);
+                printColored(std::to_string(memAdd), YELLOW, *console); 
+                printColored("KB\n", YELLOW, *console);
+                *console << "Memory Util: ";
+                printColored(std::to_string(memory_util), YELLOW, *console);
+                printColored("%\n", BLUE, *console);
+                printColored("==================================================\n", BLUE, *console);
+                *console << "Running processes ";
+                printColored("and", BLUE, *console);
+                *console << " memory usage:\n";
+                printColored("--------------------------------------------------\n", BLUE, *console);
 
                 // processHistory
-                processHistory["Main"].emplace_back("--------------------------------------------------\n", "BLUE");
-                processHistory["Main"].emplace_back("|", "BLUE");
-                processHistory["Main"].emplace_back(" PROCESS-SMI V01", "RESET");
-                processHistory["Main"].emplace_back(".00 ", "YELLOW");
-                processHistory["Main"].emplace_back("Driver Version: ", "RESET");
-                processHistory["Main"].emplace_back("01.00 ", "YELLOW");
-                processHistory["Main"].emplace_back("|\n", "BLUE");
-                processHistory["Main"].emplace_back("--------------------------------------------------\n", "BLUE");
-                processHistory["Main"].emplace_back("CPU utilization: ", "RESET");
-                processHistory["Main"].emplace_back(std::to_string(cpu_util), "YELLOW");
-                processHistory["Main"].emplace_back("%\n", "BLUE");
-                processHistory["Main"].emplace_back("Memory Usage: ", "RESET");
-                processHistory["Main"].emplace_back(std::to_string(memory_usage), "YELLOW");
-                // processHistory["Main"].emplace_back("MiB ", "YELLOW");
-                processHistory["Main"].emplace_back("KB ", "YELLOW");
-                processHistory["Main"].emplace_back("/ ", "BLUE");
-                processHistory["Main"].emplace_back(std::to_string(memAdd), "YELLOW");
-                // processHistory["Main"].emplace_back("MiB\n", "YELLOW");
-                processHistory["Main"].emplace_back("KB\n", "YELLOW");
-                processHistory["Main"].emplace_back("Memory Util: ", "RESET");
-                processHistory["Main"].emplace_back(std::to_string(memory_util), "YELLOW");
-                processHistory["Main"].emplace_back("%\n", "BLUE");
-                processHistory["Main"].emplace_back("==================================================\n", "BLUE");
-                processHistory["Main"].emplace_back("Running processes ", "RESET");
-                processHistory["Main"].emplace_back("and", "BLUE");
-                processHistory["Main"].emplace_back(" memory usage:\n", "RESET");
-                processHistory["Main"].emplace_back("--------------------------------------------------\n", "BLUE");
+                history("Main").add("--------------------------------------------------\n", BLUE);
+                history("Main").add("|", BLUE);
+                history("Main").add(" PROCESS-SMI V01", RESET);
+                history("Main").add(".00 ", YELLOW);
+                history("Main").add("Driver Version: ", RESET);
+                history("Main").add("01.00 ", YELLOW);
+                history("Main").add("|\n", BLUE);
+                history("Main").add("--------------------------------------------------\n", BLUE);
+                history("Main").add("CPU utilization: ", RESET);
+                history("Main").add(std::to_string(cpu_util), YELLOW);
+                history("Main").add("%\n", BLUE);
+                history("Main").add("Memory Usage: ", RESET);
+                history("Main").add(std::to_string(memory_usage), YELLOW);
+                // history("Main").add("MiB ", YELLOW);
+                history("Main").add("KB ", YELLOW);
+                history("Main").add("/ ", BLUE);
+                history("Main").add(std::to_string(memAdd), YELLOW);
+                // history("Main").add("MiB\n", YELLOW);
+                history("Main").add("KB\n", YELLOW);
+                history("Main").add("Memory Util: ", RESET);
+                history("Main").add(std::to_string(memory_util), YELLOW);
+                history("Main").add("%\n", BLUE);
+                history("Main").add("==================================================\n", BLUE);
+                history("Main").add("Running processes ", RESET);
+                history("Main").add("and", BLUE);
+                history("Main").add(" memory usage:\n", RESET);
+                history("Main").add("--------------------------------------------------\n", BLUE);
                 
 
-                for (auto memoryRegion = stats.processMemoryRegions.rbegin(); memoryRegion != stats.processMemoryRegions.rend(); ++memoryRegion) {
+                std::vector<ProcessMemory> regions = memory->getMemoryRegions();
+                for (auto memoryRegion = regions.rbegin(); memoryRegion != regions.rend(); ++memoryRegion) {
                     int total_memory = (memoryRegion->endAddress - memoryRegion->startAddress)+1;
-                    std::cout << memoryRegion->process_name << " ";
-                    printColored(std::to_string(total_memory), YELLOW);
-                    printColored("KB\n", YELLOW);
+                    *console << memory->getOwnerName(memoryRegion->pid) << " ";
+                    printColored(std::to_string(total_memory), YELLOW, *console);
+                    printColored("KB\n", YELLOW, *console);
 
                     // processHistory
-                    processHistory["Main"].emplace_back(std::to_string(total_memory), "YELLOW");
-                    processHistory["Main"].emplace_back("KB\n", "YELLOW");     
+                    history("Main").add(std::to_string(total_memory), YELLOW);
+                    history("Main").add("KB\n", YELLOW);     
+                }
+                printColored("--------------------------------------------------\n\n", BLUE, *console);
+                history("Main").add("--------------------------------------------------\n\n", BLUE);
+            }
+            else if (command == "log") {
+                history("Main").add("Enter a command: "+ input +"\n", RESET);
+                cmd_log(tokens);
+            }
+            else if (command == "checkpoint" || command == "restore") {
+                history("Main").add("Enter a command: "+ input +"\n", RESET);
+                if(!isInitialized) {
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
+                    return;
+                }
+
+                if (command == "checkpoint") {
+                    cmd_checkpoint(tokens);
+                } else {
+                    cmd_restore(tokens);
+                }
+            }
+            else if (command == "purge") {
+                history("Main").add("Enter a command: "+ input +"\n", RESET);
+                if(!isInitialized) {
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
+                    return;
+                }
+                cmd_purge(tokens);
+            }
+            else if (command == "trace") {
+                history("Main").add("Enter a command: "+ input +"\n", RESET);
+                if(!isInitialized) {
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
+                    return;
+                }
+                cmd_trace(tokens);
+            }
+            else if (command == "stats") {
+                history("Main").add("Enter a command: "+ input +"\n", RESET);
+                if(!isInitialized) {
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
+                    return;
+                }
+                cmd_stats(tokens);
+            }
+            else if (command == "perf") {
+                history("Main").add("Enter a command: "+ input +"\n", RESET);
+                if(!isInitialized) {
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
+                    return;
                 }
-                printColored("--------------------------------------------------\n\n", BLUE);
-                processHistory["Main"].emplace_back("--------------------------------------------------\n\n", "BLUE");
+                cmd_perf(tokens);
+            }
+            else if (command == "workload") {
+                history("Main").add("Enter a command: "+ input +"\n", RESET);
+                if(!isInitialized) {
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
+                    return;
+                }
+                cmd_workload(tokens);
+            }
+            else if (command == "tick-rate") {
+                history("Main").add("Enter a command: "+ input +"\n", RESET);
+                if(!isInitialized) {
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
+                    return;
+                }
+                cmd_tick_rate(tokens);
             }
             else if (command == "vmstat"){
-                processHistory["Main"].emplace_back("Enter a command: vmstat\n", "RESET");
+                history("Main").add("Enter a command: vmstat\n", RESET);
                 if(!isInitialized) {
-                    std::cout << "Error! System not initialized.\n";
-                    processHistory["Main"].emplace_back("Error! System not initialized.\n", "RESET");
+                    *console << "Error! System not initialized.\n";
+                    history("Main").add("Error! System not initialized.\n", RESET);
                     return;
                 }
 
                 MemoryStats stats = memory->getMemoryStats();
-                int memory_usage = 0;
-                for (auto memoryRegion = stats.processMemoryRegions.rbegin(); memoryRegion != stats.processMemoryRegions.rend(); ++memoryRegion) {
-                    int mem_usage = (memoryRegion->endAddress - memoryRegion->startAddress)+1;
-                    memory_usage += mem_usage;
-                }
+                int memory_usage = stats.usedMemory;
                 int free_memory = memAdd - memory_usage;
+                SchedulerMetrics schedulerMetrics = scheduler.getMetrics();
 
                 TickData totalTickData = { 0, 0, 0 };
                 TickData temp;
@@ -703,20 +1685,38 @@ class System
                     totalTickData.idle += temp.idle;
                 }
                 
-                printf("%13d %s\n", memAdd, "K total memory");
-                printf("%13d %s\n", memory_usage, "K used memory");
-                printf("%13d %s\n", free_memory, "K free memory");
-                printf("%13lld %s\n", totalTickData.idle, "idle cpu ticks");
-                printf("%13lld %s\n", totalTickData.active, "active cpu ticks");
-                printf("%13lld %s\n", totalTickData.total, "total cpu ticks");
-                printf("%13llu %s\n", stats.pagedInCount, "num paged in");
-                printf("%13llu %s\n\n", stats.pagedOutCount, "num paged out");
-                printColored("--------------------------------------------------\n", BLUE);
+                BufferedWriter out(console, true);
+                out.writef("%13d %s\n", memAdd, "K total memory");
+                out.writef("%13d %s\n", memory_usage, "K used memory");
+                out.writef("%13d %s\n", free_memory, "K free memory");
+                out.writef("%13lld %s\n", totalTickData.idle, "idle cpu ticks");
+                out.writef("%13lld %s\n", totalTickData.active, "active cpu ticks");
+                out.writef("%13lld %s\n", totalTickData.total, "total cpu ticks");
+                out.writef("%13lld %s\n", schedulerMetrics.sleeping, "sleeping processes");
+
+                IoStats ioStats = io.getStats();
+                for (int i = 0; i < IO_DEVICE_COUNT; i++) {
+                    const IoDeviceStats& device = ioStats.devices[i];
+                    double utilization = ioStats.ticks > 0 ? 100.0 * device.busyTicks / ioStats.ticks : 0;
+                    out.writef("%13lld %s busy ticks (%.1f%%), %lld queued\n", device.busyTicks, IO_DEVICE_NAMES[i], utilization, device.queueLength);
+                }
+                out.writef("%13lld %s\n", schedulerMetrics.overlapTicks, "cpu-io overlap ticks");
+                out.writef("%13llu %s\n", stats.pagedInCount, "num paged in");
+                out.writef("%13llu %s\n", stats.pagedOutCount, "num paged out");
+                out.writef("%13llu %s\n", stats.swappedOutBytes, "K swapped out");
+                out.writef("%13llu %s\n", stats.compactedBytes, "K moved by compaction");
+                out.writef("%13llu %s\n", stats.swapAvoidedBytes, "K of swap avoided by compaction");
+                out.writef("%13.2f %s\n", stats.allocations > 0 ? (double) stats.framesAllocated / stats.allocations : 0.0, "frames per allocation");
+                out.writef("%13llu %s\n", stats.hugeFramesInUse, "huge frames in use");
+                out.writef("%13llu %s\n", stats.hugePromotions, "huge frame promotions");
+                out.writef("%13llu %s\n", stats.hugeDemotions, "huge frame demotions");
+                out.writef("%13llu %s\n\n", stats.hugeFallbacks, "huge frame fallbacks");
+                out.write("--------------------------------------------------\n", BLUE);
             }
             else {
-                processHistory["Main"].emplace_back("Enter a command: "+ input +"\n", "RESET");
-                std::cout << "Error! Unrecognized command\n";
-                processHistory["Main"].emplace_back("Error! Unrecognized command\n", "RESET");
+                history("Main").add("Enter a command: "+ input +"\n", RESET);
+                *console << "Error! Unrecognized command\n";
+                history("Main").add("Error! Unrecognized command\n", RESET);
             }
         }
 };
\ No newline at end of file
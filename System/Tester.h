@@ -1,11 +1,14 @@
 #pragma once
 #include "../DataTypes/Process.h"
+#include "../DataTypes/ProcessTable.h"
 #include "Core.h"
 #include "Scheduler.h"
+#include "Workload.h"
+#include "Arrivals.h"
+#include "ProgramGenerator.h"
 #include <thread>
 #include <atomic>
 #include <vector>
-#include <cmath>
 
 class Tester 
 {
@@ -17,8 +20,7 @@ class Tester
         long long testerClock;
         std::atomic<long long>* currentSystemClock;
         long long* processFreq;
-        long long processFreqCounter;
-        std::map<std::string, std::shared_ptr<Process>>* processes;
+        ProcessTable* processes;
         long long processIdCounter;
         long long* processMinIns;
         long long* processMaxIns;
@@ -28,9 +30,89 @@ class Tester
         std::string (*getCurrentTimestamp)();
         Scheduler* scheduler;
         AbstractMemoryInterface* memory;
+        Xoshiro256 rng;
+        ArrivalModel arrivals;
+        InstructionMix mix;
+        long long programVariants;
+        ProgramCache* programCache;
+        std::vector<Process*> batch;
+        WorkloadReader* replay;     // Replaces the random generator when set
+        long long startTick;
+        long long replayed;
+        long long replaySkipped;    // Arrivals whose name was already taken
+
+        // Admits every arrival recorded at or before the current tick of the replay
+        void admitReplayed() {
+            long long elapsed = testerClock - startTick;
+            const WorkloadArrival* arrival = replay->peek();
+
+            if (arrival == nullptr || arrival->tick > elapsed) {
+                return;
+            }
+
+            while(locked.load()) {}
+            locked.store(true);
+
+            ProgramGenerator generator(rng, mix, programVariants, programCache);
+            for (; arrival != nullptr && arrival->tick <= elapsed; arrival = replay->peek()) {
+                Process* newProcess = processes->create(arrival->name, arrival->instructions, getCurrentTimestamp(), arrival->memory);
+
+                if (newProcess != nullptr) {
+                    newProcess->priority = arrival->priority;
+                    if (mix != MIX_PLAIN) {
+                        newProcess->load(generator.generate(arrival->instructions, arrival->memory));
+                    }
+                    scheduler->admit(newProcess);
+                    replayed++;
+                } else {
+                    replaySkipped++;
+                }
+
+                replay->advance();
+            }
+
+            locked.store(false);
+        }
+
+        // Creates count random processes and enqueues them together
+        void admitGenerated(long long count) {
+            while(locked.load()) {}
+            locked.store(true); // Lock during write
+
+            std::string timestamp = getCurrentTimestamp();
+            ProgramGenerator generator(rng, mix, programVariants, programCache);
+            batch.clear();
+            for (long long i = 0; i < count; i++) {
+                // Check if the process already exists
+                std::string process_name = "Process" + std::to_string(processIdCounter);
+                while (processes->contains(process_name)) {
+                    processIdCounter++;
+                    process_name = "Process" + std::to_string(processIdCounter);
+                }
+
+                long long instructions = drawInstructions(rng, *processMinIns, *processMaxIns);
+                long long memoryPerProcess = drawMemorySize(rng, *processMinMem, *processMaxMem);
+                Process* newProcess = processes->create(process_name, instructions, timestamp, memoryPerProcess);
+
+                //nullptr only when the table is full
+                if (newProcess == nullptr) {
+                    break;
+                }
+                if (mix != MIX_PLAIN) {
+                    newProcess->load(generator.generate(instructions, memoryPerProcess));
+                }
+                batch.push_back(newProcess);
+            }
+
+            if (!batch.empty()) {
+                scheduler->admit(batch);
+            }
+
+            locked.store(false); //Unlock after write
+        }
 
     public:    
-        Tester(std::atomic<long long>* currentSystemClock, long long* processFreq, std::map<std::string, std::shared_ptr<Process>>* processes, long long *processMinIns, long long *processMaxIns, std::string (*getCurrentTimestamp)(), Scheduler* scheduler, long long* processMinMem, long long* processMaxMem) {
+        Tester(std::atomic<long long>* currentSystemClock, long long* processFreq, ProcessTable* processes, long long *processMinIns, long long *processMaxIns, std::string (*getCurrentTimestamp)(), Scheduler* scheduler, long long* processMinMem, long long* processMaxMem) {
             this->currentSystemClock = currentSystemClock;
             this->testerClock = 0;
             this->active.store(false);
@@ -45,13 +127,21 @@ class Tester
             this->processMaxMem = processMaxMem;
             this->getCurrentTimestamp = getCurrentTimestamp;
             this->scheduler = scheduler;
+            this->mix = MIX_MIXED;
+            this->programVariants = 0;
+            this->programCache = nullptr;
+            this->replay = nullptr;
+            this->startTick = 0;
+            this->replayed = 0;
+            this->replaySkipped = 0;
         }
 
         void start() {
             this->active.store(true);
             this->canProceed.store(false);
             testerClock = currentSystemClock->load();
-            this->processFreqCounter = *processFreq;
+            this->startTick = testerClock;
+            arrivals.reset();
             t = std::thread(run, this);
         }
 
@@ -59,37 +149,17 @@ class Tester
             while(active.load()) {
                 while ((!canProceed.load() || currentSystemClock->load() == testerClock) && active.load()) {}
 
-                if (processFreqCounter == *processFreq) { 
-                    processFreqCounter = 0;
-                    
-                    while(locked.load()) {}
-                    locked.store(true); // Lock during write
-
-                    // Check if the process already exists
-                    std::string process_name = "Process" + std::to_string(processIdCounter);
-                    for (const auto& process : *processes) {
-                        if (process.first == process_name) {
-                            processIdCounter++;
-                            process_name = "Process" + std::to_string(processIdCounter);
-                        }
+                if (replay != nullptr) {
+                    admitReplayed();
+                } else {
+                    long long count = arrivals.arrivalsAt(testerClock - startTick, rng);
+
+                    if (count > 0) {
+                        admitGenerated(count);
                     }
-                    // Set random number of instructions
-                    long long instructions = *processMinIns + (rand() % (*processMaxIns - *processMinIns + 1));
-                    // Set random memory per process
-                    long long memoryPerProcess = static_cast<long long>(pow(2, static_cast<int>(log2(*processMinMem)) + 
-                                                                rand() % (static_cast<int>(log2(*processMaxMem) - log2(*processMinMem) + 1))));
-                    // Create new Process
-                    std::shared_ptr<Process> newProcess = std::make_shared<Process>(process_name, instructions, getCurrentTimestamp(), memoryPerProcess);
-                    processes->insert(std::make_pair(process_name, newProcess));
-                
-                    //Add to scheduler
-                    scheduler->enqueue(newProcess.get());
-
-                    locked.store(false); //Unlock after write
                 }
 
                 testerClock = (testerClock + 1) % LLONG_MAX;
-                processFreqCounter++;      
                 clearCanProceed(); //Reset can proceed for next cycle
             }
         }
@@ -98,6 +168,48 @@ class Tester
             this->memory = memory;
         }
 
+        // Only while the tester is stopped
+        void setArrivals(const ArrivalSettings& settings, uint64_t seed) {
+            arrivals.configure(settings, *processFreq);
+            rng.seed(seed);
+        }
+
+        // Only while the tester is stopped
+        void setInstructionMix(InstructionMix mix, long long programVariants, ProgramCache* programCache) {
+            this->mix = mix;
+            this->programVariants = programVariants;
+            this->programCache = programCache;
+        }
+
+        std::string describeArrivals() {
+            return arrivals.describe();
+        }
+
+        // Only while the tester is stopped, nullptr goes back to random generation
+        void setReplay(WorkloadReader* replay) {
+            this->replay = replay;
+            this->replayed = 0;
+            this->replaySkipped = 0;
+        }
+
+        // Next number tried for a generated process name
+        long long getProcessCounter() {
+            return processIdCounter;
+        }
+
+        // Only while the tester is stopped
+        void setProcessCounter(long long processIdCounter) {
+            this->processIdCounter = processIdCounter;
+        }
+
+        long long getReplayed() {
+            return replayed;
+        }
+
+        long long getReplaySkipped() {
+            return replaySkipped;
+        }
+
         long long getTime() {
             return testerClock;
         }
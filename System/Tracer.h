@@ -0,0 +1,231 @@
+/*
+    This file defines the binary event tracer for scheduler and memory events
+*/
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstring>
+#include "../DataTypes/TraceRecord.h"
+#include "../DataTypes/MappedFile.h"
+
+class Tracer {
+    private:
+        static const size_t BUFFER_RECORDS = 4096;
+        static const uint64_t INITIAL_FILE_RECORDS = 1 << 16;
+
+        struct ThreadBuffer {
+            std::atomic_flag busy = ATOMIC_FLAG_INIT; // Only contended while the trace is being stopped
+            size_t count = 0;
+            TraceRecord records[BUFFER_RECORDS];
+        };
+
+        // Each thread caches the buffer it registered with the last tracer it recorded into, and hands it
+        // back when it exits or moves on to another tracer
+        struct ThreadCache {
+            unsigned long long tracerId = 0;
+            ThreadBuffer* buffer = nullptr;
+
+            ~ThreadCache();
+        };
+
+        static std::atomic<unsigned long long> lastTracerId;
+        static thread_local ThreadCache cache;
+        static std::mutex registryMutex;                    // Taken before any tracer's mtx
+        static std::map<unsigned long long, Tracer*> registry; // Live tracers by id
+
+        unsigned long long tracerId;
+        std::atomic<bool> enabled;
+        std::atomic<long long>* currentSystemClock;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers; // Kept for the tracer's lifetime and reused across traces
+        std::vector<ThreadBuffer*> idle;    // Buffers of threads that exited, records still in them are flushed by stop
+        std::mutex mtx; // Guards buffers and the mapped file, always taken after a buffer's busy flag
+        MappedFile file;
+        uint64_t recordCount;
+        TraceHeader header;
+        std::string path;
+
+        // Gives a buffer back to the tracer it came from, if that tracer is still alive
+        static void releaseBuffer(unsigned long long id, ThreadBuffer* buffer) {
+            std::lock_guard<std::mutex> registryLock(registryMutex);
+            auto it = registry.find(id);
+
+            if(buffer != nullptr && it != registry.end()) {
+                std::lock_guard<std::mutex> lock(it->second->mtx);
+                it->second->idle.push_back(buffer);
+            }
+        }
+
+        ThreadBuffer* getThreadBuffer() {
+            if(cache.tracerId != tracerId) {
+                releaseBuffer(cache.tracerId, cache.buffer);
+                std::lock_guard<std::mutex> lock(mtx);
+
+                if(idle.empty()) {
+                    buffers.push_back(std::make_unique<ThreadBuffer>());
+                    idle.push_back(buffers.back().get());
+                }
+
+                cache.tracerId = tracerId;
+                cache.buffer = idle.back();
+                idle.pop_back();
+            }
+
+            return cache.buffer;
+        }
+
+        // Caller must hold mtx
+        void flushBuffer(ThreadBuffer* buffer) {
+            if(buffer->count == 0 || !file.isOpen()) {
+                buffer->count = 0;
+                return;
+            }
+
+            uint64_t needed = sizeof(TraceHeader) + (recordCount + buffer->count) * sizeof(TraceRecord);
+
+            if(needed > file.size()) {
+                uint64_t newSize = file.size() * 2;
+
+                while(newSize < needed) {
+                    newSize *= 2;
+                }
+
+                if(!file.resize(newSize)) {
+                    buffer->count = 0;
+                    return;
+                }
+            }
+
+            memcpy(file.data() + sizeof(TraceHeader) + recordCount * sizeof(TraceRecord), buffer->records, buffer->count * sizeof(TraceRecord));
+            recordCount += buffer->count;
+            buffer->count = 0;
+        }
+
+    public:
+        Tracer() {
+            tracerId = ++lastTracerId;
+            enabled.store(false);
+            currentSystemClock = nullptr;
+            recordCount = 0;
+
+            std::lock_guard<std::mutex> registryLock(registryMutex);
+            registry.insert({tracerId, this});
+        }
+
+        ~Tracer() {
+            std::unique_lock<std::mutex> registryLock(registryMutex);
+            registry.erase(tracerId);
+            registryLock.unlock();
+
+            stop();
+        }
+
+        void setSyncClock(std::atomic<long long>* currentSystemClock) {
+            this->currentSystemClock = currentSystemClock;
+        }
+
+        bool start(const std::string& path, uint32_t numCores, uint64_t memorySize, uint64_t frameSize) {
+            stop();
+            std::lock_guard<std::mutex> lock(mtx);
+
+            if(!file.create(path, sizeof(TraceHeader) + INITIAL_FILE_RECORDS * sizeof(TraceRecord))) {
+                file.close();
+                return false;
+            }
+
+            memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+            header.version = TRACE_VERSION;
+            header.numCores = numCores;
+            header.memorySize = memorySize;
+            header.frameSize = frameSize;
+            header.recordCount = 0;
+            recordCount = 0;
+            this->path = path;
+
+            enabled.store(true, std::memory_order_release);
+            return true;
+        }
+
+        void stop() {
+            if(!enabled.exchange(false)) {
+                return;
+            }
+
+            std::vector<ThreadBuffer*> registered;
+            std::unique_lock<std::mutex> lock(mtx);
+            for(auto& buffer: buffers) {
+                registered.push_back(buffer.get());
+            }
+            lock.unlock();
+
+            for(auto& buffer: registered) {
+                while(buffer->busy.test_and_set(std::memory_order_acquire)) {} // Wait out an in-flight record
+                lock.lock();
+                flushBuffer(buffer);
+                lock.unlock();
+                buffer->busy.clear(std::memory_order_release);
+            }
+
+            lock.lock();
+            header.recordCount = recordCount;
+            if(file.resize(sizeof(TraceHeader) + recordCount * sizeof(TraceRecord))) {
+                memcpy(file.data(), &header, sizeof(TraceHeader));
+            }
+            file.close();
+            lock.unlock();
+        }
+
+        void record(TraceEvent event, int core, int pid, uint64_t arg) {
+            if(!enabled.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            ThreadBuffer* buffer = getThreadBuffer();
+
+            if(buffer->busy.test_and_set(std::memory_order_acquire)) {
+                return; // The trace is being stopped
+            }
+
+            if(enabled.load(std::memory_order_relaxed)) {
+                TraceRecord& r = buffer->records[buffer->count++];
+                r.tick = currentSystemClock == nullptr ? 0 : currentSystemClock->load(std::memory_order_relaxed);
+                r.arg = arg;
+                r.pid = pid;
+                r.core = (int16_t) core;
+                r.event = event;
+                r.reserved = 0;
+
+                if(buffer->count == BUFFER_RECORDS) {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    flushBuffer(buffer);
+                }
+            }
+
+            buffer->busy.clear(std::memory_order_release);
+        }
+
+        bool isEnabled() {
+            return enabled.load();
+        }
+
+        std::string getPath() {
+            return path;
+        }
+
+        uint64_t getRecordCount() {
+            std::lock_guard<std::mutex> lock(mtx);
+            return recordCount;
+        }
+};
+
+std::atomic<unsigned long long> Tracer::lastTracerId(0);
+thread_local Tracer::ThreadCache Tracer::cache;
+std::mutex Tracer::registryMutex;
+std::map<unsigned long long, Tracer*> Tracer::registry;
+
+Tracer::ThreadCache::~ThreadCache() {
+    Tracer::releaseBuffer(tracerId, buffer);
+}
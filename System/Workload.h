@@ -0,0 +1,304 @@
+/*
+    This file defines workload replay, which streams recorded arrivals into the scheduler, and the recorder
+    that writes the arrivals of a live run in the same formats
+*/
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <atomic>
+#include "../DataTypes/WorkloadRecord.h"
+#include "../DataTypes/MappedFile.h"
+#include "../DataTypes/Process.h"
+
+struct WorkloadArrival {
+    long long tick;
+    std::string name;
+    long long instructions;
+    long long memory;
+    int priority;
+};
+
+// Files ending in .csv hold "tick,name,instructions,memory[,priority]" lines, anything else is binary
+inline bool isCsvWorkload(const std::string& path) {
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+}
+
+// Reads one arrival at a time, binary files through a read only mapping and CSV files line by line,
+// so memory use does not depend on the size of the trace
+class WorkloadReader {
+    private:
+        MappedFile binary;
+        std::ifstream csv;
+        bool isCsv = false;
+        bool isOpen = false;
+        uint64_t recordCount = 0;
+        uint64_t nextRecord = 0;
+        long long line = 0;
+        WorkloadArrival pending;
+        bool hasPending = false;
+        std::string error;
+        std::string path;
+
+        bool fail(const std::string& message) {
+            error = message;
+            hasPending = false;
+            return false;
+        }
+
+        bool readBinary() {
+            if(nextRecord == recordCount) {
+                return false;
+            }
+
+            const WorkloadRecord* r = (const WorkloadRecord*) (binary.data() + sizeof(WorkloadHeader)) + nextRecord++;
+            pending.tick = (long long) r->tick;
+            pending.name.assign(r->name, strnlen(r->name, WORKLOAD_NAME_SIZE));
+            pending.instructions = (long long) r->instructions;
+            pending.memory = (long long) r->memory;
+            pending.priority = r->priority;
+            return true;
+        }
+
+        bool readCsv() {
+            std::string text;
+
+            while(std::getline(csv, text)) {
+                line++;
+
+                if(!text.empty() && text.back() == '\r') {
+                    text.pop_back();
+                }
+
+                if(text.empty() || text[0] == '#' || (line == 1 && text.compare(0, 4, "tick") == 0)) {
+                    continue;
+                }
+
+                std::vector<std::string> fields;
+                size_t start = 0;
+                for(size_t comma = text.find(','); ; comma = text.find(',', start)) {
+                    fields.push_back(text.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+
+                    if(comma == std::string::npos) {
+                        break;
+                    }
+                    start = comma + 1;
+                }
+
+                if(fields.size() < 4 || fields.size() > 5 || fields[1].empty()) {
+                    return fail("line " + std::to_string(line) + " does not have 4 or 5 fields");
+                }
+
+                long long values[4] = { 0, 0, 0, 0 };
+                const int numeric[4] = { 0, 2, 3, 4 };
+                for(int i = 0; i < 4 && numeric[i] < (int) fields.size(); i++) {
+                    char* end;
+                    values[i] = std::strtoll(fields[numeric[i]].c_str(), &end, 10);
+
+                    if(*end != '\0' || end == fields[numeric[i]].c_str()) {
+                        return fail("line " + std::to_string(line) + " has a field that is not a number");
+                    }
+                }
+
+                pending.tick = values[0];
+                pending.name = fields[1];
+                pending.instructions = values[1];
+                pending.memory = values[2];
+                pending.priority = (int) values[3];
+                return true;
+            }
+
+            return false;
+        }
+
+        void readNext() {
+            hasPending = isCsv ? readCsv() : readBinary();
+
+            if(hasPending && (pending.tick < 0 || pending.instructions < 1 || pending.memory < 1)) {
+                fail("arrival " + pending.name + " has a negative tick or no instructions or memory");
+            }
+        }
+
+    public:
+        bool open(const std::string& path) {
+            close();
+            this->path = path;
+            isCsv = isCsvWorkload(path);
+
+            if(isCsv) {
+                csv.open(path);
+
+                if(!csv.is_open()) {
+                    return fail("could not open " + path);
+                }
+            } else {
+                if(!binary.openRead(path)) {
+                    return fail("could not open " + path);
+                }
+
+                if(binary.size() < sizeof(WorkloadHeader) || memcmp(binary.data(), WORKLOAD_MAGIC, sizeof(WORKLOAD_MAGIC)) != 0 ||
+                   ((const WorkloadHeader*) binary.data())->version != WORKLOAD_VERSION) {
+                    binary.close();
+                    return fail(path + " is not a workload file");
+                }
+
+                recordCount = (binary.size() - sizeof(WorkloadHeader)) / sizeof(WorkloadRecord);
+            }
+
+            isOpen = true;
+            readNext();
+            return error.empty();
+        }
+
+        void close() {
+            binary.close();
+            if(csv.is_open()) {
+                csv.close();
+            }
+            csv.clear();
+            isOpen = false;
+            hasPending = false;
+            recordCount = 0;
+            nextRecord = 0;
+            line = 0;
+            error = "";
+        }
+
+        // Starts over from the first arrival
+        bool rewind() {
+            return open(path);
+        }
+
+        // The next arrival, nullptr once the trace is exhausted or unreadable
+        const WorkloadArrival* peek() {
+            return hasPending ? &pending : nullptr;
+        }
+
+        void advance() {
+            if(hasPending) {
+                readNext();
+            }
+        }
+
+        bool isLoaded() {
+            return isOpen;
+        }
+
+        std::string getError() {
+            return error;
+        }
+
+        std::string getPath() {
+            return path;
+        }
+};
+
+// Appends every admitted process as an arrival, ticks counted from the start of the recording
+class WorkloadRecorder {
+    private:
+        FILE* f = nullptr;
+        bool isCsv = false;
+        long long startTick = 0;
+        uint64_t recordCount = 0;
+        std::atomic<bool> enabled;
+        std::mutex mtx;
+        std::string path;
+
+    public:
+        WorkloadRecorder() {
+            enabled.store(false);
+        }
+
+        ~WorkloadRecorder() {
+            stop();
+        }
+
+        bool start(const std::string& path, long long startTick) {
+            stop();
+            std::lock_guard<std::mutex> lock(mtx);
+            isCsv = isCsvWorkload(path);
+            f = fopen(path.c_str(), isCsv ? "w" : "wb");
+
+            if(f == nullptr) {
+                return false;
+            }
+
+            if(isCsv) {
+                fprintf(f, "tick,name,instructions,memory,priority\n");
+            } else {
+                WorkloadHeader header = {};
+                memcpy(header.magic, WORKLOAD_MAGIC, sizeof(header.magic));
+                header.version = WORKLOAD_VERSION;
+                fwrite(&header, sizeof(header), 1, f);
+            }
+
+            this->path = path;
+            this->startTick = startTick;
+            recordCount = 0;
+            enabled.store(true);
+            return true;
+        }
+
+        void stop() {
+            if(!enabled.exchange(false)) {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mtx);
+            if(!isCsv) {
+                fseek(f, offsetof(WorkloadHeader, recordCount), SEEK_SET);
+                fwrite(&recordCount, sizeof(recordCount), 1, f);
+            }
+
+            fclose(f);
+            f = nullptr;
+        }
+
+        void record(const Process& p, long long tick) {
+            if(!enabled.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mtx);
+            if(f == nullptr) {
+                return;
+            }
+
+            long long relative = tick < startTick ? 0 : tick - startTick;
+
+            if(isCsv) {
+                std::string name = p.name;
+                std::replace(name.begin(), name.end(), ',', '_');
+                fprintf(f, "%lld,%s,%lld,%lld,%d\n", relative, name.c_str(), p.total_instructions, p.memoryRequired, p.priority);
+            } else {
+                WorkloadRecord r = {};
+                r.tick = (uint64_t) relative;
+                r.instructions = (uint64_t) p.total_instructions;
+                r.memory = (uint64_t) p.memoryRequired;
+                r.priority = p.priority;
+                strncpy(r.name, p.name.c_str(), WORKLOAD_NAME_SIZE - 1);
+                fwrite(&r, sizeof(r), 1, f);
+            }
+
+            recordCount++;
+        }
+
+        bool isEnabled() {
+            return enabled.load();
+        }
+
+        std::string getPath() {
+            return path;
+        }
+
+        uint64_t getRecordCount() {
+            std::lock_guard<std::mutex> lock(mtx);
+            return recordCount;
+        }
+};
@@ -0,0 +1,270 @@
+/*
+    Compares the per-object core step against the struct-of-arrays kernels, single threaded.
+
+    Usage: CoreKernelBenchmark [ticks] [delays-per-exec] [num-cpu...]
+
+    For each core count it reports nanoseconds per core per tick for:
+        counters    only the per-tick counter updates: the per-object loop through Process*,
+                    then the scalar and AVX2 kernels over the counter arrays
+        full tick   Core::step() against a kernel call followed by Core::finishKernelTick(),
+                    which adds the metric, flag and clock publication every tick
+    Completed processes restart and preempted ones get a new quantum, standing in for the scheduler.
+    Every run checks that all paths end with identical counters. Defaults to 20000 ticks,
+    0 delays per exec and 64, 256 and 1024 cores.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include "../DataTypes/TSQueue.h"
+#include "../DataTypes/SchedAlgo.h"
+#include "../System/Core.h"
+#include "../System/CoreKernel.h"
+
+const long long BENCHMARK_QUANTUM = 5;
+
+// The counters Core kept per object before they moved into CoreStateTable
+struct ObjectCore {
+    Process* process;
+    long long delayCounter;
+    long long quantumCountdown;
+    long long activeTicks;
+    bool active;
+};
+
+struct BenchmarkResult {
+    double nanosPerCoreTick;
+    std::vector<long long> instructions;    // current_instruction of every process at the end
+    std::vector<long long> activeTicks;
+};
+
+std::string benchmarkTimestamp() {
+    return "01/01/2024, 12:00:00 AM";
+}
+
+std::vector<std::unique_ptr<Process>> makeProcesses(int numCores) {
+    std::vector<std::unique_ptr<Process>> processes;
+    srand(1);
+
+    for(int i = 0; i < numCores; i++) {
+        processes.push_back(std::make_unique<Process>("Bench" + std::to_string(i), 100 + rand() % 900, benchmarkTimestamp(), 64));
+    }
+
+    return processes;
+}
+
+void restart(Process* p) {
+    p->current_instruction = 0;
+    p->completed = false;
+}
+
+double nanosPerCoreTick(std::chrono::steady_clock::time_point start, long long ticks, int numCores) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ((double) ticks * numCores);
+}
+
+BenchmarkResult runObjectCounters(int numCores, long long ticks, long long delayPerExec) {
+    std::vector<std::unique_ptr<Process>> processes = makeProcesses(numCores);
+    std::vector<ObjectCore> cores(numCores);
+    BenchmarkResult result;
+
+    for(int i = 0; i < numCores; i++) {
+        cores[i] = { processes[i].get(), 0, BENCHMARK_QUANTUM, 0, true };
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for(long long tick = 0; tick < ticks; tick++) {
+        for(ObjectCore& core: cores) {
+            if(!core.active) {
+                continue;
+            }
+
+            if(core.delayCounter == delayPerExec) {
+                if(core.process->executeLine()) {
+                    restart(core.process);
+                    core.quantumCountdown = BENCHMARK_QUANTUM;
+                } else if(--core.quantumCountdown == 0) {
+                    core.quantumCountdown = BENCHMARK_QUANTUM;
+                }
+
+                core.delayCounter = -1;
+            }
+
+            core.activeTicks++;
+            core.delayCounter++;
+        }
+    }
+    result.nanosPerCoreTick = nanosPerCoreTick(start, ticks, numCores);
+
+    for(int i = 0; i < numCores; i++) {
+        result.instructions.push_back(processes[i]->current_instruction);
+        result.activeTicks.push_back(cores[i].activeTicks);
+    }
+
+    return result;
+}
+
+BenchmarkResult runKernelCounters(int numCores, long long ticks, long long delayPerExec, CoreStepMode mode) {
+    std::vector<std::unique_ptr<Process>> processes = makeProcesses(numCores);
+    CoreStateTable state;
+    CoreStepMasks masks;
+    BenchmarkResult result;
+
+    state.init(numCores);
+    for(int i = 0; i < numCores; i++) {
+        state.remaining[i] = processes[i]->total_instructions;
+        state.quantumCountdown[i] = BENCHMARK_QUANTUM;
+        state.activeMask[i] = -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for(long long tick = 0; tick < ticks; tick++) {
+        stepCoreLanes(mode, state, 0, numCores, delayPerExec, true, masks);
+
+        //Mirror the instruction count into the process, as Core::finishKernelTick does
+        forEachSetBit(masks.executed, [&](int i) {
+            Process* p = processes[i].get();
+            p->current_instruction = p->total_instructions - state.remaining[i];
+        });
+
+        forEachSetBit(masks.completed, [&](int i) {
+            restart(processes[i].get());
+            state.remaining[i] = processes[i]->total_instructions;
+            state.quantumCountdown[i] = BENCHMARK_QUANTUM;
+        });
+
+        forEachSetBit(masks.preempted, [&](int i) {
+            state.quantumCountdown[i] = BENCHMARK_QUANTUM;
+        });
+    }
+    result.nanosPerCoreTick = nanosPerCoreTick(start, ticks, numCores);
+
+    for(int i = 0; i < numCores; i++) {
+        result.instructions.push_back(processes[i]->current_instruction);
+        result.activeTicks.push_back(state.activeTicks[i]);
+    }
+
+    return result;
+}
+
+// Drives real Cores without their threads, handling completion and preemption the way the scheduler would
+BenchmarkResult runCoreTicks(int numCores, long long ticks, long long delayPerExec, CoreStepMode mode) {
+    std::vector<std::unique_ptr<Process>> processes = makeProcesses(numCores);
+    std::atomic<long long> clock(0);
+    CoreControlTable control;
+    CoreStateTable state;
+    TSQueue readyQueue;
+    std::vector<std::unique_ptr<Core>> cores;
+    CoreStepMasks masks;
+    BenchmarkResult result;
+
+    control.init(numCores);
+    state.init(numCores);
+    for(int i = 0; i < numCores; i++) {
+        cores.push_back(std::make_unique<Core>(i, BENCHMARK_QUANTUM, std::addressof(clock), benchmarkTimestamp, RR, delayPerExec, control.at(i), std::addressof(state)));
+        cores[i]->assignReadyQueue(std::addressof(readyQueue));
+        cores[i]->assignProcess(processes[i].get());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for(long long tick = 0; tick < ticks; tick++) {
+        if(mode == CORE_STEP_OBJECT) {
+            for(auto& core: cores) {
+                core->step();
+            }
+        } else {
+            stepCoreLanes(mode, state, 0, numCores, delayPerExec, true, masks);
+
+            for(int i = 0; i < numCores; i++) {
+                cores[i]->finishKernelTick(CoreStepMasks::test(masks.executed, i), CoreStepMasks::test(masks.completed, i), CoreStepMasks::test(masks.preempted, i));
+            }
+
+            uint64_t share = 0;
+            for(auto& core: cores) {
+                core->getExecuteTime()->record(share);
+            }
+        }
+
+        for(int i = 0; i < numCores; i++) {
+            if(cores[i]->getProcessCompleted()) {
+                Process* p = cores[i]->finish();
+                restart(p);
+                cores[i]->assignProcess(p);
+            } else if(cores[i]->getShouldPreempt()) {
+                cores[i]->assignProcess(cores[i]->preempt());
+                readyQueue.pop();
+            }
+        }
+    }
+    result.nanosPerCoreTick = nanosPerCoreTick(start, ticks, numCores);
+
+    for(int i = 0; i < numCores; i++) {
+        result.instructions.push_back(processes[i]->current_instruction);
+        result.activeTicks.push_back(cores[i]->getMetrics().activeTicks);
+    }
+
+    return result;
+}
+
+std::string formatNanos(const BenchmarkResult& result, bool measured) {
+    char buffer[32];
+
+    if(!measured) {
+        return "-";
+    }
+
+    snprintf(buffer, sizeof(buffer), "%.2f", result.nanosPerCoreTick);
+    return buffer;
+}
+
+bool sameCounters(const BenchmarkResult& a, const BenchmarkResult& b) {
+    return a.instructions == b.instructions && a.activeTicks == b.activeTicks;
+}
+
+int main(int argc, char* argv[]) {
+    long long ticks = argc > 1 ? std::atoll(argv[1]) : 20000;
+    long long delayPerExec = argc > 2 ? std::atoll(argv[2]) : 0;
+    std::vector<int> coreCounts;
+
+    for(int i = 3; i < argc; i++) {
+        coreCounts.push_back(std::atoi(argv[i]));
+    }
+
+    if(coreCounts.empty()) {
+        coreCounts = { 64, 256, 1024 };
+    }
+
+    if(ticks <= 0 || delayPerExec < 0) {
+        fprintf(stderr, "Invalid ticks or delays per exec.\n");
+        return 1;
+    }
+
+    bool avx2 = cpuSupportsAvx2();
+    bool allMatch = true;
+
+    printf("%lld ticks, %lld delays per exec, AVX2 %s\n\n", ticks, delayPerExec, avx2 ? "available" : "not available");
+    printf("%8s  %-10s %10s %10s %10s\n", "num-cpu", "ns/core", "object", "scalar", "avx2");
+
+    for(int numCores: coreCounts) {
+        if(numCores < 1) {
+            continue;
+        }
+
+        BenchmarkResult object = runObjectCounters(numCores, ticks, delayPerExec);
+        BenchmarkResult scalar = runKernelCounters(numCores, ticks, delayPerExec, CORE_STEP_SCALAR);
+        BenchmarkResult vector = avx2 ? runKernelCounters(numCores, ticks, delayPerExec, CORE_STEP_AVX2) : scalar;
+        allMatch = allMatch && sameCounters(object, scalar) && sameCounters(object, vector);
+        printf("%8d  %-10s %10.2f %10.2f %10s\n", numCores, "counters", object.nanosPerCoreTick, scalar.nanosPerCoreTick, formatNanos(vector, avx2).c_str());
+
+        object = runCoreTicks(numCores, ticks, delayPerExec, CORE_STEP_OBJECT);
+        scalar = runCoreTicks(numCores, ticks, delayPerExec, CORE_STEP_SCALAR);
+        vector = avx2 ? runCoreTicks(numCores, ticks, delayPerExec, CORE_STEP_AVX2) : scalar;
+        allMatch = allMatch && sameCounters(object, scalar) && sameCounters(object, vector);
+        printf("%8s  %-10s %10.2f %10.2f %10s\n", "", "full tick", object.nanosPerCoreTick, scalar.nanosPerCoreTick, formatNanos(vector, avx2).c_str());
+        fflush(stdout);
+    }
+
+    printf("\n%s\n", allMatch ? "All paths produced identical counters." : "Error! The paths produced different counters.");
+    return allMatch ? 0 : 1;
+}
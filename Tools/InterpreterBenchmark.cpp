@@ -0,0 +1,201 @@
+/*
+    Measures how fast the bytecode interpreter runs generated programs, for each instruction mix.
+
+    Usage: InterpreterBenchmark [cycles per program] [programs] [processes] [min-ins] [max-ins]
+
+    For every mix it generates the programs from one seed and runs each to the end twice:
+        batched     runProgram calls for the whole program, the dispatch loop only leaves the
+                    interpreter at a SLEEP or IO
+        per tick    one Process::executeLine per cycle, as a core runs a program one line per tick
+    and reports millions of cycles per second of host time. The plain row is a process without a
+    program, the counter the cores stepped before programs existed. Both runs must end with the same
+    variables. Defaults to 1000000 cycles and 64 programs.
+
+    It then gives programs to as many processes as scheduler-test would, with instruction counts
+    between min-ins and max-ins and the default memory range, once with a private image per process
+    and once through a ProgramCache with the default variant limit, and reports the host bytes of
+    program per process, the images alone and with the context every process keeps. Defaults to
+    100000 processes of 1000 to 2000 instructions.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include "../DataTypes/Process.h"
+#include "../System/ProgramGenerator.h"
+#include "../System/Arrivals.h"
+
+const long long BENCHMARK_PROCESS_MEMORY = 64;
+const long long BENCHMARK_MIN_MEMORY = 64;
+const long long BENCHMARK_MAX_MEMORY = 256;
+const size_t SHARED_POINTER_BLOCK = 2 * sizeof(long) + sizeof(void*); // Reference counts and deleter, approximate
+const size_t CACHE_ENTRY = sizeof(std::weak_ptr<const Program>) + 4 * sizeof(void*); // Weak reference and map node, approximate
+
+struct SharingResult {
+    size_t images;
+    double imageBytesPerProcess;    // Program images and their bookkeeping
+    double bytesPerProcess;         // Plus what each process keeps to run one, its context and pointer
+    double nanosPerProcess;         // Generating, and interning when shared
+};
+
+struct MixResult {
+    double batched;                 // Millions of cycles per second
+    double perTick;
+    double codeBytes;               // Average per program
+    bool match;
+};
+
+std::string benchmarkTimestamp() {
+    return "01/01/2024, 12:00:00 AM";
+}
+
+double millionsPerSecond(std::chrono::steady_clock::time_point start, long long cycles) {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return cycles / seconds / 1e6;
+}
+
+MixResult runMix(InstructionMix mix, long long cycles, int count) {
+    Xoshiro256 rng(1);
+    ProgramGenerator generator(rng, mix);
+    std::vector<std::shared_ptr<const Program>> programs;
+    std::vector<ProgramContext> batched(count);
+    MixResult result = { 0, 0, 0, true };
+    long long total = 0;
+    int32_t printed;
+
+    for(int i = 0; i < count; i++) {
+        programs.push_back(generator.generate(cycles, BENCHMARK_PROCESS_MEMORY));
+        result.codeBytes += programs.back()->code.size();
+        total += programs.back()->cycles;
+    }
+    result.codeBytes /= count;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < count; i++) {
+        long long ran = 0;
+        batched[i] = {};
+        while(ran < programs[i]->cycles) {
+            ran += runProgram(*programs[i], batched[i], programs[i]->cycles - ran, printed);
+            batched[i].sleepTicks = 0;
+            batched[i].ioUnits = 0;
+        }
+    }
+    result.batched = millionsPerSecond(start, total);
+
+    std::vector<std::unique_ptr<Process>> processes;
+    for(int i = 0; i < count; i++) {
+        processes.push_back(std::make_unique<Process>("Bench" + std::to_string(i), cycles, benchmarkTimestamp(), BENCHMARK_PROCESS_MEMORY));
+        processes.back()->load(programs[i]);
+    }
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < count; i++) {
+        Process* p = processes[i].get();
+        while(!p->executeLine()) {}
+    }
+    result.perTick = millionsPerSecond(start, total);
+
+    for(int i = 0; i < count; i++) {
+        const ProgramContext& a = batched[i];
+        const ProgramContext& b = processes[i]->context;
+        bool same = a.pc == b.pc && a.depth == b.depth && programs[i]->code[a.pc] == OP_HALT;
+
+        for(int v = 0; v < PROGRAM_MAX_VARIABLES; v++) {
+            same = same && a.variables[v] == b.variables[v];
+        }
+
+        result.match = result.match && same;
+    }
+
+    return result;
+}
+
+double runPlain(long long cycles, int count) {
+    std::vector<std::unique_ptr<Process>> processes;
+
+    for(int i = 0; i < count; i++) {
+        processes.push_back(std::make_unique<Process>("Bench" + std::to_string(i), cycles, benchmarkTimestamp(), BENCHMARK_PROCESS_MEMORY));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < count; i++) {
+        Process* p = processes[i].get();
+        while(!p->executeLine()) {}
+    }
+
+    return millionsPerSecond(start, cycles * count);
+}
+
+SharingResult runSharing(long long processes, long long minIns, long long maxIns, bool shared) {
+    Xoshiro256 rng(1);
+    ProgramCache cache;
+    ProgramGenerator generator(rng, MIX_MIXED, shared ? DEFAULT_PROGRAM_VARIANTS : 0, shared ? &cache : nullptr);
+    std::vector<std::shared_ptr<const Program>> held;
+    SharingResult result = { 0, 0, 0, 0 };
+    size_t bytes = 0;
+
+    held.reserve(processes);
+
+    auto start = std::chrono::steady_clock::now();
+    for(long long i = 0; i < processes; i++) {
+        long long instructions = drawInstructions(rng, minIns, maxIns);
+        held.push_back(generator.generate(instructions, drawMemorySize(rng, BENCHMARK_MIN_MEMORY, BENCHMARK_MAX_MEMORY)));
+    }
+    result.nanosPerProcess = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / processes;
+
+    if(shared) {
+        ProgramCacheStats stats = cache.getStats();
+        result.images = stats.images;
+        bytes += stats.bytes + stats.images * (SHARED_POINTER_BLOCK + CACHE_ENTRY);
+    } else {
+        result.images = held.size();
+        for(const std::shared_ptr<const Program>& program: held) {
+            bytes += sizeof(Program) + SHARED_POINTER_BLOCK + program->code.capacity();
+        }
+    }
+
+    result.imageBytesPerProcess = (double) bytes / processes;
+    result.bytesPerProcess = result.imageBytesPerProcess + sizeof(ProgramContext) + sizeof(std::shared_ptr<const Program>);
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    long long cycles = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    int count = argc > 2 ? std::atoi(argv[2]) : 64;
+    long long processes = argc > 3 ? std::atoll(argv[3]) : 100000;
+    long long minIns = argc > 4 ? std::atoll(argv[4]) : 1000;
+    long long maxIns = argc > 5 ? std::atoll(argv[5]) : 2000;
+    bool allMatch = true;
+
+    if(cycles <= 0 || count <= 0 || processes <= 0 || minIns <= 0 || maxIns < minIns) {
+        fprintf(stderr, "Invalid cycles, programs, processes or instruction range.\n");
+        return 1;
+    }
+
+    printf("%d programs of %lld cycles, %s dispatch\n\n", count, cycles, PROGRAM_DISPATCH_NAME);
+    printf("%-12s %12s %14s %14s\n", "mix", "code bytes", "batched Mc/s", "per tick Mc/s");
+    printf("%-12s %12s %14s %14.1f\n", INSTRUCTION_MIX_NAMES[MIX_PLAIN], "-", "-", runPlain(cycles, count));
+
+    for(int mix = MIX_MIXED; mix <= MIX_IO; mix++) {
+        MixResult result = runMix((InstructionMix) mix, cycles, count);
+        allMatch = allMatch && result.match;
+        printf("%-12s %12.0f %14.1f %14.1f\n", INSTRUCTION_MIX_NAMES[mix], result.codeBytes, result.batched, result.perTick);
+        fflush(stdout);
+    }
+
+    printf("\n%lld processes of %lld to %lld instructions, mixed\n\n", processes, minIns, maxIns);
+    printf("%-10s %12s %14s %14s %14s\n", "images", "count", "image B/proc", "total B/proc", "ns/process");
+
+    SharingResult privateImages = runSharing(processes, minIns, maxIns, false);
+    printf("%-10s %12zu %14.1f %14.1f %14.1f\n", "private", privateImages.images, privateImages.imageBytesPerProcess,
+           privateImages.bytesPerProcess, privateImages.nanosPerProcess);
+
+    SharingResult sharedImages = runSharing(processes, minIns, maxIns, true);
+    printf("%-10s %12zu %14.1f %14.1f %14.1f\n", "shared", sharedImages.images, sharedImages.imageBytesPerProcess,
+           sharedImages.bytesPerProcess, sharedImages.nanosPerProcess);
+
+    printf("\n%s\n", allMatch ? "Batched and per tick runs ended in the same state." : "Error! Batched and per tick runs ended in different states.");
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+/*
+    Runs a grid of configurations, each on its own System, and tabulates their results.
+
+    Usage: SweepRunner [--jobs <n>] [--ticks <n>] [--out <directory>] <base config> <key=value,value...>...
+
+    Every combination of the swept values gets a run directory under the output directory (default
+    "sweep") holding its config.txt, Logs and BackingStore. The config is the base config with the
+    swept keys replaced, or appended when they are optional settings the base does not set. Each run
+    initializes, runs scheduler-test until the system clock reaches --ticks (default 10000), stops and
+    reports its metrics. --jobs runs (default 1) execute at once on a pool of threads. The table is
+    printed and also written to results.csv in the output directory.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include "../System/System.h"
+
+struct SweepAxis {
+    std::string key;
+    std::vector<std::string> values;
+};
+
+struct SweepRun {
+    std::vector<std::string> values;    // One per axis
+    bool ok;
+    RunMetrics metrics;
+};
+
+std::vector<std::pair<std::string, std::string>> readConfig(const std::string& path) {
+    std::vector<std::pair<std::string, std::string>> lines;
+    std::ifstream file(path);
+    std::string key;
+    std::string value;
+    std::string line;
+
+    while(std::getline(file, line)) {
+        std::istringstream stream(line);
+
+        if(stream >> key >> value) {
+            lines.push_back({ key, value });
+        }
+    }
+
+    return lines;
+}
+
+bool writeConfig(const std::filesystem::path& path, std::vector<std::pair<std::string, std::string>> lines,
+                 const std::vector<SweepAxis>& axes, const std::vector<std::string>& values) {
+    for(size_t a = 0; a < axes.size(); a++) {
+        bool replaced = false;
+
+        for(auto& line: lines) {
+            if(line.first == axes[a].key) {
+                line.second = values[a];
+                replaced = true;
+            }
+        }
+
+        if(!replaced) {
+            lines.push_back({ axes[a].key, values[a] });
+        }
+    }
+
+    FILE* f = fopen(path.string().c_str(), "w");
+    if(f == nullptr) {
+        return false;
+    }
+
+    for(const auto& line: lines) {
+        fprintf(f, "%s %s\n", line.first.c_str(), line.second.c_str());
+    }
+
+    fclose(f);
+    return true;
+}
+
+void runConfig(SweepRun& run, const std::filesystem::path& directory, long long ticks) {
+    std::ostream quiet(nullptr);
+    std::unique_ptr<System> system = std::make_unique<System>(directory.string(), &quiet);
+
+    system->parseCommand("initialize");
+    run.ok = system->isReady();
+
+    if(!run.ok) {
+        return;
+    }
+
+    system->parseCommand("scheduler-test");
+    while(system->getTick() < ticks) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    system->parseCommand("scheduler-stop");
+
+    run.metrics = system->collectRunMetrics();
+    system->terminate();
+}
+
+int main(int argc, char* argv[]) {
+    int jobs = 1;
+    long long ticks = 10000;
+    std::filesystem::path out = "sweep";
+    int arg = 1;
+
+    while(arg + 1 < argc && std::string(argv[arg]).compare(0, 2, "--") == 0) {
+        std::string option = argv[arg];
+        std::string value = argv[arg + 1];
+
+        if(option == "--jobs") {
+            jobs = std::atoi(value.c_str());
+        } else if(option == "--ticks") {
+            ticks = std::atoll(value.c_str());
+        } else if(option == "--out") {
+            out = value;
+        } else {
+            fprintf(stderr, "Unknown option %s %s.\n", option.c_str(), value.c_str());
+            return 1;
+        }
+
+        arg += 2;
+    }
+
+    if(arg >= argc || jobs < 1 || ticks < 1) {
+        fprintf(stderr, "Usage: SweepRunner [--jobs <n>] [--ticks <n>] [--out <directory>] <base config> <key=value,value...>...\n");
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, std::string>> base = readConfig(argv[arg]);
+    if(base.empty()) {
+        fprintf(stderr, "Could not read %s.\n", argv[arg]);
+        return 1;
+    }
+
+    std::vector<SweepAxis> axes;
+    for(int i = arg + 1; i < argc; i++) {
+        std::string spec = argv[i];
+        size_t equals = spec.find('=');
+
+        if(equals == std::string::npos || equals == 0 || equals + 1 == spec.size()) {
+            fprintf(stderr, "Invalid sweep %s, expected key=value,value...\n", spec.c_str());
+            return 1;
+        }
+
+        SweepAxis axis = { spec.substr(0, equals), {} };
+        std::istringstream values(spec.substr(equals + 1));
+        std::string value;
+
+        while(std::getline(values, value, ',')) {
+            axis.values.push_back(value);
+        }
+
+        axes.push_back(axis);
+    }
+
+    //Every combination, the last axis varies fastest
+    std::vector<SweepRun> runs(1);
+    for(const SweepAxis& axis: axes) {
+        std::vector<SweepRun> expanded;
+
+        for(const SweepRun& run: runs) {
+            for(const std::string& value: axis.values) {
+                expanded.push_back(run);
+                expanded.back().values.push_back(value);
+            }
+        }
+
+        runs = expanded;
+    }
+
+    for(size_t i = 0; i < runs.size(); i++) {
+        std::filesystem::path directory = out / ("run" + std::to_string(i));
+        std::filesystem::create_directories(directory / "Logs");
+
+        if(!writeConfig(directory / "config.txt", base, axes, runs[i].values)) {
+            fprintf(stderr, "Could not write %s.\n", (directory / "config.txt").string().c_str());
+            return 1;
+        }
+    }
+
+    printf("Running %zu configurations, %d at a time, %lld ticks each.\n", runs.size(), jobs, ticks);
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> pool;
+    for(int j = 0; j < jobs; j++) {
+        pool.emplace_back([&]() {
+            for(size_t i = next++; i < runs.size(); i = next++) {
+                runConfig(runs[i], out / ("run" + std::to_string(i)), ticks);
+            }
+        });
+    }
+
+    for(std::thread& t: pool) {
+        t.join();
+    }
+
+    FILE* csv = fopen((out / "results.csv").string().c_str(), "w");
+    if(csv == nullptr) {
+        fprintf(stderr, "Could not write %s.\n", (out / "results.csv").string().c_str());
+        return 1;
+    }
+
+    fprintf(csv, "run");
+    printf("\n%-6s", "run");
+    for(const SweepAxis& axis: axes) {
+        fprintf(csv, ",%s", axis.key.c_str());
+        printf(" %16s", axis.key.c_str());
+    }
+    fprintf(csv, ",ticks,processes,finished,cpu_util,mean_response,mean_turnaround,dispatches,preemptions,memory_requeues,used_memory,paged_in,paged_out\n");
+    printf(" %9s %9s %9s %7s %10s %10s %10s %10s\n", "ticks", "procs", "finished", "cpu%", "response", "turnaround", "preempts", "paged out");
+
+    for(size_t i = 0; i < runs.size(); i++) {
+        const SweepRun& run = runs[i];
+        const RunMetrics& m = run.metrics;
+
+        fprintf(csv, "%zu", i);
+        printf("%-6zu", i);
+        for(const std::string& value: run.values) {
+            fprintf(csv, ",%s", value.c_str());
+            printf(" %16s", value.c_str());
+        }
+
+        if(!run.ok) {
+            fprintf(csv, ",error\n");
+            printf(" error, see %s\n", (out / ("run" + std::to_string(i)) / "config.txt").string().c_str());
+            continue;
+        }
+
+        fprintf(csv, ",%lld,%lld,%lld,%.2f,%.2f,%.2f,%llu,%llu,%llu,%llu,%llu,%llu\n", m.ticks, m.processes, m.finished,
+                m.cpuUtilization, m.meanResponse, m.meanTurnaround, m.dispatches, m.preemptions, m.memoryRequeues,
+                (unsigned long long) m.usedMemory, (unsigned long long) m.pagedIn, (unsigned long long) m.pagedOut);
+        printf(" %9lld %9lld %9lld %7.2f %10.2f %10.2f %10llu %10llu\n", m.ticks, m.processes, m.finished, m.cpuUtilization,
+               m.meanResponse, m.meanTurnaround, m.preemptions, (unsigned long long) m.pagedOut);
+    }
+
+    fclose(csv);
+    printf("\nResults written to %s.\n", (out / "results.csv").string().c_str());
+    return 0;
+}
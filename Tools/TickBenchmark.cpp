@@ -0,0 +1,206 @@
+/*
+    Measures how many system ticks per second the emulator sustains as the number of cores grows.
+
+    Usage: TickBenchmark [--pooled <workers|auto>] [--step <object|scalar|avx2>] [milliseconds per run] [num-cpu...]
+
+    Every run boots its own cores, scheduler and clock with the clock unbounded, keeps every core
+    busy with long running round robin processes and reports the ticks completed per second of
+    host time. Defaults to 2000 ms per run over 1, 2, 4, 8 and 16 cores, one thread per core.
+    --pooled steps the cores on a worker pool instead, as "execution pooled" does, and --step picks
+    how the workers step them, as "core-step" does.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include "../DataTypes/TSQueue.h"
+#include "../DataTypes/SchedAlgo.h"
+#include "../DataTypes/ProcessTable.h"
+#include "../System/Core.h"
+#include "../System/Scheduler.h"
+#include "../System/Tester.h"
+#include "../System/SynchronizedClock.h"
+#include "../System/Tracer.h"
+#include "../System/MemoryInterface.h"
+#include "../System/CoreWorkerPool.h"
+
+const long long BENCHMARK_QUANTUM = 5;
+const long long BENCHMARK_INSTRUCTIONS = 1LL << 40;   // Never completes within a run
+const uint64_t BENCHMARK_MEMORY = 1 << 20;
+const uint64_t BENCHMARK_PROCESS_MEMORY = 64;
+
+std::string benchmarkTimestamp() {
+    return "01/01/2024, 12:00:00 AM";
+}
+
+//Wired the same way System wires its members, without the shell, logs or config file
+class BenchmarkSystem {
+    public:
+        std::vector<Core*> cores;
+        CoreControlTable coreControl;
+        CoreStateTable coreState;
+        ProcessTable processes;
+        long long unused = 1;
+        Tracer tracer;
+        AbstractMemoryInterface* memory;
+        IoController io;
+        SynchronizedClock synchronizer;
+        Scheduler scheduler;
+        Tester tester;
+        CoreWorkerPool corePool;
+        bool pooled;
+
+        // workers is ignored unless pooled, 0 sizes the pool to the host
+        BenchmarkSystem(int numCores, bool pooled, int workers, CoreStepMode step): synchronizer(std::addressof(cores), std::addressof(tester), std::addressof(scheduler)),
+        scheduler(std::addressof(cores), synchronizer.getSyncClock()),
+        tester(synchronizer.getSyncClock(), &unused, &processes, &unused, &unused, benchmarkTimestamp, std::addressof(scheduler), &unused, &unused)
+        {
+            memory = new FlatMemoryInterface(BENCHMARK_MEMORY, benchmarkTimestamp, std::addressof(cores));
+            memory->setTracer(std::addressof(tracer));
+            memory->setProcessTable(std::addressof(processes));
+            scheduler.setTracer(std::addressof(tracer));
+            scheduler.setProcessTable(std::addressof(processes));
+            scheduler.setMemoryInterface(memory);
+            scheduler.setIoController(std::addressof(io));
+            synchronizer.setMemoryInterface(memory);
+            tester.setMemoryInterface(memory);
+
+            coreControl.init(numCores);
+            coreState.init(numCores);
+            for(int i = 0; i < numCores; i++) {
+                cores.push_back(new Core(i, BENCHMARK_QUANTUM, synchronizer.getSyncClock(), benchmarkTimestamp, RR, 0, coreControl.at(i), std::addressof(coreState)));
+            }
+            scheduler.assignReadyQueueToCores();
+            io.init(numCores, DEFAULT_IO_SERVICE, 1);
+
+            this->pooled = pooled;
+            if(pooled) {
+                corePool.init(std::addressof(cores), std::vector<int>(CoreWorkerPool::resolveWorkerCount(workers, numCores), -1), step, std::addressof(coreState));
+            }
+
+            //Twice as many processes as cores keeps every core busy and exercises preemption
+            for(int i = 0; i < numCores * 2; i++) {
+                Process* process = processes.create("Bench" + std::to_string(i), BENCHMARK_INSTRUCTIONS, benchmarkTimestamp(), BENCHMARK_PROCESS_MEMORY);
+                scheduler.admit(process);
+            }
+        }
+
+        ~BenchmarkSystem() {
+            for(const auto& core: cores) {
+                delete core;
+            }
+
+            delete memory;
+        }
+
+        void boot() {
+            scheduler.start();
+
+            if(pooled) {
+                corePool.start();
+            } else {
+                for(const auto& core: cores) {
+                    core->start();
+                }
+            }
+
+            synchronizer.start();
+        }
+
+        void terminate() {
+            synchronizer.turnOff();
+            scheduler.turnOff();
+
+            for(const auto& core: cores) {
+                core->turnOff();
+            }
+            corePool.turnOff();
+        }
+};
+
+double runBenchmark(int numCores, long long durationMs, bool pooled, int workers, CoreStepMode step) {
+    BenchmarkSystem system(numCores, pooled, workers, step);
+    std::atomic<long long>* clock = system.synchronizer.getSyncClock();
+
+    system.boot();
+
+    //Skip the first ticks so thread start up is not measured
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    long long startTick = clock->load();
+    auto start = std::chrono::steady_clock::now();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+
+    long long endTick = clock->load();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    system.terminate();
+    return (endTick - startTick) / seconds;
+}
+
+int main(int argc, char* argv[]) {
+    bool pooled = false;
+    int workers = 0;
+    CoreStepMode step = CORE_STEP_OBJECT;
+    int arg = 1;
+
+    while(arg + 1 < argc && std::string(argv[arg]).compare(0, 2, "--") == 0) {
+        std::string option = argv[arg];
+        std::string value = argv[arg + 1];
+
+        if(option == "--pooled") {
+            pooled = true;
+            workers = value == "auto" ? 0 : std::atoi(value.c_str());
+        } else if(option == "--step" && (value == "scalar" || value == "avx2" || value == "object")) {
+            step = value == "scalar" ? CORE_STEP_SCALAR : value == "avx2" ? CORE_STEP_AVX2 : CORE_STEP_OBJECT;
+        } else {
+            fprintf(stderr, "Unknown option %s %s.\n", option.c_str(), value.c_str());
+            return 1;
+        }
+
+        arg += 2;
+    }
+
+    if(step != CORE_STEP_OBJECT && !pooled) {
+        fprintf(stderr, "--step requires --pooled.\n");
+        return 1;
+    }
+
+    if(step == CORE_STEP_AVX2 && !cpuSupportsAvx2()) {
+        fprintf(stderr, "This host does not support AVX2.\n");
+        return 1;
+    }
+
+    long long durationMs = argc > arg ? std::atoll(argv[arg]) : 2000;
+    std::vector<int> coreCounts;
+
+    for(int i = arg + 1; i < argc; i++) {
+        coreCounts.push_back(std::atoi(argv[i]));
+    }
+
+    if(coreCounts.empty()) {
+        coreCounts = { 1, 2, 4, 8, 16 };
+    }
+
+    if(durationMs <= 0 || workers < 0) {
+        fprintf(stderr, "Invalid duration.\n");
+        return 1;
+    }
+
+    printf("Host threads: %u, %lld ms per run, %s execution, %s stepping\n\n", std::thread::hardware_concurrency(), durationMs, pooled ? "pooled" : "threads", CORE_STEP_MODE_NAMES[step]);
+    printf("%8s  %14s\n", "num-cpu", "ticks/sec");
+
+    for(int numCores: coreCounts) {
+        if(numCores < 1) {
+            continue;
+        }
+
+        printf("%8d  %14.1f\n", numCores, runBenchmark(numCores, durationMs, pooled, workers, step));
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,273 @@
+/*
+    Offline analyzer for binary traces recorded with the "trace start <file>" command.
+
+    Usage: TraceAnalyzer <trace file> [gantt width]
+
+    Prints a summary and an ASCII Gantt chart, and writes the following next to the trace:
+        <trace>.gantt.csv       core, pid, start tick, end tick of every run interval
+        <trace>.processes.csv   per process arrival, first dispatch, completion, response and turnaround
+        <trace>.memory.csv      used and free memory after every tick with a memory event
+*/
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "../DataTypes/TraceRecord.h"
+#include "../DataTypes/MappedFile.h"
+
+struct RunInterval {
+    int core;
+    int pid;
+    uint64_t start;
+    uint64_t end;
+};
+
+struct ProcessTimes {
+    int64_t arrival = -1;
+    int64_t firstDispatch = -1;
+    int64_t completion = -1;
+    uint64_t dispatches = 0;
+    uint64_t preemptions = 0;
+    uint64_t evictions = 0;
+};
+
+struct MemorySample {
+    uint64_t tick;
+    uint64_t used;
+};
+
+static char pidSymbol(int pid) {
+    const char symbols[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    return symbols[pid % (sizeof(symbols) - 1)];
+}
+
+static void printGantt(const std::vector<RunInterval>& intervals, uint32_t numCores, uint64_t firstTick, uint64_t lastTick, int width) {
+    uint64_t span = lastTick - firstTick + 1;
+    double ticksPerColumn = (double) span / width;
+
+    if(ticksPerColumn < 1) {
+        ticksPerColumn = 1;
+        width = (int) span;
+    }
+
+    //For every cell keep the pid with the most ticks inside the cell
+    std::vector<std::vector<int>> owner(numCores, std::vector<int>(width, -1));
+    std::vector<std::vector<double>> ownerTicks(numCores, std::vector<double>(width, 0));
+
+    for(const auto& interval: intervals) {
+        if(interval.core < 0 || interval.core >= (int) numCores) {
+            continue;
+        }
+
+        int firstColumn = (int) ((interval.start - firstTick) / ticksPerColumn);
+        int lastColumn = std::min(width - 1, (int) ((interval.end - firstTick) / ticksPerColumn));
+
+        for(int column = firstColumn; column <= lastColumn; column++) {
+            double cellStart = firstTick + column * ticksPerColumn;
+            double cellEnd = cellStart + ticksPerColumn;
+            double overlap = std::min(cellEnd, (double) interval.end) - std::max(cellStart, (double) interval.start);
+
+            if(overlap > ownerTicks[interval.core][column]) {
+                ownerTicks[interval.core][column] = overlap;
+                owner[interval.core][column] = interval.pid;
+            }
+        }
+    }
+
+    printf("\nGantt chart (ticks %llu - %llu, %.1f ticks per column, '.' = idle, symbol = pid mod 62)\n",
+           (unsigned long long) firstTick, (unsigned long long) lastTick, ticksPerColumn);
+
+    for(uint32_t core = 0; core < numCores; core++) {
+        printf("Core %-3u |", core);
+
+        for(int column = 0; column < width; column++) {
+            putchar(owner[core][column] == -1 ? '.' : pidSymbol(owner[core][column]));
+        }
+
+        printf("|\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        printf("Usage: %s <trace file> [gantt width]\n", argv[0]);
+        return 1;
+    }
+
+    std::string path = argv[1];
+    int ganttWidth = argc >= 3 ? atoi(argv[2]) : 100;
+    MappedFile file;
+
+    if(!file.openRead(path) || file.size() < sizeof(TraceHeader)) {
+        printf("Error! Could not read trace file %s\n", path.c_str());
+        return 1;
+    }
+
+    TraceHeader header;
+    memcpy(&header, file.data(), sizeof(TraceHeader));
+
+    if(memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 || header.version != TRACE_VERSION) {
+        printf("Error! %s is not a version %u trace file\n", path.c_str(), TRACE_VERSION);
+        return 1;
+    }
+
+    uint64_t available = (file.size() - sizeof(TraceHeader)) / sizeof(TraceRecord);
+    uint64_t count = std::min(header.recordCount, available);
+    const TraceRecord* records = (const TraceRecord*) (file.data() + sizeof(TraceHeader));
+
+    //Records are flushed per thread, so restore global tick order before replaying them
+    std::vector<TraceRecord> sorted(records, records + count);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const TraceRecord& a, const TraceRecord& b) { return a.tick < b.tick; });
+
+    std::vector<RunInterval> intervals;
+    std::map<int, ProcessTimes> processes;
+    std::vector<int> running(header.numCores, -1);
+    std::vector<uint64_t> runningSince(header.numCores, 0);
+    std::vector<MemorySample> memory;
+    uint64_t used = 0;
+    uint64_t peakUsed = 0;
+    uint64_t evictedBytes = 0;
+    uint64_t swappedInBytes = 0;
+    uint64_t firstTick = count > 0 ? sorted.front().tick : 0;
+    uint64_t lastTick = count > 0 ? sorted.back().tick : 0;
+
+    for(const auto& r: sorted) {
+        ProcessTimes& times = processes[r.pid];
+        bool onCore = r.core >= 0 && r.core < (int) header.numCores;
+
+        switch(r.event) {
+            case TRACE_ARRIVE:
+                times.arrival = r.tick;
+                break;
+            case TRACE_DISPATCH:
+                if(times.firstDispatch == -1) {
+                    times.firstDispatch = r.tick;
+                }
+                times.dispatches++;
+
+                if(onCore) {
+                    running[r.core] = r.pid;
+                    runningSince[r.core] = r.tick;
+                }
+                break;
+            case TRACE_PREEMPT:
+            case TRACE_COMPLETE:
+            case TRACE_SLEEP:
+            case TRACE_IO_SUBMIT:
+                if(r.event == TRACE_PREEMPT) {
+                    times.preemptions++;
+                } else if(r.event == TRACE_COMPLETE) {
+                    times.completion = r.tick;
+                }
+
+                if(onCore && running[r.core] == r.pid) {
+                    intervals.push_back({ r.core, r.pid, runningSince[r.core], r.tick });
+                    running[r.core] = -1;
+                }
+                break;
+            case TRACE_ALLOCATE:
+                used += r.arg;
+                break;
+            case TRACE_FREE:
+                used -= std::min(used, r.arg);
+                break;
+            case TRACE_EVICT:
+                used -= std::min(used, r.arg);
+                evictedBytes += r.arg;
+                times.evictions++;
+                break;
+            case TRACE_SWAP_IN:
+                swappedInBytes += r.arg;
+                break;
+        }
+
+        if(r.event >= TRACE_ALLOCATE && r.event <= TRACE_EVICT) {
+            if(!memory.empty() && memory.back().tick == r.tick) {
+                memory.back().used = used;
+            } else {
+                memory.push_back({ r.tick, used });
+            }
+            peakUsed = std::max(peakUsed, used);
+        }
+    }
+
+    for(uint32_t core = 0; core < header.numCores; core++) {
+        if(running[core] != -1) {
+            intervals.push_back({ (int) core, running[core], runningSince[core], lastTick });
+        }
+    }
+
+    //Gantt intervals
+    FILE* f = fopen((path + ".gantt.csv").c_str(), "w");
+    fprintf(f, "core,pid,start,end\n");
+    for(const auto& interval: intervals) {
+        fprintf(f, "%d,%d,%llu,%llu\n", interval.core, interval.pid, (unsigned long long) interval.start, (unsigned long long) interval.end);
+    }
+    fclose(f);
+
+    //Per process turnaround
+    double totalTurnaround = 0;
+    double totalResponse = 0;
+    int64_t maxTurnaround = 0;
+    uint64_t completed = 0;
+    uint64_t dispatched = 0;
+
+    f = fopen((path + ".processes.csv").c_str(), "w");
+    fprintf(f, "pid,arrival,first_dispatch,completion,response,turnaround,dispatches,preemptions,evictions\n");
+    for(const auto& entry: processes) {
+        const ProcessTimes& times = entry.second;
+        int64_t response = (times.arrival != -1 && times.firstDispatch != -1) ? times.firstDispatch - times.arrival : -1;
+        int64_t turnaround = (times.arrival != -1 && times.completion != -1) ? times.completion - times.arrival : -1;
+
+        fprintf(f, "%d,%lld,%lld,%lld,%lld,%lld,%llu,%llu,%llu\n", entry.first, (long long) times.arrival, (long long) times.firstDispatch,
+                (long long) times.completion, (long long) response, (long long) turnaround, (unsigned long long) times.dispatches,
+                (unsigned long long) times.preemptions, (unsigned long long) times.evictions);
+
+        if(response != -1) {
+            totalResponse += response;
+            dispatched++;
+        }
+
+        if(turnaround != -1) {
+            totalTurnaround += turnaround;
+            maxTurnaround = std::max(maxTurnaround, turnaround);
+            completed++;
+        }
+    }
+    fclose(f);
+
+    //Fragmentation over time, free memory is what the memory interfaces report as total fragmentation
+    double totalFree = 0;
+    f = fopen((path + ".memory.csv").c_str(), "w");
+    fprintf(f, "tick,used,free\n");
+    for(const auto& sample: memory) {
+        uint64_t freeMemory = header.memorySize - std::min(header.memorySize, sample.used);
+        fprintf(f, "%llu,%llu,%llu\n", (unsigned long long) sample.tick, (unsigned long long) sample.used, (unsigned long long) freeMemory);
+        totalFree += freeMemory;
+    }
+    fclose(f);
+
+    printf("Trace: %s\n", path.c_str());
+    printf("%13llu records\n", (unsigned long long) count);
+    printf("%13u cores\n", header.numCores);
+    printf("%13llu K memory (%llu K frames)\n", (unsigned long long) header.memorySize, (unsigned long long) header.frameSize);
+    printf("%13llu ticks traced\n", (unsigned long long) (count > 0 ? lastTick - firstTick + 1 : 0));
+    printf("%13zu processes seen\n", processes.size());
+    printf("%13llu processes completed\n", (unsigned long long) completed);
+    printf("%13.1f average response ticks\n", dispatched > 0 ? totalResponse / dispatched : 0.0);
+    printf("%13.1f average turnaround ticks\n", completed > 0 ? totalTurnaround / completed : 0.0);
+    printf("%13lld max turnaround ticks\n", (long long) maxTurnaround);
+    printf("%13llu K peak used memory\n", (unsigned long long) peakUsed);
+    printf("%13.1f K average free memory\n", memory.empty() ? (double) header.memorySize : totalFree / memory.size());
+    printf("%13llu K swapped out\n", (unsigned long long) evictedBytes);
+    printf("%13llu K swapped in\n", (unsigned long long) swappedInBytes);
+
+    if(count > 0) {
+        printGantt(intervals, header.numCores, firstTick, lastTick, ganttWidth);
+    }
+
+    return 0;
+}
@@ -9,137 +9,257 @@
 #include<vector>
 #include <iomanip>
 #include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdarg>
 #include"./Styles.h"
+#include"./ScreenHistory.h"
 #include"../DataTypes/Process.h"
+#include"../DataTypes/ProcessTable.h"
 
-void printColored(std::string text, TextColor color) {
+void printColored(std::string text, TextColor color, std::ostream& out = std::cout) {
     std::string color_escape = "\033[";
-    std::cout << color_escape << color << "m" << text << color_escape << RESET << "m";
+    out << color_escape << color << "m" << text << color_escape << RESET << "m";
 }
 
-void printHeader() {
-    std::cout << "  ____ ____   ___  ____  _____ ______   __\n";
-    std::cout << " / ___/ ___| / _ \\|  _ \\| ____/ ___\\ \\ / /\n";
-    std::cout << "| |   \\___ \\| | | | |_) |  _| \\___  \\ V /\n";
-    std::cout << "| |___ ___) | |_| |  __/| |___ ___) || |\n";
-    std::cout << " \\____|____/ \\___/|_|   |_____|____/ |_|  \n";
-    printColored("Hello, Welcome to CSOPESY commandline!\n", GREEN);
-    printColored("Type 'exit' to quit, 'clear' to clear the screen\n", YELLOW);
+void printHeader(std::ostream& out = std::cout) {
+    out << "  ____ ____   ___  ____  _____ ______   __\n";
+    out << " / ___/ ___| / _ \\|  _ \\| ____/ ___\\ \\ / /\n";
+    out << "| |   \\___ \\| | | | |_) |  _| \\___  \\ V /\n";
+    out << "| |___ ___) | |_| |  __/| |___ ___) || |\n";
+    out << " \\____|____/ \\___/|_|   |_____|____/ |_|  \n";
+    printColored("Hello, Welcome to CSOPESY commandline!\n", GREEN, out);
+    printColored("Type 'exit' to quit, 'clear' to clear the screen\n", YELLOW, out);
 }
 
-void printLine() {
+void printLine(std::ostream& out = std::cout) {
     std::string str(50, '-');
-    std::cout << str;
+    out << str;
 }
 
-std::vector<std::pair<std::string, std::string>> printProcesses(int totalCores, std::vector<Process> runningProcesses, std::vector<Process> completedProcesses) {
-    std::vector<std::pair<std::string, std::string>> returnOutput;
+std::string formatProcessCounters(const Process& process) {
+    char output[160];
+    int length = snprintf(output, sizeof(output), "  resp: %lld  wait: %lld  mem: %lld  preempt: %lld  swap: %lld", process.getResponseTicks(),
+                          process.waitingTicks, process.memoryBlockedTicks, process.preemptions, process.swaps);
 
-    int running_ctr = 0; 
+    if (process.completed) {
+        snprintf(output + length, sizeof(output) - length, "  tat: %lld", process.getTurnaroundTicks());
+    }
 
-    for (const auto& process : runningProcesses) { 
-        if (process.core != -1) {
-            running_ctr++;
-        }
-    } 
+    return output;
+}
 
-    int cpu_util = static_cast<double>(running_ctr) / totalCores * 100;
-    cpu_util = cpu_util < 0 ? 0 : cpu_util;
-    std::ostringstream output;                
-    output << "\nCPU utilization: " << cpu_util << "%\n";
-    output << "Cores used: " << running_ctr << "\n";
-    output << "Cores available: " << totalCores - running_ctr << "\n";
-    returnOutput.push_back(std::make_pair(output.str(), "RESET"));
-    std::cout << output.str();
-
-    printColored("-----------------------------------------\n", BLUE);
-    returnOutput.push_back(std::make_pair("-----------------------------------------\n", "BLUE"));
-
-    std::cout << "Running Processes:\n";
-    returnOutput.push_back(std::make_pair("Running Processes:\n", "RESET"));
-
-    for (const auto process : runningProcesses) {
-        std::string inCore = (process.core == -1) ? "N/A" : std::to_string(process.core);
-        printf("%-11s %-30s Core: %-3s      %d / %d\n", process.name.c_str(), ("(" + process.timestamp + ")").c_str(), inCore.c_str(), process.current_instruction, process.total_instructions);
-        std::string name = process.name;
-        std::string timestamp = process.timestamp+")";
-        if (name.length() > 12) {
-            name = name.substr(0, 12); 
-        } else {
-            name.append(11 - name.length(), ' ');
+long long percentile(const std::vector<long long>& sorted, int p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+
+    size_t rank = (sorted.size() * p + 99) / 100; // Nearest rank
+    return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+std::string formatLatencySummary(std::vector<long long>& response, std::vector<long long>& turnaround) {
+    std::sort(response.begin(), response.end());
+    std::sort(turnaround.begin(), turnaround.end());
+
+    char line[128];
+    std::string output = "\nScheduling latency (ticks)      p50        p95        p99\n";
+    snprintf(line, sizeof(line), "Response   (%7zu procs) %10lld %10lld %10lld\n", response.size(), percentile(response, 50), percentile(response, 95), percentile(response, 99));
+    output += line;
+    snprintf(line, sizeof(line), "Turnaround (%7zu procs) %10lld %10lld %10lld\n", turnaround.size(), percentile(turnaround, 50), percentile(turnaround, 95), percentile(turnaround, 99));
+    output += line;
+
+    return output;
+}
+
+// Output is collected and written in large blocks, to a file or a stream, with a history attached every
+// write is also kept there
+class BufferedWriter {
+    private:
+        static const size_t FLUSH_SIZE = 1 << 16;
+        FILE* out;
+        std::ostream* stream;   // Used instead of out when set
+        bool colored;
+        std::string pending;
+        ScreenHistory* history;
+
+    public:
+        BufferedWriter(FILE* out, bool colored, ScreenHistory* history = nullptr) {
+            this->out = out;
+            this->stream = nullptr;
+            this->colored = colored;
+            this->history = history;
         }
 
-        if (timestamp.length() < 31) {
-            timestamp.append(30 - timestamp.length(), ' ');
+        BufferedWriter(std::ostream* stream, bool colored, ScreenHistory* history = nullptr) {
+            this->out = nullptr;
+            this->stream = stream;
+            this->colored = colored;
+            this->history = history;
         }
 
-        if (inCore.length() < 4) {
-            inCore.append(3 - inCore.length(), ' '); 
+        ~BufferedWriter() {
+            flush();
         }
-        returnOutput.push_back(std::make_pair(name + " (" + timestamp + "Core: " + inCore + "      " + std::to_string(process.current_instruction) + " / " + std::to_string(process.total_instructions) + "\n", "RESET"));
-    }
-    
-    std::cout << "\nFinished Processes:\n";
-    returnOutput.push_back(std::make_pair("\nFinished Processes:\n", "RESET"));
-
-    for (const auto& process : completedProcesses) {
-        printf("%-11s %-30s Finished       %d / %d \n", process.name.c_str(), ("(" + process.timestamp + ")").c_str(), process.current_instruction, process.total_instructions);
-        std::string name = process.name;
-        std::string timestamp = process.timestamp+")";
-        
-        if (name.length() > 12) {
-            name = name.substr(0, 12); 
-        } else {
-            name.append(11 - name.length(), ' ');
+
+        void write(const std::string& text, TextColor color = RESET) {
+            if (colored && color != RESET) {
+                pending += "\033[" + std::to_string(color) + "m" + text + "\033[0m";
+            } else {
+                pending += text;
+            }
+
+            if (history != nullptr) {
+                history->add(text, color);
+            }
+
+            if (pending.size() >= FLUSH_SIZE) {
+                flush();
+            }
         }
 
-        if (timestamp.length() < 31) {
-            timestamp.append(30 - timestamp.length(), ' ');
+        void writef(const char* format, ...) {
+            char line[512];
+            va_list args;
+            va_start(args, format);
+            int length = vsnprintf(line, sizeof(line), format, args);
+            va_end(args);
+
+            if (length < 0) {
+                return;
+            }
+
+            if (length < (int) sizeof(line)) {
+                write(std::string(line, length));
+                return;
+            }
+
+            std::string longLine(length + 1, '\0');
+            va_start(args, format);
+            vsnprintf(&longLine[0], longLine.size(), format, args);
+            va_end(args);
+            longLine.resize(length);
+            write(longLine);
         }
-        returnOutput.push_back(std::make_pair(name + " (" + timestamp + "Finished       " + std::to_string(process.current_instruction) + " / " + std::to_string(process.total_instructions) + "\n", "RESET"));
-    }
-    printColored("-----------------------------------------\n", BLUE);
-    returnOutput.push_back(std::make_pair("-----------------------------------------\n", "BLUE"));
 
-    return returnOutput;
-}
+        void flush() {
+            if (stream != nullptr) {
+                stream->write(pending.data(), pending.size());
+                stream->flush();
+                pending.clear();
+                return;
+            }
 
-void logProcesses(int totalCores, std::vector<Process> runningProcesses, std::vector<Process> completedProcesses) {
-    std::ofstream outfile("./Logs/csopesy-log.txt");
+            if (!pending.empty()) {
+                fwrite(pending.data(), 1, pending.size(), out);
+                pending.clear();
+            }
 
-    if (!outfile.is_open()) {
-        std::cerr << "Error opening file for writing." << std::endl;
-        return;
-    }
+            fflush(out);
+        }
+};
+
+// Which processes a listing shows. Offset and limit count matching processes, running ones first, in pid order.
+struct ProcessListFilter {
+    bool running = true;
+    bool finished = true;
+    long long offset = 0;
+    long long limit = -1;   // -1 shows every match
+};
 
-    int running_ctr = 0; 
+// Streams the screen -ls / report-util listing straight from the process table. The console format pads
+// the columns, the log format is the one csopesy-log.txt has always used.
+void writeProcessList(BufferedWriter& out, const ProcessTable::Snapshot& snapshot, int totalCores, const ProcessListFilter& filter, bool console) {
+    int running_ctr = 0;
+    std::vector<long long> response;
+    std::vector<long long> turnaround;
 
-    for (const auto& process : runningProcesses) { 
-        if (process.core != -1) {
-            running_ctr++;
+    //Summary pass, only counters are collected
+    snapshot.forEach([&](const Process& process) {
+        if (!process.completed) {
+            if (process.core != -1) {
+                running_ctr++;
+            }
+
+            if (process.firstDispatchTick != -1) {
+                response.push_back(process.getResponseTicks());
+            }
+        } else if (process.completionTick != -1) {
+            response.push_back(process.getResponseTicks());
+            turnaround.push_back(process.getTurnaroundTicks());
         }
-    } 
+    });
 
     int cpu_util = static_cast<double>(running_ctr) / totalCores * 100;
     cpu_util = cpu_util < 0 ? 0 : cpu_util;
-    outfile << "CPU utilization: " << cpu_util << "%\n";
-    outfile << "Cores used: " << running_ctr << "\n";
-    outfile << "Cores available: " << totalCores - running_ctr << "\n";
-    outfile << "-----------------------------------------\n";
-    outfile << "Running Processes:\n";
-    for (const auto& process : runningProcesses) {
-        std::string inCore = (process.core == -1) ? "N/A" : std::to_string(process.core);
-        outfile << process.name << " (" << process.timestamp << ") Core: " << std::left << std::setw(3)<< inCore 
-                << "      " << process.current_instruction << " / " << process.total_instructions << "\n";
+    out.writef("%sCPU utilization: %d%%\nCores used: %d\nCores available: %d\n", console ? "\n" : "", cpu_util, running_ctr, totalCores - running_ctr);
+    out.write("-----------------------------------------\n", BLUE);
+
+    long long matched = 0;
+    long long shown = 0;
+    auto inPage = [&]() {
+        bool show = matched >= filter.offset && (filter.limit < 0 || shown < filter.limit);
+        matched++;
+        shown += show ? 1 : 0;
+        return show;
+    };
+
+    if (filter.running) {
+        out.write("Running Processes:\n");
+        snapshot.forEach([&](const Process& process) {
+            if (process.completed || !inPage()) {
+                return;
+            }
+
+            std::string inCore = process.core == -1 ? "N/A" : std::to_string(process.core);
+            if (console) {
+                out.writef("%-11s %-30s Core: %-3s      %lld / %lld%s\n", process.name.c_str(), ("(" + process.timestamp + ")").c_str(), inCore.c_str(),
+                           process.current_instruction, process.total_instructions, formatProcessCounters(process).c_str());
+            } else {
+                out.writef("%s (%s) Core: %-3s      %lld / %lld%s\n", process.name.c_str(), process.timestamp.c_str(), inCore.c_str(),
+                           process.current_instruction, process.total_instructions, formatProcessCounters(process).c_str());
+            }
+        });
+    }
+
+    if (filter.finished) {
+        out.write(filter.running ? "\nFinished Processes:\n" : "Finished Processes:\n");
+        snapshot.forEach([&](const Process& process) {
+            if (!process.completed || !inPage()) {
+                return;
+            }
+
+            if (console) {
+                out.writef("%-11s %-30s Finished       %lld / %lld%s\n", process.name.c_str(), ("(" + process.timestamp + ")").c_str(),
+                           process.current_instruction, process.total_instructions, formatProcessCounters(process).c_str());
+            } else {
+                out.writef("%s (%s) Finished       %lld / %lld%s\n", process.name.c_str(), process.timestamp.c_str(),
+                           process.current_instruction, process.total_instructions, formatProcessCounters(process).c_str());
+            }
+        });
+    }
+
+    if (shown < matched) {
+        out.writef("\nShowing %lld of %lld processes from offset %lld.\n", shown, matched, filter.offset);
+    }
+
+    out.write(formatLatencySummary(response, turnaround));
+    out.write("-----------------------------------------\n", BLUE);
+}
+
+void logProcesses(const std::string& path, int totalCores, const ProcessTable::Snapshot& snapshot) {
+    FILE* f = fopen(path.c_str(), "w");
+
+    if (f == nullptr) {
+        std::cerr << "Error opening file for writing." << std::endl;
+        return;
     }
 
-    outfile << "\nFinished Processes:\n";
-    for (const auto& process : completedProcesses) {
-        outfile << process.name << " (" << process.timestamp << ") Finished       "
-                << process.current_instruction << " / " << process.total_instructions << "\n";
+    {
+        BufferedWriter out(f, false);
+        writeProcessList(out, snapshot, totalCores, ProcessListFilter(), false);
     }
 
-    outfile << "-----------------------------------------\n";
-    outfile.close();
+    fclose(f);
 }
 #endif  
\ No newline at end of file
@@ -0,0 +1,127 @@
+/*
+    This file defines the bounded output history kept for every screen
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include "./Styles.h"
+
+const size_t DEFAULT_HISTORY_CAP = 1 << 20; // Bytes of text kept per screen
+
+// Colored text fragments stored back to back in a byte ring. Once the ring is full the oldest
+// fragments are dropped, so a screen never holds more than its cap however long the shell runs.
+class ScreenHistory {
+    private:
+        struct Fragment {
+            uint32_t start;     // Offset of the first byte in the arena
+            uint32_t length;
+            uint8_t color;      // TextColor
+        };
+
+        size_t capacity;
+        std::vector<char> arena;            // Grows up to capacity, then wraps
+        std::deque<Fragment> fragments;     // Oldest first, at most capacity / 16 entries
+        size_t head = 0;                    // Arena offset of the next byte
+        size_t used = 0;                    // Bytes held by live fragments
+
+        size_t fragmentCapacity() {
+            return capacity / 16 < 16 ? 16 : capacity / 16;
+        }
+
+        void dropOldest() {
+            used -= fragments.front().length;
+            fragments.pop_front();
+        }
+
+        void writeBytes(const char* text, size_t length) {
+            for (size_t i = 0; i < length; i++) {
+                if (arena.size() < capacity) {
+                    arena.push_back(text[i]);
+                } else {
+                    arena[head] = text[i];
+                }
+
+                head = (head + 1) % capacity;
+            }
+        }
+
+    public:
+        ScreenHistory(size_t capacity = DEFAULT_HISTORY_CAP) {
+            this->capacity = capacity;
+        }
+
+        void add(const std::string& text, TextColor color = RESET) {
+            const char* bytes = text.data();
+            size_t length = text.size();
+
+            if (length == 0) {
+                return;
+            }
+
+            //Only the tail of a fragment larger than the whole history is kept
+            if (length > capacity) {
+                bytes += length - capacity;
+                length = capacity;
+            }
+
+            while (!fragments.empty() && used + length > capacity) {
+                dropOldest();
+            }
+
+            size_t start = head;
+            writeBytes(bytes, length);
+            used += length;
+
+            //Text of the same color as the newest fragment extends it, it is already right behind it in the arena
+            if (!fragments.empty() && fragments.back().color == color) {
+                fragments.back().length += length;
+                return;
+            }
+
+            if (fragments.size() == fragmentCapacity()) {
+                dropOldest();
+            }
+
+            fragments.push_back({ (uint32_t) start, (uint32_t) length, (uint8_t) color });
+        }
+
+        // Calls visit(text, length, color) oldest first, a fragment that wraps around the arena is visited in two parts
+        template <typename Visit>
+        void forEach(Visit visit) {
+            for (const Fragment& fragment : fragments) {
+                size_t first = fragment.length < capacity - fragment.start ? fragment.length : capacity - fragment.start;
+
+                visit(arena.data() + fragment.start, first, (TextColor) fragment.color);
+                if (first < fragment.length) {
+                    visit(arena.data(), fragment.length - first, (TextColor) fragment.color);
+                }
+            }
+        }
+
+        void clear() {
+            arena.clear();
+            fragments.clear();
+            head = 0;
+            used = 0;
+        }
+
+        // Keeps the newest text that fits the new cap
+        void setCapacity(size_t capacity) {
+            std::vector<std::pair<std::string, TextColor>> kept;
+            forEach([&](const char* text, size_t length, TextColor color) {
+                kept.emplace_back(std::string(text, length), color);
+            });
+
+            clear();
+            this->capacity = capacity;
+            for (const auto& fragment : kept) {
+                add(fragment.first, fragment.second);
+            }
+        }
+
+        size_t getUsedBytes() {
+            return used;
+        }
+};
@@ -1,6 +1,8 @@
 /*
     This file defines all code related to the styling of the UI
 */
+#pragma once
+#include <string>
 
 typedef enum TextColor {
     RED = 31,
@@ -22,4 +24,4 @@ TextColor stringToColor(const std::string& color) {
     if (color == "CYAN") return CYAN;
     if (color == "WHITE") return WHITE;
     return RESET; // Default to RESET if color not recognized
-}
\ No newline at end of file
+}